@@ -43,6 +43,7 @@ struct aes_ctx_s {
     uint8_t iv[AES_128_BLOCK_SIZE];
     aes_direction_t direction;
     uint8_t block_offset;
+    uint64_t ctr_bytes;        /* CTR mode: position in the keystream */
 };
 
 uint8_t waste[AES_128_BLOCK_SIZE];
@@ -63,6 +64,7 @@ aes_ctx_t *aes_init(const uint8_t *key, const uint8_t *iv, const EVP_CIPHER *typ
     assert(ctx->cipher_ctx != NULL);
 
     ctx->block_offset = 0;
+    ctx->ctr_bytes = 0;
     ctx->direction = direction;
 
     if (direction == AES_ENCRYPT) {
@@ -145,6 +147,7 @@ aes_ctx_t *aes_ctr_init(const uint8_t *key, const uint8_t *iv) {
 void aes_ctr_encrypt(aes_ctx_t *ctx, const uint8_t *in, uint8_t *out, int len) {
     aes_encrypt(ctx, in, out, len);
     ctx->block_offset = (ctx->block_offset + len) % AES_128_BLOCK_SIZE;
+    ctx->ctr_bytes += len;
 }
 
 void aes_ctr_start_fresh_block(aes_ctx_t *ctx) {
@@ -155,10 +158,35 @@ void aes_ctr_start_fresh_block(aes_ctx_t *ctx) {
 
 void aes_ctr_decrypt(aes_ctx_t *ctx, const uint8_t *in, uint8_t *out, int len) {
     aes_encrypt(ctx, in, out, len);
+    ctx->ctr_bytes += len;
+}
+
+/* moves on len bytes in the keystream, as aes_ctr_decrypt would, but without computing them: *
+ * the counter block is the iv plus the block number, as a 128-bit big-endian integer         */
+void aes_ctr_skip(aes_ctx_t *ctx, uint64_t len) {
+    uint8_t counter[AES_128_BLOCK_SIZE];
+    uint64_t position = ctx->ctr_bytes + len;
+    uint64_t blocks = position / AES_128_BLOCK_SIZE;
+    int rest = (int) (position % AES_128_BLOCK_SIZE);
+
+    memcpy(counter, ctx->iv, AES_128_BLOCK_SIZE);
+    for (int i = AES_128_BLOCK_SIZE - 1; i >= 0 && blocks; i--) {
+        unsigned int sum = counter[i] + (unsigned int) (blocks & 0xff);
+        counter[i] = (uint8_t) sum;
+        blocks = (blocks >> 8) + (sum >> 8);
+    }
+    if (!EVP_EncryptInit_ex(ctx->cipher_ctx, NULL, NULL, NULL, counter)) {
+        handle_error(__func__);
+    }
+    ctx->ctr_bytes = position - rest;
+    if (rest) {
+        aes_ctr_decrypt(ctx, waste, waste, rest);
+    }
 }
 
 void aes_ctr_reset(aes_ctx_t *ctx) {
     aes_reset(ctx, EVP_aes_128_ctr(), AES_ENCRYPT);
+    ctx->ctr_bytes = 0;
 }
 
 void aes_ctr_destroy(aes_ctx_t *ctx) {
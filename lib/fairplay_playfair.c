@@ -31,6 +31,15 @@ struct fairplay_s {
 
     unsigned char keymsg[164];
     unsigned int keymsglen;
+
+    /* derived from keymsg by the first fairplay_decrypt() */
+    uint32_t key_schedule[11][4];
+    int have_key_schedule;
+
+    /* the last key decrypted (a client may send the same ekey more than once) */
+    unsigned char last_input[72];
+    unsigned char last_output[16];
+    int have_last;
 };
 
 fairplay_t *
@@ -62,6 +71,8 @@ fairplay_setup(fairplay_t *fp, const unsigned char req[16], unsigned char res[14
     mode = req[14];
     memcpy(res, reply_message[mode], 142);
     fp->keymsglen = 0;
+    fp->have_key_schedule = 0;
+    fp->have_last = 0;
     return 0;
 }
 
@@ -77,6 +88,8 @@ fairplay_handshake(fairplay_t *fp, const unsigned char req[164], unsigned char r
 
     memcpy(fp->keymsg, req, 164);
     fp->keymsglen = 164;
+    fp->have_key_schedule = 0;
+    fp->have_last = 0;
 
     memcpy(res, fp_header, 12);
     memcpy(res + 12, req + 144, 20);
@@ -90,7 +103,18 @@ fairplay_decrypt(fairplay_t *fp, const unsigned char input[72], unsigned char ou
         return -1;
     }
 
-    playfair_decrypt(fp->keymsg, (unsigned char *) input, output);
+    if (fp->have_last && !memcmp(input, fp->last_input, sizeof(fp->last_input))) {
+        memcpy(output, fp->last_output, sizeof(fp->last_output));
+        return 0;
+    }
+    if (!fp->have_key_schedule) {
+        playfair_key_schedule(fp->keymsg, fp->key_schedule);
+        fp->have_key_schedule = 1;
+    }
+    playfair_decrypt_with_key_schedule(fp->key_schedule, (unsigned char *) input, output);
+    memcpy(fp->last_input, input, sizeof(fp->last_input));
+    memcpy(fp->last_output, output, sizeof(fp->last_output));
+    fp->have_last = 1;
     return 0;
 }
 
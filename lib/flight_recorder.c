@@ -0,0 +1,180 @@
+/**
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *===================================================================
+ * UxPlay contributors 2026
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <time.h>
+
+#include "flight_recorder.h"
+#include "latency_trace.h"
+#include "logger.h"
+
+#define SECOND_IN_NSECS 1000000000LL
+#define RECORD_MASK (FLIGHT_RECORDER_RECORDS - 1)
+
+/* seq is 0 while a record is being written, then (its index in the sequence of records) + 1, *
+ * so that a reader can detect (and skip) records overwritten while it was copying them      */
+typedef struct flight_record_s {
+    uint64_t seq;
+    uint64_t time;
+    uint16_t type;
+    uint16_t id;
+    uint32_t value;
+    int64_t a;
+    int64_t b;
+} flight_record_t;
+
+struct flight_recorder_s {
+    logger_t *logger;
+    uint64_t head;
+    int dumping;
+    flight_record_t *records;
+};
+
+static const char *type_names[] = { "", "audio", "audio_resent", "video", "ntp", "ntp_timeout",
+                                    "audio_delay", "video_delay", "conn_reset" };
+
+flight_recorder_t *
+flight_recorder_init(logger_t *logger)
+{
+    flight_recorder_t *recorder = calloc(1, sizeof(flight_recorder_t));
+    if (!recorder) {
+        return NULL;
+    }
+    recorder->records = calloc(FLIGHT_RECORDER_RECORDS, sizeof(flight_record_t));
+    if (!recorder->records) {
+        free(recorder);
+        return NULL;
+    }
+    recorder->logger = logger;
+    return recorder;
+}
+
+void
+flight_recorder_destroy(flight_recorder_t *recorder)
+{
+    if (recorder) {
+        free(recorder->records);
+        free(recorder);
+    }
+}
+
+void
+flight_recorder_add(flight_recorder_t *recorder, flight_record_type_t type, uint16_t id, uint32_t value,
+                    int64_t a, int64_t b)
+{
+    if (!recorder) {
+        return;
+    }
+    uint64_t index = __atomic_fetch_add(&recorder->head, 1, __ATOMIC_RELAXED);
+    flight_record_t *record = &recorder->records[index & RECORD_MASK];
+    __atomic_store_n(&record->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    record->time = latency_trace_now();
+    record->type = (uint16_t) type;
+    record->id = id;
+    record->value = value;
+    record->a = a;
+    record->b = b;
+    __atomic_store_n(&record->seq, index + 1, __ATOMIC_RELEASE);
+}
+
+static int
+read_record(flight_recorder_t *recorder, uint64_t index, flight_record_t *copy)
+{
+    const flight_record_t *record = &recorder->records[index & RECORD_MASK];
+    uint64_t seq = __atomic_load_n(&record->seq, __ATOMIC_ACQUIRE);
+    if (seq != index + 1) {
+        return 0;
+    }
+    *copy = *record;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (__atomic_load_n(&record->seq, __ATOMIC_RELAXED) == seq);
+}
+
+int
+flight_recorder_dump(flight_recorder_t *recorder, const char *filename, int seconds)
+{
+    FILE *fp;
+    int count = 0;
+
+    assert(recorder);
+    if (__atomic_exchange_n(&recorder->dumping, 1, __ATOMIC_ACQUIRE)) {
+        logger_log(recorder->logger, LOGGER_DEBUG, "flight recorder dump already in progress");
+        return -1;
+    }
+    fp = fopen(filename, "w");
+    if (!fp) {
+        logger_log(recorder->logger, LOGGER_ERR, "could not open flight recorder file %s", filename);
+        __atomic_store_n(&recorder->dumping, 0, __ATOMIC_RELEASE);
+        return -1;
+    }
+
+    uint64_t now = latency_trace_now();
+    uint64_t since = now - (uint64_t) seconds * SECOND_IN_NSECS;
+    uint64_t head = __atomic_load_n(&recorder->head, __ATOMIC_ACQUIRE);
+    uint64_t first = (head > FLIGHT_RECORDER_RECORDS) ? head - FLIGHT_RECORDER_RECORDS : 0;
+    time_t now_secs = (time_t) (now / SECOND_IN_NSECS);
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&now_secs));
+
+    fprintf(fp, "# uxplay flight recorder, written %s; last %d seconds, times (secs) relative to now\n", date, seconds);
+    fprintf(fp, "# audio/audio_resent: seqnum rtp_timestamp length buffer_depth\n");
+    fprintf(fp, "# video: packet_type payload_size remote_ntp_timestamp\n");
+    fprintf(fp, "# ntp: dispersion_usecs offset_nsecs delay_nsecs\n");
+    for (uint64_t index = first; index < head; index++) {
+        flight_record_t record;
+        if (!read_record(recorder, index, &record) || record.time < since) {
+            continue;
+        }
+        double time = (double) ((int64_t) record.time - (int64_t) now) / SECOND_IN_NSECS;
+        const char *name = (record.type < sizeof(type_names) / sizeof(type_names[0])) ? type_names[record.type] : "?";
+        switch (record.type) {
+        case FLIGHT_RECORD_AUDIO:
+        case FLIGHT_RECORD_AUDIO_RESENT:
+            fprintf(fp, "%+.6f %s seqnum=%u rtp=%u length=%lld depth=%lld\n", time, name, record.id, record.value,
+                    (long long) record.a, (long long) record.b);
+            break;
+        case FLIGHT_RECORD_VIDEO:
+            fprintf(fp, "%+.6f %s type=0x%02x size=%u ntp=%llu\n", time, name, record.id, record.value,
+                    (unsigned long long) record.a);
+            break;
+        case FLIGHT_RECORD_NTP:
+            fprintf(fp, "%+.6f %s dispersion=%u offset=%lld delay=%lld\n", time, name, record.value,
+                    (long long) record.a, (long long) record.b);
+            break;
+        case FLIGHT_RECORD_NTP_TIMEOUT:
+            fprintf(fp, "%+.6f %s count=%u\n", time, name, record.value);
+            break;
+        case FLIGHT_RECORD_AUDIO_DELAY:
+        case FLIGHT_RECORD_VIDEO_DELAY:
+            fprintf(fp, "%+.6f %s delay=%.6f\n", time, name, (double) record.a / SECOND_IN_NSECS);
+            break;
+        case FLIGHT_RECORD_CONN_RESET:
+            fprintf(fp, "%+.6f %s source=%s timeouts=%u\n", time, name, record.id ? "mirror" : "ntp", record.value);
+            break;
+        default:
+            fprintf(fp, "%+.6f %s %u %u %lld %lld\n", time, name, record.id, record.value,
+                    (long long) record.a, (long long) record.b);
+            break;
+        }
+        count++;
+    }
+    fclose(fp);
+    __atomic_store_n(&recorder->dumping, 0, __ATOMIC_RELEASE);
+    logger_log(recorder->logger, LOGGER_INFO, "wrote %d flight recorder records to %s", count, filename);
+    return count;
+}
@@ -0,0 +1,69 @@
+/**
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *===================================================================
+ * UxPlay contributors 2026
+ */
+
+/* Always-on "flight recorder": a fixed-size ring of small records of recent packet  *
+ * arrivals, NTP samples, audio buffer depths and callback delays, which can be      *
+ * written to a file when the connection is lost (conn_reset) or on demand.          *
+ * Recording is lock-free (one atomic increment per record), so it can be left on.   *
+ *                                                                                   *
+ * Record fields, by type:                                                           *
+ *   AUDIO, AUDIO_RESENT  id = seqnum, value = rtp timestamp, a = length, b = depth  *
+ *   VIDEO                id = packet type, value = payload size, a = remote ntp ts  *
+ *   NTP                  value = dispersion (usecs), a, b = sample offset, delay    *
+ *   NTP_TIMEOUT          value = consecutive timeouts                               *
+ *   AUDIO_DELAY,         a = delay (nsecs) from packet reception to the audio or    *
+ *   VIDEO_DELAY          video callback (before the frame reaches the renderer)     *
+ *   CONN_RESET           id = source (0 ntp, 1 mirror), value = timeouts            */
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <stdint.h>
+#include "logger.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLIGHT_RECORDER_RECORDS 65536    /* must be a power of 2 (2.5 MB at 40 bytes per record) */
+#define FLIGHT_RECORDER_SECONDS 30       /* default time span written by flight_recorder_dump() */
+
+typedef enum flight_record_type_e {
+    FLIGHT_RECORD_AUDIO = 1,
+    FLIGHT_RECORD_AUDIO_RESENT,
+    FLIGHT_RECORD_VIDEO,
+    FLIGHT_RECORD_NTP,
+    FLIGHT_RECORD_NTP_TIMEOUT,
+    FLIGHT_RECORD_AUDIO_DELAY,
+    FLIGHT_RECORD_VIDEO_DELAY,
+    FLIGHT_RECORD_CONN_RESET,
+} flight_record_type_t;
+
+typedef struct flight_recorder_s flight_recorder_t;
+
+flight_recorder_t *flight_recorder_init(logger_t *logger);
+void flight_recorder_destroy(flight_recorder_t *recorder);
+
+/* recorder may be NULL (no recording) */
+void flight_recorder_add(flight_recorder_t *recorder, flight_record_type_t type, uint16_t id, uint32_t value,
+                         int64_t a, int64_t b);
+
+/* write the records of the last "seconds" seconds to filename; returns the number written, or -1 */
+int flight_recorder_dump(flight_recorder_t *recorder, const char *filename, int seconds);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //FLIGHT_RECORDER_H
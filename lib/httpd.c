@@ -26,6 +26,7 @@
 #include "http_request.h"
 #include "compat.h"
 #include "logger.h"
+#include "thread_policy.h"
 
 struct http_connection_s {
     int connected;
@@ -55,6 +56,9 @@ struct httpd_s {
     /* Server fds for accepting connections */
     int server_fd4;
     int server_fd6;
+
+    /* iterations of httpd_thread, read with relaxed atomics */
+    uint64_t loop_count;
 };
 
 int
@@ -87,6 +91,11 @@ httpd_count_connection_type (httpd_t *httpd, connection_type_t type) {
     return count;
 }
 
+uint64_t
+httpd_get_loop_count(httpd_t *httpd) {
+    return __atomic_load_n(&httpd->loop_count, __ATOMIC_RELAXED);
+}
+
 #define MAX_CONNECTIONS 12  /* value used in AppleTV 3*/
 httpd_t *
 httpd_init(logger_t *logger, httpd_callbacks_t *callbacks, int nohold)
@@ -247,6 +256,8 @@ httpd_thread(void *arg)
     bool logger_debug = (logger_get_level(httpd->logger) >= LOGGER_DEBUG);
     
     assert(httpd);
+    THREAD_SET_NAME("httpd");
+    thread_policy_apply(THREAD_ROLE_HTTPD, httpd->logger);
 
     while (1) {
         fd_set rfds;
@@ -260,6 +271,7 @@ httpd_thread(void *arg)
             break;
         }
         MUTEX_UNLOCK(httpd->run_mutex);
+        __atomic_fetch_add(&httpd->loop_count, 1, __ATOMIC_RELAXED);
 
         /* Set timeout value to 5ms */
         tv.tv_sec = 1;
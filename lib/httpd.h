@@ -15,6 +15,7 @@
 #ifndef HTTPD_H
 #define HTTPD_H
 
+#include <stdint.h>
 #include "logger.h"
 #include "http_request.h"
 #include "http_response.h"
@@ -37,6 +38,7 @@ typedef struct httpd_callbacks_s httpd_callbacks_t;
 
 int httpd_set_connection_type (httpd_t *http, void *user_data, connection_type_t type);
 int httpd_count_connection_type (httpd_t *http, connection_type_t type);
+uint64_t httpd_get_loop_count(httpd_t *httpd);
 
 httpd_t *httpd_init(logger_t *logger, httpd_callbacks_t *callbacks, int  nohold);
 
@@ -0,0 +1,128 @@
+/**
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *===================================================================
+ * UxPlay contributors 2026
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "keyframe_cache.h"
+#include "threads.h"
+
+struct keyframe_cache_s {
+    mutex_handle_t mutex;
+    unsigned char *sps_pps;
+    int sps_pps_len;
+    unsigned char *idr;        /* buffer is kept (and grown) between IDR frames */
+    int idr_len;
+    int idr_size;
+    int idr_nal_count;
+};
+
+keyframe_cache_t *
+keyframe_cache_init()
+{
+    keyframe_cache_t *cache = calloc(1, sizeof(keyframe_cache_t));
+    if (!cache) {
+        return NULL;
+    }
+    MUTEX_CREATE(cache->mutex);
+    return cache;
+}
+
+void
+keyframe_cache_destroy(keyframe_cache_t *cache)
+{
+    if (cache) {
+        MUTEX_DESTROY(cache->mutex);
+        free(cache->sps_pps);
+        free(cache->idr);
+        free(cache);
+    }
+}
+
+void
+keyframe_cache_clear(keyframe_cache_t *cache)
+{
+    assert(cache);
+    MUTEX_LOCK(cache->mutex);
+    free(cache->sps_pps);
+    cache->sps_pps = NULL;
+    cache->sps_pps_len = 0;
+    cache->idr_len = 0;
+    MUTEX_UNLOCK(cache->mutex);
+}
+
+void
+keyframe_cache_set_sps_pps(keyframe_cache_t *cache, const unsigned char *sps_pps, int len)
+{
+    unsigned char *copy = malloc(len);
+    assert(cache);
+    if (!copy) {
+        return;
+    }
+    memcpy(copy, sps_pps, len);
+    MUTEX_LOCK(cache->mutex);
+    free(cache->sps_pps);
+    cache->sps_pps = copy;
+    cache->sps_pps_len = len;
+    /* the cached IDR frame may not be decodable with the new parameter sets */
+    cache->idr_len = 0;
+    MUTEX_UNLOCK(cache->mutex);
+}
+
+void
+keyframe_cache_set_idr(keyframe_cache_t *cache, const unsigned char *data, int len, int nal_count)
+{
+    assert(cache);
+    MUTEX_LOCK(cache->mutex);
+    if (len > cache->idr_size) {
+        unsigned char *idr = realloc(cache->idr, len);
+        if (!idr) {
+            cache->idr_len = 0;
+            MUTEX_UNLOCK(cache->mutex);
+            return;
+        }
+        cache->idr = idr;
+        cache->idr_size = len;
+    }
+    memcpy(cache->idr, data, len);
+    cache->idr_len = len;
+    cache->idr_nal_count = nal_count;
+    MUTEX_UNLOCK(cache->mutex);
+}
+
+unsigned char *
+keyframe_cache_take(keyframe_cache_t *cache, int *len, int *nal_count)
+{
+    unsigned char *data = NULL;
+    assert(cache);
+    MUTEX_LOCK(cache->mutex);
+    if (cache->idr_len > 4) {
+        /* data starts with a 4-byte start code; nal type 7 = SPS */
+        int prepend = ((cache->idr[4] & 0x1f) != 7 && cache->sps_pps) ? cache->sps_pps_len : 0;
+        data = malloc(prepend + cache->idr_len);
+        if (data) {
+            if (prepend) {
+                memcpy(data, cache->sps_pps, prepend);
+            }
+            memcpy(data + prepend, cache->idr, cache->idr_len);
+            *len = prepend + cache->idr_len;
+            *nal_count = cache->idr_nal_count + (prepend ? 2 : 0);
+        }
+        cache->idr_len = 0;
+    }
+    MUTEX_UNLOCK(cache->mutex);
+    return data;
+}
@@ -0,0 +1,37 @@
+/**
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *===================================================================
+ * UxPlay contributors 2026
+ */
+
+/* Most recent SPS+PPS and IDR access unit (h264 byte-stream format) of the mirror stream,  *
+ * so that a relaunched video renderer can show a picture without waiting for the client's  *
+ * next IDR frame, which can take many seconds if the screen content is static.             */
+
+#ifndef KEYFRAME_CACHE_H
+#define KEYFRAME_CACHE_H
+
+#include <stdint.h>
+
+typedef struct keyframe_cache_s keyframe_cache_t;
+
+keyframe_cache_t *keyframe_cache_init();
+void keyframe_cache_destroy(keyframe_cache_t *cache);
+void keyframe_cache_clear(keyframe_cache_t *cache);
+void keyframe_cache_set_sps_pps(keyframe_cache_t *cache, const unsigned char *sps_pps, int len);
+void keyframe_cache_set_idr(keyframe_cache_t *cache, const unsigned char *data, int len, int nal_count);
+
+/* returns a malloc'ed copy of the IDR access unit (with the SPS+PPS prepended, if needed), and *
+ * removes it from the cache, so a renderer that fails on it is not primed with it again.       */
+unsigned char *keyframe_cache_take(keyframe_cache_t *cache, int *len, int *nal_count);
+
+#endif //KEYFRAME_CACHE_H
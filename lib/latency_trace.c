@@ -0,0 +1,255 @@
+/**
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *===================================================================
+ * UxPlay contributors 2026
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include "latency_trace.h"
+#include "threads.h"
+#include "logger.h"
+
+#define SECOND_IN_NSECS 1000000000UL
+#define LATENCY_TRACE_PENDING 64       /* open records per stream */
+#define LATENCY_TRACE_RECORDS 16384    /* completed records kept for export (most recent) */
+
+typedef struct latency_trace_record_s {
+    uint64_t id;
+    uint64_t seq;                      /* order of creation, 0 = unused slot */
+    uint64_t time[LATENCY_TRACE_STAGES];
+    unsigned char stages;              /* bitmask of recorded stages */
+    unsigned char stream;
+} latency_trace_record_t;
+
+struct latency_trace_s {
+    logger_t *logger;
+    mutex_handle_t mutex;
+
+    uint64_t seq;
+    latency_trace_record_t pending[LATENCY_TRACE_STREAMS][LATENCY_TRACE_PENDING];
+    unsigned int pending_index[LATENCY_TRACE_STREAMS];
+    uint64_t dropped[LATENCY_TRACE_STREAMS];
+
+    latency_trace_record_t *completed;
+    unsigned int completed_index;
+    unsigned int completed_count;
+
+    metrics_histogram_t histogram[LATENCY_TRACE_STREAMS][LATENCY_TRACE_STAGES];
+};
+
+static const char *stage_names[LATENCY_TRACE_STAGES] = { "receive", "decrypt", "push", "decode", "render" };
+static const char *stream_names[LATENCY_TRACE_STREAMS] = { "audio", "video" };
+
+latency_trace_t *
+latency_trace_init(logger_t *logger)
+{
+    latency_trace_t *trace = calloc(1, sizeof(latency_trace_t));
+    if (!trace) {
+        return NULL;
+    }
+    trace->completed = calloc(LATENCY_TRACE_RECORDS, sizeof(latency_trace_record_t));
+    if (!trace->completed) {
+        free(trace);
+        return NULL;
+    }
+    trace->logger = logger;
+    MUTEX_CREATE(trace->mutex);
+    return trace;
+}
+
+void
+latency_trace_destroy(latency_trace_t *trace)
+{
+    if (trace) {
+        MUTEX_DESTROY(trace->mutex);
+        free(trace->completed);
+        free(trace);
+    }
+}
+
+uint64_t
+latency_trace_now()
+{
+    /* same clock as raop_ntp_get_local_time() */
+    struct timespec time;
+    clock_gettime(CLOCK_REALTIME, &time);
+    return ((uint64_t) time.tv_nsec) + (uint64_t) time.tv_sec * SECOND_IN_NSECS;
+}
+
+const char *
+latency_trace_stage_name(latency_trace_stage_t stage)
+{
+    return stage_names[stage];
+}
+
+void
+latency_trace_begin(latency_trace_t *trace, latency_trace_stream_t stream, uint64_t id,
+                    uint64_t time_received, uint64_t time_decrypted)
+{
+    assert(trace);
+    MUTEX_LOCK(trace->mutex);
+    latency_trace_record_t *record = &trace->pending[stream][trace->pending_index[stream]];
+    trace->pending_index[stream] = (trace->pending_index[stream] + 1) % LATENCY_TRACE_PENDING;
+    if (record->seq) {
+        /* this record never reached the sink (dropped by the renderer or decoder) */
+        trace->dropped[stream]++;
+    }
+    memset(record, 0, sizeof(latency_trace_record_t));
+    record->id = id;
+    record->seq = ++trace->seq;
+    record->stream = (unsigned char) stream;
+    record->time[LATENCY_TRACE_RECEIVE] = time_received;
+    record->time[LATENCY_TRACE_DECRYPT] = time_decrypted;
+    record->stages = (1 << LATENCY_TRACE_RECEIVE) | (1 << LATENCY_TRACE_DECRYPT);
+    MUTEX_UNLOCK(trace->mutex);
+}
+
+static void
+latency_trace_complete(latency_trace_t *trace, latency_trace_record_t *record)
+{
+    metrics_histogram_t *histogram = trace->histogram[record->stream];
+    for (int stage = LATENCY_TRACE_DECRYPT; stage < LATENCY_TRACE_STAGES; stage++) {
+        if ((record->stages >> (stage - 1) & 3) == 3) {
+            metrics_histogram_observe(&histogram[stage], (int64_t) (record->time[stage] - record->time[stage - 1]));
+        }
+    }
+    metrics_histogram_observe(&histogram[LATENCY_TRACE_RECEIVE],
+                              (int64_t) (record->time[LATENCY_TRACE_RENDER] - record->time[LATENCY_TRACE_RECEIVE]));
+
+    trace->completed[trace->completed_index] = *record;
+    trace->completed_index = (trace->completed_index + 1) % LATENCY_TRACE_RECORDS;
+    if (trace->completed_count < LATENCY_TRACE_RECORDS) {
+        trace->completed_count++;
+    }
+    record->seq = 0;
+}
+
+void
+latency_trace_stage(latency_trace_t *trace, latency_trace_stream_t stream, uint64_t id,
+                    latency_trace_stage_t stage, uint64_t time)
+{
+    latency_trace_record_t *record = NULL;
+    assert(trace);
+    assert(stage > LATENCY_TRACE_DECRYPT);
+
+    MUTEX_LOCK(trace->mutex);
+    for (int i = 0; i < LATENCY_TRACE_PENDING; i++) {
+        latency_trace_record_t *candidate = &trace->pending[stream][i];
+        if (!candidate->seq || (candidate->stages & (1 << stage)) || !(candidate->stages & (1 << (stage - 1)))) {
+            continue;
+        }
+        if (id != LATENCY_TRACE_NEXT && candidate->id != id) {
+            continue;
+        }
+        if (!record || candidate->seq < record->seq) {
+            record = candidate;
+        }
+    }
+    if (record) {
+        record->time[stage] = time;
+        record->stages |= (1 << stage);
+        if (stage == LATENCY_TRACE_RENDER) {
+            latency_trace_complete(trace, record);
+        }
+    }
+    MUTEX_UNLOCK(trace->mutex);
+}
+
+const metrics_histogram_t *
+latency_trace_get_histogram(latency_trace_t *trace, latency_trace_stream_t stream, latency_trace_stage_t stage)
+{
+    assert(trace);
+    return &trace->histogram[stream][stage];
+}
+
+void
+latency_trace_log_summary(latency_trace_t *trace)
+{
+    assert(trace);
+    for (int stream = 0; stream < LATENCY_TRACE_STREAMS; stream++) {
+        const metrics_histogram_t *total = &trace->histogram[stream][LATENCY_TRACE_RECEIVE];
+        if (!total->count) {
+            continue;
+        }
+        char line[256];
+        int len = snprintf(line, sizeof(line), "%s latency (mean, ms):", stream_names[stream]);
+        for (int stage = LATENCY_TRACE_DECRYPT; stage < LATENCY_TRACE_STAGES; stage++) {
+            const metrics_histogram_t *histogram = &trace->histogram[stream][stage];
+            if (histogram->count && len < (int) sizeof(line)) {
+                len += snprintf(line + len, sizeof(line) - len, " %s %.3f", stage_names[stage],
+                                (double) histogram->sum / histogram->count / 1000000.0);
+            }
+        }
+        logger_log(trace->logger, LOGGER_INFO, "%s; total %.3f (%llu traced, %llu dropped)", line,
+                   (double) total->sum / total->count / 1000000.0, (unsigned long long) total->count,
+                   (unsigned long long) trace->dropped[stream]);
+    }
+}
+
+static void
+write_event(FILE *fp, const latency_trace_record_t *record, const char *name, char phase, uint64_t time, int *first)
+{
+    fprintf(fp, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"id\":%llu,\"pid\":1,\"tid\":%d,"
+            "\"ts\":%llu.%03llu}", *first ? "" : ",", name, stream_names[record->stream], phase,
+            (unsigned long long) record->seq, record->stream + 1,
+            (unsigned long long) (time / 1000), (unsigned long long) (time % 1000));
+    *first = 0;
+}
+
+/* Chrome Trace Event Format (chrome://tracing, https://ui.perfetto.dev): each traced frame or    *
+ * packet is an async slice from RECEIVE to RENDER, with a nested slice for each following stage. */
+int
+latency_trace_write_json(latency_trace_t *trace, const char *filename)
+{
+    FILE *fp;
+    int first = 1;
+    unsigned int count;
+
+    assert(trace);
+    fp = fopen(filename, "w");
+    if (!fp) {
+        logger_log(trace->logger, LOGGER_ERR, "could not open latency trace file %s", filename);
+        return -1;
+    }
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (int stream = 0; stream < LATENCY_TRACE_STREAMS; stream++) {
+        fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",", stream + 1, stream_names[stream]);
+        first = 0;
+    }
+
+    MUTEX_LOCK(trace->mutex);
+    count = trace->completed_count;
+    unsigned int start = (trace->completed_index + LATENCY_TRACE_RECORDS - count) % LATENCY_TRACE_RECORDS;
+    for (unsigned int n = 0; n < count; n++) {
+        const latency_trace_record_t *record = &trace->completed[(start + n) % LATENCY_TRACE_RECORDS];
+        write_event(fp, record, "frame", 'b', record->time[LATENCY_TRACE_RECEIVE], &first);
+        for (int stage = LATENCY_TRACE_DECRYPT; stage < LATENCY_TRACE_STAGES; stage++) {
+            if ((record->stages >> (stage - 1) & 3) == 3) {
+                write_event(fp, record, stage_names[stage], 'b', record->time[stage - 1], &first);
+                write_event(fp, record, stage_names[stage], 'e', record->time[stage], &first);
+            }
+        }
+        write_event(fp, record, "frame", 'e', record->time[LATENCY_TRACE_RENDER], &first);
+    }
+    MUTEX_UNLOCK(trace->mutex);
+
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    logger_log(trace->logger, LOGGER_INFO, "wrote %u latency trace records to %s", count, filename);
+    return 0;
+}
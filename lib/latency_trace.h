@@ -0,0 +1,77 @@
+/**
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *===================================================================
+ * UxPlay contributors 2026
+ */
+
+/* Follows each video frame and audio packet through the receiver:                *
+ *   RECEIVE  payload read from the socket         (raop_rtp, raop_rtp_mirror)     *
+ *   DECRYPT  payload decrypted                    (raop_buffer, raop_rtp_mirror)  *
+ *   PUSH     buffer pushed into the appsrc        (renderers)                     *
+ *   DECODE   buffer leaves the decoder            (renderer pad probe)            *
+ *   RENDER   buffer reaches (is due at) the sink  (renderer pad probe)            *
+ * All times are local wall-clock nsecs, as returned by raop_ntp_get_local_time(). *
+ * A trace record is identified by the ntp timestamp given to the renderer; pad    *
+ * probes on buffers without timestamps (no sync) use LATENCY_TRACE_NEXT, which    *
+ * matches the oldest open record that has not yet reached that stage.             */
+
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <stdint.h>
+#include "logger.h"
+#include "metrics.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LATENCY_TRACE_NEXT UINT64_MAX
+
+typedef enum latency_trace_stream_e {
+    LATENCY_TRACE_AUDIO,
+    LATENCY_TRACE_VIDEO,
+    LATENCY_TRACE_STREAMS
+} latency_trace_stream_t;
+
+typedef enum latency_trace_stage_e {
+    LATENCY_TRACE_RECEIVE,
+    LATENCY_TRACE_DECRYPT,
+    LATENCY_TRACE_PUSH,
+    LATENCY_TRACE_DECODE,
+    LATENCY_TRACE_RENDER,
+    LATENCY_TRACE_STAGES
+} latency_trace_stage_t;
+
+typedef struct latency_trace_s latency_trace_t;
+
+latency_trace_t *latency_trace_init(logger_t *logger);
+void latency_trace_destroy(latency_trace_t *trace);
+
+uint64_t latency_trace_now();
+void latency_trace_begin(latency_trace_t *trace, latency_trace_stream_t stream, uint64_t id,
+                         uint64_t time_received, uint64_t time_decrypted);
+void latency_trace_stage(latency_trace_t *trace, latency_trace_stream_t stream, uint64_t id,
+                         latency_trace_stage_t stage, uint64_t time);
+
+/* histogram of the time taken to reach "stage" from the previous stage;   *
+ * for LATENCY_TRACE_RECEIVE, the total time from RECEIVE to RENDER        */
+const metrics_histogram_t *latency_trace_get_histogram(latency_trace_t *trace, latency_trace_stream_t stream,
+                                                       latency_trace_stage_t stage);
+const char *latency_trace_stage_name(latency_trace_stage_t stage);
+void latency_trace_log_summary(latency_trace_t *trace);
+int latency_trace_write_json(latency_trace_t *trace, const char *filename);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //LATENCY_TRACE_H
@@ -0,0 +1,465 @@
+/**
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *===================================================================
+ * UxPlay contributors 2026
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <stdbool.h>
+#ifdef __linux__
+#include <dirent.h>
+#endif
+
+#include "metrics.h"
+#include "netutils.h"
+#include "compat.h"
+#include "logger.h"
+
+#define SECOND_IN_NSECS 1000000000UL
+#define METRICS_REQUEST_LEN 2048
+#define METRICS_CONTENT_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+/* upper bounds of the histogram buckets, in seconds */
+static const double histogram_bounds[METRICS_HISTOGRAM_BUCKETS] = {
+    0.0001, 0.00025, 0.0005, 0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.3, 0.5, 1.0, 2.0, 5.0, 10.0
+};
+
+struct metrics_s {
+    logger_t *logger;
+    metrics_collect_cb_t collect;
+    void *cls;
+
+    int server_fd;
+
+    /* These variables only edited mutex locked */
+    int running;
+    int joined;
+    thread_handle_t thread;
+    mutex_handle_t run_mutex;
+};
+
+metrics_t *
+metrics_init(logger_t *logger, metrics_collect_cb_t collect, void *cls)
+{
+    metrics_t *metrics;
+
+    assert(logger);
+    assert(collect);
+
+    metrics = calloc(1, sizeof(metrics_t));
+    if (!metrics) {
+        return NULL;
+    }
+    metrics->logger = logger;
+    metrics->collect = collect;
+    metrics->cls = cls;
+    metrics->server_fd = -1;
+    metrics->running = 0;
+    metrics->joined = 1;
+    MUTEX_CREATE(metrics->run_mutex);
+    return metrics;
+}
+
+void
+metrics_destroy(metrics_t *metrics)
+{
+    if (metrics) {
+        metrics_stop(metrics);
+        MUTEX_DESTROY(metrics->run_mutex);
+        free(metrics);
+    }
+}
+
+void
+metrics_printf(metrics_buffer_t *buf, const char *format, ...)
+{
+    va_list args;
+    int len;
+
+    assert(buf);
+    va_start(args, format);
+    len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (len < 0) {
+        return;
+    }
+    if (buf->len + len + 1 > buf->size) {
+        size_t size = buf->size ? buf->size : 4096;
+        while (buf->len + len + 1 > size) {
+            size *= 2;
+        }
+        char *data = realloc(buf->data, size);
+        if (!data) {
+            return;
+        }
+        buf->data = data;
+        buf->size = size;
+    }
+    va_start(args, format);
+    vsnprintf(buf->data + buf->len, buf->size - buf->len, format, args);
+    va_end(args);
+    buf->len += len;
+}
+
+void
+metrics_counter(metrics_buffer_t *buf, const char *name, const char *help, uint64_t value)
+{
+    metrics_printf(buf, "# TYPE %s counter\n# HELP %s %s\n%s_total %llu\n",
+                   name, name, help, name, (unsigned long long) value);
+}
+
+void
+metrics_gauge(metrics_buffer_t *buf, const char *name, const char *help, double value)
+{
+    metrics_printf(buf, "# TYPE %s gauge\n# HELP %s %s\n%s %.9g\n", name, name, help, name, value);
+}
+
+void
+metrics_histogram_observe(metrics_histogram_t *histogram, int64_t value_ns)
+{
+    int i;
+    double value;
+
+    assert(histogram);
+    if (value_ns < 0) {
+        value_ns = 0;
+    }
+    value = (double) value_ns / SECOND_IN_NSECS;
+    for (i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        if (value <= histogram_bounds[i]) {
+            break;
+        }
+    }
+    __atomic_fetch_add(&histogram->bucket[i], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->sum, (uint64_t) value_ns, __ATOMIC_RELAXED);
+}
+
+void
+metrics_histogram(metrics_buffer_t *buf, const char *name, const char *help,
+                  const metrics_histogram_t *histogram)
+{
+    uint64_t cumulative = 0;
+
+    metrics_printf(buf, "# TYPE %s histogram\n# HELP %s %s\n", name, name, help);
+    for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        cumulative += __atomic_load_n(&histogram->bucket[i], __ATOMIC_RELAXED);
+        metrics_printf(buf, "%s_bucket{le=\"%g\"} %llu\n", name, histogram_bounds[i], (unsigned long long) cumulative);
+    }
+    cumulative += __atomic_load_n(&histogram->bucket[METRICS_HISTOGRAM_BUCKETS], __ATOMIC_RELAXED);
+    metrics_printf(buf, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long) cumulative);
+    /* use the bucket total for _count, so that it always matches the +Inf bucket */
+    metrics_printf(buf, "%s_count %llu\n", name, (unsigned long long) cumulative);
+    metrics_printf(buf, "%s_sum %.9g\n", name,
+                   (double) __atomic_load_n(&histogram->sum, __ATOMIC_RELAXED) / SECOND_IN_NSECS);
+}
+
+/* estimate of the q-quantile (0 < q < 1) of the observations, in seconds, by linear  *
+ * interpolation within a bucket (as histogram_quantile() in Prometheus); returns -1 if *
+ * there are no observations, or the largest bound if the quantile is beyond it.       */
+double
+metrics_histogram_quantile(const metrics_histogram_t *histogram, double q)
+{
+    uint64_t counts[METRICS_HISTOGRAM_BUCKETS + 1];
+    uint64_t total = 0;
+    uint64_t cumulative = 0;
+
+    assert(histogram);
+    for (int i = 0; i <= METRICS_HISTOGRAM_BUCKETS; i++) {
+        counts[i] = __atomic_load_n(&histogram->bucket[i], __ATOMIC_RELAXED);
+        total += counts[i];
+    }
+    if (!total) {
+        return -1.0;
+    }
+    double rank = q * (double) total;
+    for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        if (counts[i] && (double) (cumulative + counts[i]) >= rank) {
+            double lower = i ? histogram_bounds[i - 1] : 0.0;
+            return lower + (histogram_bounds[i] - lower) * (rank - (double) cumulative) / (double) counts[i];
+        }
+        cumulative += counts[i];
+    }
+    return histogram_bounds[METRICS_HISTOGRAM_BUCKETS - 1];
+}
+
+/* per-thread cpu time, from /proc/self/task/<tid>/stat (Linux only).     *
+ * Thread names are those set with THREAD_SET_NAME (or by GStreamer).    */
+void
+metrics_thread_cpu(metrics_buffer_t *buf, const char *name)
+{
+#ifdef __linux__
+    DIR *dir = opendir("/proc/self/task");
+    struct dirent *entry;
+    long ticks = sysconf(_SC_CLK_TCK);
+
+    if (!dir || ticks <= 0) {
+        if (dir) closedir(dir);
+        return;
+    }
+    metrics_printf(buf, "# TYPE %s counter\n# HELP %s %s\n", name, name, "CPU time used by each thread");
+    while ((entry = readdir(dir))) {
+        char path[288], stat[512], comm[32] = { 0 };
+        unsigned long utime, stime;
+        FILE *fp;
+        char *p;
+
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
+        }
+        snprintf(path, sizeof(path), "/proc/self/task/%s/stat", entry->d_name);
+        fp = fopen(path, "r");
+        if (!fp) {
+            continue;
+        }
+        p = fgets(stat, sizeof(stat), fp);
+        fclose(fp);
+        if (!p) {
+            continue;
+        }
+        /* stat is "tid (comm) state ...": comm may itself contain spaces or ')' */
+        char *open = strchr(stat, '(');
+        char *close = strrchr(stat, ')');
+        if (!open || !close || close < open) {
+            continue;
+        }
+        if (sscanf(close + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) {
+            continue;
+        }
+        /* label values must not contain quotes, backslashes or newlines */
+        int j = 0;
+        for (p = open + 1; p < close && j < (int) sizeof(comm) - 1; p++) {
+            comm[j++] = (*p == '"' || *p == '\\' || *p == '\n') ? '_' : *p;
+        }
+        metrics_printf(buf, "%s_total{thread=\"%s\",tid=\"%s\",mode=\"user\"} %.2f\n",
+                       name, comm, entry->d_name, (double) utime / ticks);
+        metrics_printf(buf, "%s_total{thread=\"%s\",tid=\"%s\",mode=\"system\"} %.2f\n",
+                       name, comm, entry->d_name, (double) stime / ticks);
+    }
+    closedir(dir);
+#endif
+}
+
+static void
+metrics_send(int fd, const char *data, size_t len)
+{
+    while (len > 0) {
+        int ret = send(fd, data, len, 0);
+        if (ret <= 0) {
+            break;
+        }
+        data += ret;
+        len -= ret;
+    }
+}
+
+static void
+metrics_handle_client(metrics_t *metrics, int fd)
+{
+    char request[METRICS_REQUEST_LEN];
+    int len = 0;
+    char header[256];
+
+    /* read the request line and headers; the request body (if any) is ignored */
+    while (len < (int) sizeof(request) - 1) {
+        int ret = recv(fd, request + len, sizeof(request) - 1 - len, 0);
+        if (ret <= 0) {
+            break;
+        }
+        len += ret;
+        request[len] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) {
+            break;
+        }
+    }
+    request[len] = '\0';
+
+    if (strncmp(request, "GET /metrics ", 13) && strncmp(request, "GET / ", 6)) {
+        const char not_found[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        logger_log(metrics->logger, LOGGER_DEBUG, "metrics: unsupported request \"%.32s\"", request);
+        metrics_send(fd, not_found, strlen(not_found));
+        return;
+    }
+
+    metrics_buffer_t buf = { NULL, 0, 0 };
+    metrics->collect(metrics->cls, &buf);
+    metrics_printf(&buf, "# EOF\n");
+    if (!buf.data) {
+        return;
+    }
+    snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+             "Connection: close\r\n\r\n", METRICS_CONTENT_TYPE, buf.len);
+    metrics_send(fd, header, strlen(header));
+    metrics_send(fd, buf.data, buf.len);
+    free(buf.data);
+}
+
+static THREAD_RETVAL
+metrics_thread(void *arg)
+{
+    metrics_t *metrics = arg;
+    assert(metrics);
+    THREAD_SET_NAME("metrics");
+
+    while (1) {
+        fd_set rfds;
+        struct timeval tv;
+        int ret;
+
+        MUTEX_LOCK(metrics->run_mutex);
+        if (!metrics->running) {
+            MUTEX_UNLOCK(metrics->run_mutex);
+            break;
+        }
+        MUTEX_UNLOCK(metrics->run_mutex);
+
+        /* Set timeout value to 1s, so metrics_stop() is noticed */
+        tv.tv_sec = 1;
+        tv.tv_usec = 0;
+
+        FD_ZERO(&rfds);
+        FD_SET(metrics->server_fd, &rfds);
+        ret = select(metrics->server_fd + 1, &rfds, NULL, NULL, &tv);
+        if (ret == 0) {
+            continue;
+        } else if (ret == -1 && SOCKET_GET_ERROR() == SOCKET_ERRORNAME(EINTR)) {
+            /* e.g. SIGUSR1 or SIGUSR2 was delivered to this thread */
+            continue;
+        } else if (ret == -1) {
+            logger_log(metrics->logger, LOGGER_ERR, "metrics error in select");
+            break;
+        }
+
+        struct sockaddr_storage saddr;
+        socklen_t saddrlen = sizeof(saddr);
+        int fd = accept(metrics->server_fd, (struct sockaddr *) &saddr, &saddrlen);
+        if (fd == -1) {
+            continue;
+        }
+        /* a scraper that stalls must not hold up the next one for long */
+        struct timeval timeout;
+        timeout.tv_sec = 2;
+        timeout.tv_usec = 0;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (const char *) &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, (const char *) &timeout, sizeof(timeout));
+        metrics_handle_client(metrics, fd);
+        closesocket(fd);
+    }
+
+    MUTEX_LOCK(metrics->run_mutex);
+    metrics->running = 0;
+    MUTEX_UNLOCK(metrics->run_mutex);
+    logger_log(metrics->logger, LOGGER_DEBUG, "metrics exiting thread");
+    return 0;
+}
+
+/* like netutils_init_socket(), but bound to the IPv4 address (not to all interfaces) */
+static int
+metrics_init_socket(const char *address, unsigned short *port)
+{
+    struct sockaddr_in saddr;
+    socklen_t socklen = sizeof(saddr);
+    int server_fd;
+    int ret;
+#ifndef _WIN32
+    int reuseaddr = 1;
+#else
+    const char reuseaddr = 1;
+#endif
+
+    memset(&saddr, 0, sizeof(saddr));
+    saddr.sin_family = AF_INET;
+    saddr.sin_port = htons(*port);
+    if (inet_pton(AF_INET, address, &saddr.sin_addr) != 1) {
+        SOCKET_SET_ERROR(SOCKET_ERRORNAME(EINVAL));
+        return -1;
+    }
+    server_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (server_fd == -1) {
+        return -1;
+    }
+    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &reuseaddr, sizeof (reuseaddr)) == -1 ||
+        bind(server_fd, (struct sockaddr *) &saddr, socklen) == -1 ||
+        getsockname(server_fd, (struct sockaddr *) &saddr, &socklen) == -1) {
+        ret = SOCKET_GET_ERROR();
+        closesocket(server_fd);
+        SOCKET_SET_ERROR(ret);
+        return -1;
+    }
+    *port = ntohs(saddr.sin_port);
+    return server_fd;
+}
+
+int
+metrics_start(metrics_t *metrics, const char *address, unsigned short *port)
+{
+    assert(metrics);
+    assert(port);
+
+    if (!address) {
+        address = METRICS_DEFAULT_ADDRESS;
+    }
+    MUTEX_LOCK(metrics->run_mutex);
+    if (metrics->running || !metrics->joined) {
+        MUTEX_UNLOCK(metrics->run_mutex);
+        return 0;
+    }
+    metrics->server_fd = metrics_init_socket(address, port);
+    if (metrics->server_fd == -1) {
+        logger_log(metrics->logger, LOGGER_ERR, "metrics: error initialising socket %d", SOCKET_GET_ERROR());
+        MUTEX_UNLOCK(metrics->run_mutex);
+        return -1;
+    }
+    if (listen(metrics->server_fd, 5) == -1) {
+        logger_log(metrics->logger, LOGGER_ERR, "metrics: error listening to socket");
+        closesocket(metrics->server_fd);
+        metrics->server_fd = -1;
+        MUTEX_UNLOCK(metrics->run_mutex);
+        return -2;
+    }
+    logger_log(metrics->logger, LOGGER_INFO, "metrics: serving OpenMetrics at http://%s:%u/metrics", address, *port);
+
+    metrics->running = 1;
+    metrics->joined = 0;
+    THREAD_CREATE(metrics->thread, metrics_thread, metrics);
+    MUTEX_UNLOCK(metrics->run_mutex);
+    return 1;
+}
+
+void
+metrics_stop(metrics_t *metrics)
+{
+    assert(metrics);
+
+    /* the thread may have ended by itself (after an error), so it is joined unless it already was */
+    MUTEX_LOCK(metrics->run_mutex);
+    if (metrics->joined) {
+        MUTEX_UNLOCK(metrics->run_mutex);
+        return;
+    }
+    metrics->running = 0;
+    MUTEX_UNLOCK(metrics->run_mutex);
+
+    THREAD_JOIN(metrics->thread);
+    if (metrics->server_fd != -1) {
+        closesocket(metrics->server_fd);
+        metrics->server_fd = -1;
+    }
+
+    MUTEX_LOCK(metrics->run_mutex);
+    metrics->joined = 1;
+    MUTEX_UNLOCK(metrics->run_mutex);
+}
@@ -0,0 +1,71 @@
+/**
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *===================================================================
+ * UxPlay contributors 2026
+ */
+
+/* A minimal HTTP listener that serves OpenMetrics text on "GET /metrics".   *
+ * It is independent of the RTSP server in httpd.c: it has its own socket    *
+ * and thread, and the page content is produced by a collect callback.       */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "logger.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct metrics_s metrics_t;
+
+typedef struct metrics_buffer_s {
+    char *data;
+    size_t len;
+    size_t size;
+} metrics_buffer_t;
+
+typedef void (*metrics_collect_cb_t)(void *cls, metrics_buffer_t *buf);
+
+/* latency histogram with fixed bucket bounds (in seconds, see metrics.c);   *
+ * observations are in nanoseconds, and are recorded with relaxed atomics.   */
+#define METRICS_HISTOGRAM_BUCKETS 17
+typedef struct metrics_histogram_s {
+    uint64_t bucket[METRICS_HISTOGRAM_BUCKETS + 1];   /* last is +Inf, non-cumulative */
+    uint64_t count;
+    uint64_t sum;
+} metrics_histogram_t;
+
+metrics_t *metrics_init(logger_t *logger, metrics_collect_cb_t collect, void *cls);
+/* serve GET /metrics on the IPv4 address (METRICS_DEFAULT_ADDRESS if NULL) and TCP port *port (0: any) */
+#define METRICS_DEFAULT_ADDRESS "127.0.0.1"
+int metrics_start(metrics_t *metrics, const char *address, unsigned short *port);
+void metrics_stop(metrics_t *metrics);
+void metrics_destroy(metrics_t *metrics);
+
+void metrics_histogram_observe(metrics_histogram_t *histogram, int64_t value_ns);
+double metrics_histogram_quantile(const metrics_histogram_t *histogram, double q);
+
+/* OpenMetrics text helpers, for use inside the collect callback */
+void metrics_printf(metrics_buffer_t *buf, const char *format, ...);
+void metrics_counter(metrics_buffer_t *buf, const char *name, const char *help, uint64_t value);
+void metrics_gauge(metrics_buffer_t *buf, const char *name, const char *help, double value);
+void metrics_histogram(metrics_buffer_t *buf, const char *name, const char *help,
+                       const metrics_histogram_t *histogram);
+void metrics_thread_cpu(metrics_buffer_t *buf, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //METRICS_H
@@ -114,6 +114,24 @@ void mirror_buffer_decrypt(mirror_buffer_t *mirror_buffer, unsigned char* input,
     }
 }
 
+/* leaves the decryption state as mirror_buffer_decrypt() would after a packet of inputLen bytes, *
+ * without decrypting it: only the keystream block for a partial last block is computed           */
+void mirror_buffer_skip(mirror_buffer_t *mirror_buffer, int inputLen) {
+    int skiplen = ((inputLen - mirror_buffer->nextDecryptCount) / 16) * 16;
+    int restlen = (inputLen - mirror_buffer->nextDecryptCount) % 16;
+    aes_ctr_start_fresh_block(mirror_buffer->aes_ctx);
+    if (skiplen > 0) {
+        aes_ctr_skip(mirror_buffer->aes_ctx, (uint64_t) skiplen);
+    }
+    mirror_buffer->nextDecryptCount = 0;
+    if (restlen > 0) {
+        /* the unused end of this block of keystream starts the next packet */
+        memset(mirror_buffer->og, 0, 16);
+        aes_ctr_decrypt(mirror_buffer->aes_ctx, mirror_buffer->og, mirror_buffer->og, 16);
+        mirror_buffer->nextDecryptCount = 16 - restlen;
+    }
+}
+
 void
 mirror_buffer_destroy(mirror_buffer_t *mirror_buffer)
 {
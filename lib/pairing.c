@@ -19,11 +19,13 @@
 #include <string.h>
 #include <assert.h>
 #include <stdbool.h>
+#include <time.h>
 #include <openssl/sha.h> // for SHA512_DIGEST_LENGTH
 
 #include "pairing.h"
 #include "crypto.h"
 #include "srp.h"
+#include "threads.h"
 
 #define SALT_KEY "Pair-Verify-AES-Key"
 #define SALT_IV "Pair-Verify-AES-IV"
@@ -35,8 +37,20 @@ typedef struct srp_s {
     unsigned char private_key[SRP_PRIVATE_KEY_SIZE];
 } srp_t;
 
+/* a client (identified by its Ed25519 public key) that recently completed pair-verify */
+typedef struct pairing_client_s {
+    unsigned char pk[ED25519_KEY_SIZE];
+    ed25519_key_t *key;
+    time_t verified;
+} pairing_client_t;
+
 struct pairing_s {
     ed25519_key_t *ed;
+
+    /* verified clients, most recent first */
+    mutex_handle_t clients_mutex;
+    pairing_client_t clients[PAIRING_CLIENTS];
+    int client_count;
 };
 
 typedef enum {
@@ -47,7 +61,9 @@ typedef enum {
 } status_t;
 
 struct pairing_session_s {
+    pairing_t *pairing;
     status_t status;
+    bool known_client;
 
     ed25519_key_t *ed_ours;
     ed25519_key_t *ed_theirs;
@@ -94,10 +110,70 @@ pairing_init_generate(const char *device_id, const char *keyfile, int *result)
     }
 
     pairing->ed = ed25519_key_generate(device_id, keyfile, result);
+    MUTEX_CREATE(pairing->clients_mutex);
 
     return pairing;
 }
 
+static time_t
+pairing_now()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec;
+}
+
+/* returns a new reference to the key of a client that completed pair-verify less than *
+ * PAIRING_CLIENT_SECONDS ago, or NULL                                                  */
+static ed25519_key_t *
+pairing_find_client(pairing_t *pairing, const unsigned char pk[ED25519_KEY_SIZE])
+{
+    ed25519_key_t *key = NULL;
+    time_t now = pairing_now();
+    MUTEX_LOCK(pairing->clients_mutex);
+    for (int i = 0; i < pairing->client_count; i++) {
+        pairing_client_t *client = &pairing->clients[i];
+        if (!memcmp(client->pk, pk, ED25519_KEY_SIZE)) {
+            if (now - client->verified < PAIRING_CLIENT_SECONDS) {
+                key = ed25519_key_copy(client->key);
+            }
+            break;
+        }
+    }
+    MUTEX_UNLOCK(pairing->clients_mutex);
+    return key;
+}
+
+static void
+pairing_add_client(pairing_t *pairing, const ed25519_key_t *key)
+{
+    pairing_client_t client;
+    int i;
+    ed25519_key_get_raw(client.pk, key);
+    client.verified = pairing_now();
+    MUTEX_LOCK(pairing->clients_mutex);
+    for (i = 0; i < pairing->client_count; i++) {
+        if (!memcmp(pairing->clients[i].pk, client.pk, ED25519_KEY_SIZE)) {
+            break;
+        }
+    }
+    if (i < pairing->client_count) {
+        client.key = pairing->clients[i].key;
+    } else {
+        /* a new client replaces the least recently verified one if the list is full */
+        if (pairing->client_count == PAIRING_CLIENTS) {
+            i = PAIRING_CLIENTS - 1;
+            ed25519_key_destroy(pairing->clients[i].key);
+        } else {
+            i = pairing->client_count++;
+        }
+        client.key = ed25519_key_copy(key);
+    }
+    memmove(&pairing->clients[1], &pairing->clients[0], i * sizeof(pairing_client_t));
+    pairing->clients[0] = client;
+    MUTEX_UNLOCK(pairing->clients_mutex);
+}
+
 void
 pairing_get_public_key(pairing_t *pairing, unsigned char public_key[ED25519_KEY_SIZE])
 {
@@ -134,6 +210,7 @@ pairing_session_init(pairing_t *pairing)
 
     session->ed_ours = ed25519_key_copy(pairing->ed);
 
+    session->pairing = pairing;
     session->status = STATUS_INITIAL;
     session->srp = NULL;
     session->pair_setup = false;
@@ -171,7 +248,11 @@ pairing_session_handshake(pairing_session_t *session, const unsigned char ecdh_k
     }
 
     session->ecdh_theirs = x25519_key_from_raw(ecdh_key);
-    session->ed_theirs = ed25519_key_from_raw(ed_key);
+    session->ed_theirs = pairing_find_client(session->pairing, ed_key);
+    session->known_client = (session->ed_theirs != NULL);
+    if (!session->ed_theirs) {
+        session->ed_theirs = ed25519_key_from_raw(ed_key);
+    }
 
     session->ecdh_ours = x25519_key_generate();
 
@@ -260,9 +341,19 @@ pairing_session_finish(pairing_session_t *session, const unsigned char signature
     }
 
     session->status = STATUS_FINISHED;
+    pairing_add_client(session->pairing, session->ed_theirs);
     return 0;
 }
 
+/* true if the client of this session completed pair-verify (with the same Ed25519 key) *
+ * less than PAIRING_CLIENT_SECONDS before the current handshake started                */
+bool
+pairing_session_is_known_client(pairing_session_t *session)
+{
+    assert(session);
+    return session->known_client;
+}
+
 void
 pairing_session_destroy(pairing_session_t *session)
 {
@@ -285,6 +376,10 @@ pairing_destroy(pairing_t *pairing)
 {
     if (pairing) {
         ed25519_key_destroy(pairing->ed);
+        for (int i = 0; i < pairing->client_count; i++) {
+            ed25519_key_destroy(pairing->clients[i].key);
+        }
+        MUTEX_DESTROY(pairing->clients_mutex);
         free(pairing);
     }
 }
@@ -13,6 +13,7 @@
  *  Lesser General Public License for more details.
  */
 
+#include <stdbool.h>
 #include "crypto.h"
 
 #ifndef PAIRING_H
@@ -33,6 +34,11 @@
 #define GCM_AUTHTAG_SIZE 16
 #define SHA512_KEY_LENGTH 64
 
+/* clients that recently completed pair-verify are remembered, so that on reconnection *
+ * their public key is not imported again                                              */
+#define PAIRING_CLIENTS 16
+#define PAIRING_CLIENT_SECONDS 600
+
 typedef struct pairing_s pairing_t;
 typedef struct pairing_session_s pairing_session_t;
 
@@ -48,6 +54,7 @@ int pairing_session_get_public_key(pairing_session_t *session, unsigned char ecd
 int random_pin();
 int pairing_session_get_signature(pairing_session_t *session, unsigned char signature[PAIRING_SIG_SIZE]);
 int pairing_session_finish(pairing_session_t *session, const unsigned char signature[PAIRING_SIG_SIZE]);
+bool pairing_session_is_known_client(pairing_session_t *session);
 void pairing_session_destroy(pairing_session_t *session);
 
 void pairing_destroy(pairing_t *pairing);
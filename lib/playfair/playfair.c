@@ -10,16 +10,20 @@ void x_xor(unsigned char* in, unsigned char* out, int blocks);
 
 extern unsigned char default_sap[];
 
-void playfair_decrypt(unsigned char* message3, unsigned char* cipherText, unsigned char* keyOut)
+/* the expensive part of playfair_decrypt(), which depends only on message3 */
+void playfair_key_schedule(unsigned char* message3, uint32_t key_schedule[11][4])
+{
+	unsigned char sapKey[16];
+	generate_session_key(default_sap, message3, sapKey);	
+	generate_key_schedule(sapKey, key_schedule);
+}
+
+void playfair_decrypt_with_key_schedule(uint32_t key_schedule[11][4], unsigned char* cipherText, unsigned char* keyOut)
 {
 	unsigned char* chunk1 = &cipherText[16];
 	unsigned char* chunk2 = &cipherText[56];
 	int i;
 	unsigned char blockIn[16];
-	unsigned char sapKey[16];
-	uint32_t key_schedule[11][4];
-	generate_session_key(default_sap, message3, sapKey);	
-	generate_key_schedule(sapKey, key_schedule);
 	z_xor(chunk2, blockIn, 1);
 	cycle(blockIn, key_schedule);
 	for (i = 0; i < 16; i++) {
@@ -29,3 +33,9 @@ void playfair_decrypt(unsigned char* message3, unsigned char* cipherText, unsign
 	z_xor(keyOut, keyOut, 1);
 }
 
+void playfair_decrypt(unsigned char* message3, unsigned char* cipherText, unsigned char* keyOut)
+{
+	uint32_t key_schedule[11][4];
+	playfair_key_schedule(message3, key_schedule);
+	playfair_decrypt_with_key_schedule(key_schedule, cipherText, keyOut);
+}
@@ -1,6 +1,10 @@
 #ifndef PLAYFAIR_H
 #define PLAYFAIR_H
 
+#include <stdint.h>
+
 void playfair_decrypt(unsigned char* message3, unsigned char* cipherText, unsigned char* keyOut);
+void playfair_key_schedule(unsigned char* message3, uint32_t key_schedule[11][4]);
+void playfair_decrypt_with_key_schedule(uint32_t key_schedule[11][4], unsigned char* cipherText, unsigned char* keyOut);
 
 #endif
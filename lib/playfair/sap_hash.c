@@ -27,26 +27,40 @@ void sap_hash(unsigned char* blockIn, unsigned char* keyOut)
    unsigned char buffer3[132];
    unsigned char buffer4[21] = {0xED, 0x25, 0xD1, 0xBB, 0xBC, 0x27, 0x9F, 0x02, 0xA2, 0xA9, 0x11, 0x00, 0x0C, 0xB3, 0x52, 0xC0, 0xBD, 0xE3, 0x1B, 0x49, 0xC7};
    int i0_index[11] = {18, 22, 23, 0, 5, 19, 32, 31, 10, 21, 30};
+   unsigned char swapped[64];
    uint8_t w,x,y,z;
    int i, j;
    
    // Load the input into the buffer
-   for (i = 0; i < 210; i++)
+   for (i = 0; i < 64; i++)
    {
       // We need to swap the byte order around so it is the right endianness      
-      uint32_t in_word = block_words[((i % 64)>>2)];
-      uint32_t in_byte = (in_word >> ((3-(i % 4)) << 3)) & 0xff;
-      buffer1[i] = in_byte;
+      uint32_t in_word = block_words[i >> 2];
+      swapped[i] = (in_word >> ((3-(i % 4)) << 3)) & 0xff;
    }
-   // Next a scrambling
+   for (i = 0; i < 210; i++)
+      buffer1[i] = swapped[i % 64];
+
+   // Next a scrambling.  The indices are (unsigned, 32-bit) (i - 155) % 210 etc: they
+   // count up modulo 210 from (2^32 - 155) % 210, and restart at 0 when i - 155 does.
+   uint32_t ix = (0u - 155u) % 210, iy = (0u - 57u) % 210, iz = (0u - 13u) % 210, iw = 0;
    for (i = 0; i < 840; i++)
    {
-      // We have to do unsigned, 32-bit modulo, or we get the wrong indices
-      x = buffer1[((i-155) & 0xffffffff) % 210];
-      y = buffer1[((i-57) & 0xffffffff) % 210];
-      z = buffer1[((i-13) & 0xffffffff) % 210];
-      w = buffer1[(i & 0xffffffff) % 210];
-      buffer1[i % 210] = (rol8(y, 5) + (rol8(z, 3) ^ w) - rol8(x,7)) & 0xff;
+      if (i == 13)
+         iz = 0;
+      else if (i == 57)
+         iy = 0;
+      else if (i == 155)
+         ix = 0;
+      x = buffer1[ix];
+      y = buffer1[iy];
+      z = buffer1[iz];
+      w = buffer1[iw];
+      buffer1[iw] = (rol8(y, 5) + (rol8(z, 3) ^ w) - rol8(x,7)) & 0xff;
+      ix = (ix == 209) ? 0 : ix + 1;
+      iy = (iy == 209) ? 0 : iy + 1;
+      iz = (iz == 209) ? 0 : iz + 1;
+      iw = (iw == 209) ? 0 : iw + 1;
    }
    printf("Garbling...\n");
    // I have no idea what this is doing (yet), but it gives the right output
@@ -32,6 +32,8 @@
 #include "compat.h"
 #include "raop_rtp_mirror.h"
 #include "raop_ntp.h"
+#include "keyframe_cache.h"
+#include "threads.h"
 
 struct raop_s {
     /* Callbacks for audio and video */
@@ -55,13 +57,15 @@ struct raop_s {
 
     /* configurable plist items: width, height, refreshRate, maxFPS, overscanned *
      * also clientFPSdata, which controls whether video stream info received     *
-     * from the client is shown on terminal monitor.                             */
+     * from the client is shown on terminal monitor, and idrOnly, which drops    *
+     * all video frames except the IDR frames (with their SPS and PPS).          */
     uint16_t width;
     uint16_t height;
     uint8_t refreshRate;
     uint8_t maxFPS;
     uint8_t overscanned;
     uint8_t clientFPSdata;
+    uint8_t idrOnly;
 
     int audio_delay_micros;
     int max_ntp_timeouts;
@@ -72,6 +76,25 @@ struct raop_s {
   
      /* public key as string */
      char pk_str[2*ED25519_KEY_SIZE + 1];
+
+    /* runtime counters, updated by the connection threads */
+    raop_stats_t stats;
+    sender_report_series_t *sender_reports;
+    flight_recorder_t *flight_recorder;
+    keyframe_cache_t *keyframe_cache;
+
+    /* serialized response to GET /info, rebuilt when one of its inputs changes *
+     * (raop_set_plist, raop_set_dnssd, or the features of the dnssd instance)  */
+    mutex_handle_t info_mutex;
+    char *info_plist;
+    int info_plist_len;
+    uint64_t info_features;
+
+    /* duration of pair-verify, from the first request to the verified signature */
+    metrics_histogram_t pair_verify_histogram;
+
+    /* server computation time of pair-setup-pin (the three SRP steps) */
+    metrics_histogram_t pair_setup_histogram;
 };
 
 struct raop_conn_s {
@@ -93,6 +116,9 @@ struct raop_conn_s {
     connection_type_t connection_type; 
 
     bool have_active_remote;
+
+    uint64_t pair_verify_start;
+    uint64_t pair_setup_nsecs;
 };
 typedef struct raop_conn_s raop_conn_t;
 
@@ -382,6 +408,32 @@ raop_init(raop_callbacks_t *callbacks) {
     /* Initialize the logger */
     raop->logger = logger_init();
 
+    raop->sender_reports = sender_report_series_init();
+    if (!raop->sender_reports) {
+        logger_destroy(raop->logger);
+        free(raop);
+        return NULL;
+    }
+
+    raop->flight_recorder = flight_recorder_init(raop->logger);
+    if (!raop->flight_recorder) {
+        sender_report_series_destroy(raop->sender_reports);
+        logger_destroy(raop->logger);
+        free(raop);
+        return NULL;
+    }
+
+    raop->keyframe_cache = keyframe_cache_init();
+    if (!raop->keyframe_cache) {
+        flight_recorder_destroy(raop->flight_recorder);
+        sender_report_series_destroy(raop->sender_reports);
+        logger_destroy(raop->logger);
+        free(raop);
+        return NULL;
+    }
+
+    MUTEX_CREATE(raop->info_mutex);
+
     /* Copy callbacks structure */
     memcpy(&raop->callbacks, callbacks, sizeof(raop_callbacks_t));
 
@@ -405,6 +457,7 @@ raop_init(raop_callbacks_t *callbacks) {
 
     /* initialize switch for display of client's streaming data records */    
     raop->clientFPSdata = 0;
+    raop->idrOnly = 0;
 
     raop->max_ntp_timeouts = 0;
     raop->audio_delay_micros = 250000;
@@ -466,6 +519,11 @@ raop_destroy(raop_t *raop) {
         raop_stop(raop);
         pairing_destroy(raop->pairing);
         httpd_destroy(raop->httpd);
+        sender_report_series_destroy(raop->sender_reports);
+        flight_recorder_destroy(raop->flight_recorder);
+        keyframe_cache_destroy(raop->keyframe_cache);
+        MUTEX_DESTROY(raop->info_mutex);
+        free(raop->info_plist);
         logger_destroy(raop->logger);
         free(raop);
 
@@ -488,11 +546,21 @@ raop_set_log_level(raop_t *raop, int level) {
     logger_set_level(raop->logger, level);
 }
 
+static void
+raop_invalidate_info(raop_t *raop) {
+    MUTEX_LOCK(raop->info_mutex);
+    free(raop->info_plist);
+    raop->info_plist = NULL;
+    raop->info_plist_len = 0;
+    MUTEX_UNLOCK(raop->info_mutex);
+}
+
 int raop_set_plist(raop_t *raop, const char *plist_item, const int value) {
     int retval = 0;
     assert(raop);
     assert(plist_item);
-    
+
+    raop_invalidate_info(raop);
     if (strcmp(plist_item, "width") == 0) {
         raop->width = (uint16_t) value;
         if ((int) raop->width != value) retval = 1;
@@ -511,6 +579,9 @@ int raop_set_plist(raop_t *raop, const char *plist_item, const int value) {
     } else if (strcmp(plist_item, "clientFPSdata") == 0) {
         raop->clientFPSdata = (value ? 1 : 0);
         if ((int) raop->clientFPSdata  != value) retval = 1;
+    } else if (strcmp(plist_item, "idrOnly") == 0) {
+        raop->idrOnly = (value ? 1 : 0);
+        if ((int) raop->idrOnly  != value) retval = 1;
     } else if (strcmp(plist_item, "max_ntp_timeouts") == 0) {
         raop->max_ntp_timeouts = (value > 0 ? value : 0);
         if (raop->max_ntp_timeouts != value) retval = 1;
@@ -568,11 +639,91 @@ raop_set_log_callback(raop_t *raop, raop_log_callback_t callback, void *cls) {
     logger_set_callback(raop->logger, callback, cls);
 }
 
+void
+raop_get_stats(raop_t *raop, raop_stats_t *stats) {
+    assert(raop);
+    assert(stats);
+    raop_stats_t *live = &raop->stats;
+    stats->audio_packets_received = RAOP_STATS_GET(live, audio_packets_received);
+    stats->audio_packets_lost = RAOP_STATS_GET(live, audio_packets_lost);
+    stats->audio_packets_resent = RAOP_STATS_GET(live, audio_packets_resent);
+    stats->audio_packets_late = RAOP_STATS_GET(live, audio_packets_late);
+    stats->audio_resend_requests = RAOP_STATS_GET(live, audio_resend_requests);
+    stats->audio_buffer_depth = RAOP_STATS_GET(live, audio_buffer_depth);
+    stats->audio_buffer_flushes = RAOP_STATS_GET(live, audio_buffer_flushes);
+    stats->audio_jitter = RAOP_STATS_GET(live, audio_jitter);
+    stats->video_frames = RAOP_STATS_GET(live, video_frames);
+    stats->video_bytes = RAOP_STATS_GET(live, video_bytes);
+    stats->video_idr_frames = RAOP_STATS_GET(live, video_idr_frames);
+    stats->video_invalid_frames = RAOP_STATS_GET(live, video_invalid_frames);
+    stats->video_dropped_frames = RAOP_STATS_GET(live, video_dropped_frames);
+    stats->video_dropped_bytes = RAOP_STATS_GET(live, video_dropped_bytes);
+    stats->video_undecrypted_frames = RAOP_STATS_GET(live, video_undecrypted_frames);
+    stats->ntp_offset = RAOP_STATS_GET(live, ntp_offset);
+    stats->ntp_delay = RAOP_STATS_GET(live, ntp_delay);
+    stats->ntp_dispersion = RAOP_STATS_GET(live, ntp_dispersion);
+    stats->ntp_timeouts = RAOP_STATS_GET(live, ntp_timeouts);
+    stats->audio_thread_loops = RAOP_STATS_GET(live, audio_thread_loops);
+    stats->mirror_thread_loops = RAOP_STATS_GET(live, mirror_thread_loops);
+    stats->ntp_thread_loops = RAOP_STATS_GET(live, ntp_thread_loops);
+    stats->httpd_thread_loops = httpd_get_loop_count(raop->httpd);
+    stats->info_requests = RAOP_STATS_GET(live, info_requests);
+    stats->info_cache_hits = RAOP_STATS_GET(live, info_cache_hits);
+    stats->info_built_nsecs = RAOP_STATS_GET(live, info_built_nsecs);
+    stats->info_cached_nsecs = RAOP_STATS_GET(live, info_cached_nsecs);
+    stats->pair_verify_known_clients = RAOP_STATS_GET(live, pair_verify_known_clients);
+    stats->sender_reports = sender_report_series_count(raop->sender_reports);
+    if (!sender_report_series_get(raop->sender_reports, &stats->sender_last, 1)) {
+        memset(&stats->sender_last, 0, sizeof(sender_report_t));
+    }
+}
+
+int
+raop_get_sender_reports(raop_t *raop, sender_report_t *reports, int max) {
+    assert(raop);
+    assert(reports);
+    return sender_report_series_get(raop->sender_reports, reports, max);
+}
+
+const metrics_histogram_t *
+raop_get_pair_verify_histogram(raop_t *raop) {
+    assert(raop);
+    return &raop->pair_verify_histogram;
+}
+
+const metrics_histogram_t *
+raop_get_pair_setup_histogram(raop_t *raop) {
+    assert(raop);
+    return &raop->pair_setup_histogram;
+}
+
+flight_recorder_t *
+raop_get_flight_recorder(raop_t *raop) {
+    assert(raop);
+    return raop->flight_recorder;
+}
+
+unsigned char *
+raop_take_video_keyframe(raop_t *raop, int *len, int *nal_count) {
+    assert(raop);
+    assert(len);
+    assert(nal_count);
+    return keyframe_cache_take(raop->keyframe_cache, len, nal_count);
+}
+
+int
+raop_dump_flight_recorder(raop_t *raop, const char *filename, int seconds) {
+    assert(raop);
+    assert(filename);
+    return flight_recorder_dump(raop->flight_recorder, filename, seconds);
+}
+
 void
 raop_set_dnssd(raop_t *raop, dnssd_t *dnssd) {
     assert(dnssd);
     dnssd_set_pk(dnssd, raop->pk_str);
     raop->dnssd = dnssd;
+    raop_invalidate_info(raop);
 }
 
 
@@ -21,6 +21,9 @@
 #include "dnssd.h"
 #include "stream.h"
 #include "raop_ntp.h"
+#include "raop_stats.h"
+#include "flight_recorder.h"
+#include "metrics.h"
 
 #if defined (WIN32) && defined(DLL_EXPORT)
 # define RAOP_API __declspec(dllexport)
@@ -65,7 +68,8 @@ struct raop_callbacks_s {
     void  (*export_dacp) (void *cls, const char *active_remote, const char *dacp_id);
 };
 typedef struct raop_callbacks_s raop_callbacks_t;
-raop_ntp_t *raop_ntp_init(logger_t *logger, raop_callbacks_t *callbacks, const char *remote,
+raop_ntp_t *raop_ntp_init(logger_t *logger, raop_callbacks_t *callbacks, raop_stats_t *stats,
+                          flight_recorder_t *recorder, const char *remote,
                           int remote_addr_len, unsigned short timing_rport, timing_protocol_t *time_protocol);
 
 RAOP_API raop_t *raop_init(raop_callbacks_t *callbacks);
@@ -82,6 +86,13 @@ RAOP_API int raop_start(raop_t *raop, unsigned short *port);
 RAOP_API int raop_is_running(raop_t *raop);
 RAOP_API void raop_stop(raop_t *raop);
 RAOP_API void raop_set_dnssd(raop_t *raop, dnssd_t *dnssd);
+RAOP_API void raop_get_stats(raop_t *raop, raop_stats_t *stats);
+RAOP_API int raop_get_sender_reports(raop_t *raop, sender_report_t *reports, int max);
+RAOP_API const metrics_histogram_t *raop_get_pair_verify_histogram(raop_t *raop);
+RAOP_API const metrics_histogram_t *raop_get_pair_setup_histogram(raop_t *raop);
+RAOP_API flight_recorder_t *raop_get_flight_recorder(raop_t *raop);
+RAOP_API int raop_dump_flight_recorder(raop_t *raop, const char *filename, int seconds);
+RAOP_API unsigned char *raop_take_video_keyframe(raop_t *raop, int *len, int *nal_count);
 RAOP_API void raop_destroy(raop_t *raop);
 
 #ifdef __cplusplus
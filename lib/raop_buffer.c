@@ -32,6 +32,7 @@
 #include "global.h"
 #include "utils.h"
 #include "byteutils.h"
+#include "latency_trace.h"
 
 #define RAOP_BUFFER_LENGTH 32
 
@@ -44,6 +45,10 @@ typedef struct {
     uint64_t rtp_timestamp;
     uint64_t ntp_timestamp;
 
+    /* Local time of arrival and decryption (see latency_trace.h) */
+    uint64_t time_received;
+    uint64_t time_decrypted;
+
     /* Payload data */
     unsigned int payload_size;
     void *payload_data;
@@ -51,6 +56,7 @@ typedef struct {
 
 struct raop_buffer_s {
     logger_t *logger;
+    raop_stats_t *stats;
     /* AES CTX used for decryption */
     aes_ctx_t *aes_ctx;
 
@@ -64,7 +70,7 @@ struct raop_buffer_s {
 };
 
 raop_buffer_t *
-raop_buffer_init(logger_t *logger,
+raop_buffer_init(logger_t *logger, raop_stats_t *stats,
                  const unsigned char *aeskey,
                  const unsigned char *aesiv)
 {
@@ -76,6 +82,7 @@ raop_buffer_init(logger_t *logger,
         return NULL;
     }
     raop_buffer->logger = logger;
+    raop_buffer->stats = stats;
     // Need to be initialized internally
     raop_buffer->aes_ctx = aes_cbc_init(aeskey, aesiv, AES_DECRYPT);
 
@@ -165,7 +172,8 @@ raop_buffer_decrypt(raop_buffer_t *raop_buffer, unsigned char *data, unsigned ch
 }
 
 int
-raop_buffer_enqueue(raop_buffer_t *raop_buffer, unsigned char *data, unsigned short datalen, uint64_t *ntp_timestamp, uint64_t *rtp_timestamp, int use_seqnum) {
+raop_buffer_enqueue(raop_buffer_t *raop_buffer, unsigned char *data, unsigned short datalen, uint64_t *ntp_timestamp, uint64_t *rtp_timestamp,
+                    uint64_t *time_received, int use_seqnum) {
     unsigned char empty_packet_marker[] = { 0x00, 0x68, 0x34, 0x00 };
     assert(raop_buffer);
 
@@ -189,6 +197,7 @@ raop_buffer_enqueue(raop_buffer_t *raop_buffer, unsigned char *data, unsigned sh
 
     /* If this packet is too late, just skip it */
     if (!raop_buffer->is_empty && seqnum_cmp(seqnum, raop_buffer->first_seqnum) < 0) {
+        RAOP_STATS_INC(raop_buffer->stats, audio_packets_late);
         return 0;
     }
 
@@ -214,6 +223,8 @@ raop_buffer_enqueue(raop_buffer_t *raop_buffer, unsigned char *data, unsigned sh
     int decrypt_ret = raop_buffer_decrypt(raop_buffer, data, entry->payload_data, payload_size, &entry->payload_size);
     assert(decrypt_ret >= 0);
     assert(entry->payload_size <= payload_size);
+    entry->time_received = *time_received;
+    entry->time_decrypted = latency_trace_now();
 
     /* Update the raop_buffer seqnums */
     if (raop_buffer->is_empty) {
@@ -228,7 +239,8 @@ raop_buffer_enqueue(raop_buffer_t *raop_buffer, unsigned char *data, unsigned sh
 }
 
 void *
-raop_buffer_dequeue(raop_buffer_t *raop_buffer, unsigned int *length, uint64_t *ntp_timestamp, uint64_t *rtp_timestamp, unsigned short *seqnum, int no_resend) {
+raop_buffer_dequeue(raop_buffer_t *raop_buffer, unsigned int *length, uint64_t *ntp_timestamp, uint64_t *rtp_timestamp, unsigned short *seqnum,
+                    uint64_t *time_received, uint64_t *time_decrypted, int no_resend) {
     assert(raop_buffer);
 
     /* Calculate number of entries in the current buffer */
@@ -255,6 +267,7 @@ raop_buffer_dequeue(raop_buffer_t *raop_buffer, unsigned int *length, uint64_t *
     /* Update buffer and validate entry */
     raop_buffer->first_seqnum += 1;
     if (!entry->filled) {
+        RAOP_STATS_INC(raop_buffer->stats, audio_packets_lost);
         return NULL;
     }
     entry->filled = 0;
@@ -263,6 +276,8 @@ raop_buffer_dequeue(raop_buffer_t *raop_buffer, unsigned int *length, uint64_t *
     *rtp_timestamp = entry->rtp_timestamp;
     *ntp_timestamp = entry->ntp_timestamp;
     *seqnum = entry->seqnum;
+    *time_received = entry->time_received;
+    *time_decrypted = entry->time_decrypted;
     *length = entry->payload_size;
     entry->payload_size = 0;
     void* data = entry->payload_data;
@@ -270,6 +285,15 @@ raop_buffer_dequeue(raop_buffer_t *raop_buffer, unsigned int *length, uint64_t *
     return data;
 }
 
+unsigned short raop_buffer_get_depth(raop_buffer_t *raop_buffer) {
+    assert(raop_buffer);
+    short entry_count = seqnum_cmp(raop_buffer->last_seqnum, raop_buffer->first_seqnum) + 1;
+    if (raop_buffer->is_empty || entry_count <= 0) {
+        return 0;
+    }
+    return (unsigned short) entry_count;
+}
+
 void raop_buffer_handle_resends(raop_buffer_t *raop_buffer, raop_resend_cb_t resend_cb, void *opaque) {
     assert(raop_buffer);
     assert(resend_cb);
@@ -294,6 +318,7 @@ void raop_buffer_handle_resends(raop_buffer_t *raop_buffer, raop_resend_cb_t res
 
 void raop_buffer_flush(raop_buffer_t *raop_buffer, int next_seq) {
     assert(raop_buffer);
+    RAOP_STATS_INC(raop_buffer->stats, audio_buffer_flushes);
 
     for (int i = 0; i < RAOP_BUFFER_LENGTH; i++) {
         if (raop_buffer->entries[i].payload_data) {
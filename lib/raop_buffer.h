@@ -20,16 +20,20 @@
 
 #include "logger.h"
 #include "raop_rtp.h"
+#include "raop_stats.h"
 
 typedef struct raop_buffer_s raop_buffer_t;
 
 typedef int (*raop_resend_cb_t)(void *opaque, unsigned short seqno, unsigned short count);
 
-raop_buffer_t *raop_buffer_init(logger_t *logger,
+raop_buffer_t *raop_buffer_init(logger_t *logger, raop_stats_t *stats,
                                 const unsigned char *aeskey,
                                 const unsigned char *aesiv);
-int raop_buffer_enqueue(raop_buffer_t *raop_buffer, unsigned char *data, unsigned short datalen, uint64_t *ntp_timestamp, uint64_t *rtp_timestamp, int use_seqnum);
-void *raop_buffer_dequeue(raop_buffer_t *raop_buffer, unsigned int *length, uint64_t *ntp_timestamp, uint64_t *rtp_timestamp, unsigned short *seqnum, int no_resend);
+int raop_buffer_enqueue(raop_buffer_t *raop_buffer, unsigned char *data, unsigned short datalen, uint64_t *ntp_timestamp, uint64_t *rtp_timestamp,
+                        uint64_t *time_received, int use_seqnum);
+void *raop_buffer_dequeue(raop_buffer_t *raop_buffer, unsigned int *length, uint64_t *ntp_timestamp, uint64_t *rtp_timestamp, unsigned short *seqnum,
+                          uint64_t *time_received, uint64_t *time_decrypted, int no_resend);
+unsigned short raop_buffer_get_depth(raop_buffer_t *raop_buffer);
 void raop_buffer_handle_resends(raop_buffer_t *raop_buffer, raop_resend_cb_t resend_cb, void *opaque);
 void raop_buffer_flush(raop_buffer_t *raop_buffer, int next_seq);
 
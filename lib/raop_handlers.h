@@ -29,13 +29,10 @@
 typedef void (*raop_handler_t)(raop_conn_t *, http_request_t *,
                                http_response_t *, char **, int *);
 
+/* builds the (binary plist) body of the response to GET /info */
 static void
-raop_handler_info(raop_conn_t *conn,
-                  http_request_t *request, http_response_t *response,
-                  char **response_data, int *response_datalen)
+raop_info_plist_build(raop_conn_t *conn, char **plist_bin, int *plist_len)
 {
-    assert(conn->raop->dnssd);
-
     plist_t res_node = plist_new_dict();
 
     /* deviceID is the physical hardware address, and will not change */
@@ -164,13 +161,59 @@ raop_handler_info(raop_conn_t *conn,
     plist_array_append_item(displays_node, displays_0_node);
     plist_dict_set_item(res_node, "displays", displays_node);
 
-    plist_to_bin(res_node, response_data, (uint32_t *) response_datalen);
+    plist_to_bin(res_node, plist_bin, (uint32_t *) plist_len);
     plist_free(res_node);
-    http_response_add_header(response, "Content-Type", "application/x-apple-binary-plist");
     free(pk);
     free(hw_addr);
 }
 
+/* senders poll /info repeatedly during discovery and reconnection, and the response only changes *
+ * when the display parameters, the public key or the features do, so it is built once and cached */
+static void
+raop_handler_info(raop_conn_t *conn,
+                  http_request_t *request, http_response_t *response,
+                  char **response_data, int *response_datalen)
+{
+    raop_t *raop = conn->raop;
+    assert(raop->dnssd);
+
+    uint64_t start_time = utils_monotonic_time();
+    uint64_t features = dnssd_get_airplay_features(raop->dnssd);
+    bool cache_hit = false;
+    MUTEX_LOCK(raop->info_mutex);
+    if (raop->info_plist && raop->info_features != features) {
+        free(raop->info_plist);
+        raop->info_plist = NULL;
+    }
+    if (!raop->info_plist) {
+        raop_info_plist_build(conn, &raop->info_plist, &raop->info_plist_len);
+        raop->info_features = features;
+    } else {
+        cache_hit = true;
+    }
+    if (raop->info_plist) {
+        *response_data = malloc(raop->info_plist_len);
+        if (*response_data) {
+            memcpy(*response_data, raop->info_plist, raop->info_plist_len);
+            *response_datalen = raop->info_plist_len;
+        }
+    }
+    MUTEX_UNLOCK(raop->info_mutex);
+    http_response_add_header(response, "Content-Type", "application/x-apple-binary-plist");
+
+    uint64_t response_nsecs = utils_monotonic_time() - start_time;
+    RAOP_STATS_INC(&raop->stats, info_requests);
+    /* both are kept, so that the saving of the cache can be read from a single run */
+    if (cache_hit) {
+        RAOP_STATS_INC(&raop->stats, info_cache_hits);
+        RAOP_STATS_SET(&raop->stats, info_cached_nsecs, response_nsecs);
+    } else {
+        RAOP_STATS_SET(&raop->stats, info_built_nsecs, response_nsecs);
+    }
+    logger_log(raop->logger, LOGGER_DEBUG, "GET /info response %s in %llu usecs", cache_hit ? "from cache" : "built",
+               (unsigned long long) (response_nsecs / 1000));
+}
+
 static void
 raop_handler_pairpinstart(raop_conn_t *conn,
                           http_request_t *request, http_response_t *response,
@@ -256,8 +299,10 @@ raop_handler_pairsetup_pin(raop_conn_t *conn,
         if (conn->raop->pin < 10000) {
             conn->raop->pin = 0;
         }
+        uint64_t srp_start = utils_monotonic_time();
 	int ret = srp_new_user(conn->session, conn->raop->pairing, (const char *) user,
                                (const char *) pin, &salt, &len_salt, &pk, &len_pk);
+        conn->pair_setup_nsecs = utils_monotonic_time() - srp_start;
         free(user);	
         plist_free(req_root_node);
         if (ret < 0) {
@@ -290,8 +335,10 @@ raop_handler_pairsetup_pin(raop_conn_t *conn,
         }
         memcpy(proof, client_proof, (int) client_proof_len);
         free (client_proof);
+        uint64_t srp_start = utils_monotonic_time();
         int ret = srp_validate_proof(conn->session, conn->raop->pairing, (const unsigned char *) client_pk,
                                      (int) client_pk_len, proof, (int) client_proof_len, (int) sizeof(proof));
+        conn->pair_setup_nsecs += utils_monotonic_time() - srp_start;
         free (client_pk);
         plist_free(req_root_node);
         if (ret < 0) {
@@ -335,12 +382,16 @@ raop_handler_pairsetup_pin(raop_conn_t *conn,
         free (client_authtag);
         free (client_epk);
         plist_free(req_root_node);
+        uint64_t srp_start = utils_monotonic_time();
 	ret = srp_confirm_pair_setup(conn->session, conn->raop->pairing, epk, authtag);
+        conn->pair_setup_nsecs += utils_monotonic_time() - srp_start;
         if (ret < 0) {
             logger_log(conn->raop->logger, LOGGER_ERR, "pair-pin-setup (step 3): client authentication failed\n");
             goto authentication_failed;
         } else {
-            logger_log(conn->raop->logger, LOGGER_DEBUG, "pair-pin-setup success\n");
+            metrics_histogram_observe(&conn->raop->pair_setup_histogram, (int64_t) conn->pair_setup_nsecs);
+            logger_log(conn->raop->logger, LOGGER_DEBUG, "pair-pin-setup success (server computation %.3f ms)\n",
+                       (double) conn->pair_setup_nsecs / 1000000.0);
         }
         pairing_session_set_setup_status(conn->session);
         plist_t res_root_node = plist_new_dict();
@@ -415,6 +466,7 @@ raop_handler_pairverify(raop_conn_t *conn,
                 logger_log(conn->raop->logger, LOGGER_ERR, "Invalid pair-verify data");
                 return;
             }
+            conn->pair_verify_start = utils_monotonic_time();
             /* We can fall through these errors, the result will just be garbage... */
             if (pairing_session_handshake(conn->session, data + 4, data + 4 + X25519_KEY_SIZE)) {
                 logger_log(conn->raop->logger, LOGGER_ERR, "Error initializing pair-verify handshake");
@@ -425,6 +477,10 @@ raop_handler_pairverify(raop_conn_t *conn,
             if (pairing_session_get_signature(conn->session, signature)) {
                 logger_log(conn->raop->logger, LOGGER_ERR, "Error getting ED25519 signature");
             }
+            if (pairing_session_is_known_client(conn->session)) {
+                logger_log(conn->raop->logger, LOGGER_DEBUG, "pair-verify: client was verified recently");
+                RAOP_STATS_INC(&conn->raop->stats, pair_verify_known_clients);
+            }
             if (register_check) {
                 bool registered_client = true;
 		if (conn->raop->callbacks.check_register) {
@@ -459,7 +515,10 @@ raop_handler_pairverify(raop_conn_t *conn,
                 http_response_set_disconnect(response, 1);
                 return;
             }
-            logger_log(conn->raop->logger, LOGGER_DEBUG, "pair-verify: signature is verified");	    
+            uint64_t pair_verify_nsecs = utils_monotonic_time() - conn->pair_verify_start;
+            metrics_histogram_observe(&conn->raop->pair_verify_histogram, (int64_t) pair_verify_nsecs);
+            logger_log(conn->raop->logger, LOGGER_DEBUG, "pair-verify: signature is verified (%.3f ms)",
+                       (double) pair_verify_nsecs / 1000000.0);
             http_response_add_header(response, "Content-Type", "application/octet-stream");
             break;
     }
@@ -626,8 +685,10 @@ raop_handler_setup(raop_conn_t *conn,
             logger_log(conn->raop->logger, LOGGER_DEBUG, "ekey:\n%s", str);
             free (str);
         }
+        uint64_t decrypt_start = utils_monotonic_time();
         int ret = fairplay_decrypt(conn->fairplay, (unsigned char*) eaeskey, aeskey);
-        logger_log(conn->raop->logger, LOGGER_DEBUG, "fairplay_decrypt ret = %d", ret);
+        logger_log(conn->raop->logger, LOGGER_DEBUG, "fairplay_decrypt ret = %d (%llu usecs)", ret,
+                   (unsigned long long) ((utils_monotonic_time() - decrypt_start) / 1000));
         if (logger_debug) {
             char *str = utils_data_to_string(aeskey, 16, 16);
             logger_log(conn->raop->logger, LOGGER_DEBUG, "16 byte aeskey (fairplay-decrypted from ekey):\n%s", str);
@@ -740,13 +801,15 @@ raop_handler_setup(raop_conn_t *conn,
                        conn->remotelen, conn->zone_id, str, remote);
             free(str);
         }
-        conn->raop_ntp = raop_ntp_init(conn->raop->logger, &conn->raop->callbacks, remote,
-                                       conn->remotelen, (unsigned short) timing_rport, &time_protocol);
+        conn->raop_ntp = raop_ntp_init(conn->raop->logger, &conn->raop->callbacks, &conn->raop->stats,
+                                       conn->raop->flight_recorder, remote, conn->remotelen,
+                                       (unsigned short) timing_rport, &time_protocol);
         raop_ntp_start(conn->raop_ntp, &timing_lport, conn->raop->max_ntp_timeouts);
-        conn->raop_rtp = raop_rtp_init(conn->raop->logger, &conn->raop->callbacks, conn->raop_ntp,
-                                       remote, conn->remotelen, aeskey, aesiv);
-        conn->raop_rtp_mirror = raop_rtp_mirror_init(conn->raop->logger, &conn->raop->callbacks,
-                                                     conn->raop_ntp, remote, conn->remotelen, aeskey);
+        conn->raop_rtp = raop_rtp_init(conn->raop->logger, &conn->raop->callbacks, &conn->raop->stats,
+                                       conn->raop->flight_recorder, conn->raop_ntp, remote, conn->remotelen, aeskey, aesiv);
+        conn->raop_rtp_mirror = raop_rtp_mirror_init(conn->raop->logger, &conn->raop->callbacks, &conn->raop->stats,
+                                                     conn->raop->sender_reports, conn->raop->flight_recorder,
+                                                     conn->raop->keyframe_cache, conn->raop_ntp, remote, conn->remotelen, aeskey);
 
         plist_t res_event_port_node = plist_new_uint(conn->raop->port);
         plist_t res_timing_port_node = plist_new_uint(timing_lport);
@@ -781,7 +844,8 @@ raop_handler_setup(raop_conn_t *conn,
 
                     if (conn->raop_rtp_mirror) {
                         raop_rtp_mirror_init_aes(conn->raop_rtp_mirror, &stream_connection_id);
-                        raop_rtp_mirror_start(conn->raop_rtp_mirror, &dport, conn->raop->clientFPSdata);
+                        raop_rtp_mirror_start(conn->raop_rtp_mirror, &dport, conn->raop->clientFPSdata,
+                                              conn->raop->idrOnly);
                         logger_log(conn->raop->logger, LOGGER_DEBUG, "Mirroring initialized successfully");
                     } else {
                         logger_log(conn->raop->logger, LOGGER_ERR, "Mirroring not initialized at SETUP, playing will fail!");
@@ -36,6 +36,7 @@
 #include "netutils.h"
 #include "byteutils.h"
 #include "utils.h"
+#include "thread_policy.h"
 
 #define SECOND_IN_NSECS 1000000000UL
 #define RAOP_NTP_DATA_COUNT   8
@@ -57,6 +58,8 @@ typedef struct raop_ntp_data_s {
 struct raop_ntp_s {
     logger_t *logger;
     raop_callbacks_t callbacks;
+    raop_stats_t *stats;
+    flight_recorder_t *recorder;
 
     int max_ntp_timeouts;
 
@@ -138,7 +141,8 @@ raop_ntp_parse_remote(raop_ntp_t *raop_ntp, const char *remote, int remote_addr_
     return 0;
 }
 
-raop_ntp_t *raop_ntp_init(logger_t *logger, raop_callbacks_t *callbacks, const char *remote,
+raop_ntp_t *raop_ntp_init(logger_t *logger, raop_callbacks_t *callbacks, raop_stats_t *stats,
+                          flight_recorder_t *recorder, const char *remote,
                           int remote_addr_len, unsigned short timing_rport, timing_protocol_t *time_protocol) {
     raop_ntp_t *raop_ntp;
 
@@ -151,6 +155,8 @@ raop_ntp_t *raop_ntp_init(logger_t *logger, raop_callbacks_t *callbacks, const c
     }
     raop_ntp->time_protocol = *time_protocol;
     raop_ntp->logger = logger;
+    raop_ntp->stats = stats;
+    raop_ntp->recorder = recorder;
     memcpy(&raop_ntp->callbacks, callbacks, sizeof(raop_callbacks_t));    
     raop_ntp->timing_rport = timing_rport;
 
@@ -263,6 +269,8 @@ raop_ntp_thread(void *arg)
 {
     raop_ntp_t *raop_ntp = arg;
     assert(raop_ntp);
+    THREAD_SET_NAME("raop-ntp");
+    thread_policy_apply(THREAD_ROLE_NTP, raop_ntp->logger);
     unsigned char response[128];
     int response_len;
     unsigned char request[32] = {0x80, 0xd2, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -281,6 +289,7 @@ raop_ntp_thread(void *arg)
             break;
         }
         MUTEX_UNLOCK(raop_ntp->run_mutex);
+        RAOP_STATS_INC(raop_ntp->stats, ntp_thread_loops);
 
         // Flush the socket in case a super delayed response arrived or something
         raop_ntp_flush_socket(raop_ntp->tsock);
@@ -305,6 +314,8 @@ raop_ntp_thread(void *arg)
             response_len = recvfrom(raop_ntp->tsock, (char *)response, sizeof(response), 0, NULL, NULL);
             if (response_len < 0) {
                 timeout_counter++;
+                RAOP_STATS_INC(raop_ntp->stats, ntp_timeouts);
+                flight_recorder_add(raop_ntp->recorder, FLIGHT_RECORD_NTP_TIMEOUT, 0, timeout_counter, 0, 0);
                 char time[30];
                 int level = (timeout_counter == 1 ? LOGGER_DEBUG : LOGGER_ERR);
                 ntp_timestamp_to_time(send_time, time, sizeof(time));
@@ -367,6 +378,11 @@ raop_ntp_thread(void *arg)
                 raop_ntp->sync_dispersion = dispersion;
                 raop_ntp->sync_delay = delay;
                 MUTEX_UNLOCK(raop_ntp->sync_params_mutex);
+                RAOP_STATS_SET(raop_ntp->stats, ntp_offset, offset);
+                RAOP_STATS_SET(raop_ntp->stats, ntp_delay, delay);
+                RAOP_STATS_SET(raop_ntp->stats, ntp_dispersion, dispersion);
+                flight_recorder_add(raop_ntp->recorder, FLIGHT_RECORD_NTP, 0, (uint32_t) ((dispersion * 1000000ull) >> 32),
+                                    raop_ntp->data[raop_ntp->data_index].offset, raop_ntp->data[raop_ntp->data_index].delay);
 
                 logger_log(raop_ntp->logger, LOGGER_DEBUG, "raop_ntp sync correction = %lld", correction);
             }
@@ -387,6 +403,9 @@ raop_ntp_thread(void *arg)
     MUTEX_UNLOCK(raop_ntp->run_mutex);
 
     logger_log(raop_ntp->logger, LOGGER_DEBUG, "raop_ntp exiting thread");
+    if (conn_reset) {
+        flight_recorder_add(raop_ntp->recorder, FLIGHT_RECORD_CONN_RESET, 0, timeout_counter, 0, 0);
+    }
     if (conn_reset && raop_ntp->callbacks.conn_reset) {
         const bool video_reset = false;   /* leave "frozen video" in place */
         raop_ntp->callbacks.conn_reset(raop_ntp->callbacks.cls, timeout_counter, video_reset);
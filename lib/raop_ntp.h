@@ -23,6 +23,10 @@
 #include <stdint.h>
 #include "logger.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef struct raop_ntp_s raop_ntp_t;
 
 typedef enum timing_protocol_e { NTP, TP_NONE, TP_OTHER, TP_UNSPECIFIED } timing_protocol_t;
@@ -43,4 +47,7 @@ uint64_t raop_ntp_get_remote_time(raop_ntp_t *raop_ntp);
 uint64_t raop_ntp_convert_remote_time(raop_ntp_t *raop_ntp, uint64_t remote_time);
 uint64_t raop_ntp_convert_local_time(raop_ntp_t *raop_ntp, uint64_t local_time);
 
+#ifdef __cplusplus
+}
+#endif
 #endif //RAOP_NTP_H
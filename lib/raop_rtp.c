@@ -32,8 +32,7 @@
 #include "mirror_buffer.h"
 #include "stream.h"
 #include "utils.h"
-
-#define NO_FLUSH (-42)
+#include "thread_policy.h"
 
 #define SECOND_IN_NSECS 1000000000
 #define RAOP_RTP_SYNC_DATA_COUNT 8
@@ -44,6 +43,27 @@
 /* note: it is unclear what will happen in the unlikely event that this code is running at the time of the unix-time 
  * epoch event on 2038-01-19 at 3:14:08 UTC ! (but Apple will surely have removed AirPlay "legacy pairing" by then!) */
 
+/* events posted by the RTSP handlers (httpd thread) for the audio thread */
+typedef enum raop_rtp_event_type_e {
+    RAOP_RTP_EVENT_VOLUME,
+    RAOP_RTP_EVENT_FLUSH,
+    RAOP_RTP_EVENT_METADATA,
+    RAOP_RTP_EVENT_COVERART,
+    RAOP_RTP_EVENT_REMOTE_CONTROL_ID,
+    RAOP_RTP_EVENT_PROGRESS,
+} raop_rtp_event_type_t;
+
+typedef struct raop_rtp_event_s {
+    struct raop_rtp_event_s *next;
+    raop_rtp_event_type_t type;
+    float volume;
+    unsigned char *data;                 /* metadata or coverart */
+    int datalen;
+    char *dacp_id;
+    char *active_remote_header;
+    unsigned int progress[3];            /* start, curr, end */
+} raop_rtp_event_t;
+
 typedef struct raop_rtp_sync_data_s {
     uint64_t ntp_time;  // The local wall clock time (unix time in usec) at the time of rtp_time
     uint64_t rtp_time;   // The remote rtp clock time corresponding to ntp_time
@@ -52,6 +72,8 @@ typedef struct raop_rtp_sync_data_s {
 struct raop_rtp_s {
     logger_t *logger;
     raop_callbacks_t callbacks;
+    raop_stats_t *stats;
+    flight_recorder_t *recorder;
 
     // Time and sync
     raop_ntp_t *ntp;
@@ -64,13 +86,11 @@ struct raop_rtp_s {
     uint64_t rtp_time;
     bool rtp_clock_started;
 
-    // Transmission Stats, could be used if a playout buffer is needed
-    // float interarrival_jitter; // As defined by RTP RFC 3550, Section 6.4.1
-    // unsigned int last_packet_transit_time;
-    //int transit = (packet_receive_time - packet_send_time);
-    // int d = transit - last_packet_transit_time;
-    // if (d < 0) d = -d;
-    // interarrival_jitter = (1.f / 16.f) * ((double) d - interarrival_jitter);
+    // Transmission Stats: interarrival jitter as defined by RTP RFC 3550, Section 6.4.1 (in nsecs)
+    double interarrival_jitter;
+    int64_t last_transit_time;
+    unsigned short jitter_seqnum;
+    bool jitter_started;
 
     /* Buffer to handle all resends */
     raop_buffer_t *buffer;
@@ -79,25 +99,16 @@ struct raop_rtp_s {
     struct sockaddr_storage remote_saddr;
     socklen_t remote_saddr_len;
 
+    /* Lock-free multiple-producer, single-consumer event queue: a stack (newest first) *
+     * pushed to with compare-and-swap; the audio thread takes all of it with one atomic *
+     * exchange, so it only needs to check that events is not NULL on each iteration.   */
+    raop_rtp_event_t *events;
+
     /* MUTEX LOCKED VARIABLES START */
-    /* These variables only edited mutex locked */
+    /* These variables only edited mutex locked (running is also read atomically by the audio thread) */
     int running;
     int joined;
 
-    float volume;
-    int volume_changed;
-    unsigned char *metadata;
-    int metadata_len;
-    unsigned char *coverart;
-    int coverart_len;
-    char *dacp_id;
-    char *active_remote_header;
-    unsigned int progress_start;
-    unsigned int progress_curr;
-    unsigned int progress_end;
-    int progress_changed;
-
-    int flush;
     thread_handle_t thread;
     mutex_handle_t run_mutex;
     /* MUTEX LOCKED VARIABLES END */
@@ -145,9 +156,19 @@ raop_rtp_parse_remote(raop_rtp_t *raop_rtp, const char *remote, int remotelen)
     return 0;
 }
 
+static void
+raop_rtp_event_free(raop_rtp_event_t *event)
+{
+    free(event->data);
+    free(event->dacp_id);
+    free(event->active_remote_header);
+    free(event);
+}
+
 raop_rtp_t *
-raop_rtp_init(logger_t *logger, raop_callbacks_t *callbacks, raop_ntp_t *ntp, const char *remote, 
-              int remotelen, const unsigned char *aeskey, const unsigned char *aesiv)
+raop_rtp_init(logger_t *logger, raop_callbacks_t *callbacks, raop_stats_t *stats,
+              flight_recorder_t *recorder, raop_ntp_t *ntp,
+              const char *remote, int remotelen, const unsigned char *aeskey, const unsigned char *aesiv)
 {
     raop_rtp_t *raop_rtp;
 
@@ -159,6 +180,8 @@ raop_rtp_init(logger_t *logger, raop_callbacks_t *callbacks, raop_ntp_t *ntp, co
         return NULL;
     }
     raop_rtp->logger = logger;
+    raop_rtp->stats = stats;
+    raop_rtp->recorder = recorder;
     raop_rtp->ntp = ntp;
 
     raop_rtp->rtp_sync_offset = 0;
@@ -171,14 +194,10 @@ raop_rtp_init(logger_t *logger, raop_callbacks_t *callbacks, raop_ntp_t *ntp, co
     raop_rtp->rtp_start_time = 0;
     raop_rtp->rtp_clock_started = false;
 
-    
-    raop_rtp->dacp_id = NULL;
-    raop_rtp->active_remote_header = NULL;
-    raop_rtp->metadata = NULL;
-    raop_rtp->coverart = NULL;
+    raop_rtp->events = NULL;
 
     memcpy(&raop_rtp->callbacks, callbacks, sizeof(raop_callbacks_t));
-    raop_rtp->buffer = raop_buffer_init(logger, aeskey, aesiv);
+    raop_rtp->buffer = raop_buffer_init(logger, stats, aeskey, aesiv);
     if (!raop_rtp->buffer) {
         free(raop_rtp);
         return NULL;
@@ -190,7 +209,6 @@ raop_rtp_init(logger_t *logger, raop_callbacks_t *callbacks, raop_ntp_t *ntp, co
 
     raop_rtp->running = 0;
     raop_rtp->joined = 1;
-    raop_rtp->flush = NO_FLUSH;
 
     MUTEX_CREATE(raop_rtp->run_mutex);
     return raop_rtp;
@@ -204,10 +222,12 @@ raop_rtp_destroy(raop_rtp_t *raop_rtp)
         raop_rtp_stop(raop_rtp);
         MUTEX_DESTROY(raop_rtp->run_mutex);
         raop_buffer_destroy(raop_rtp->buffer);
-        free(raop_rtp->metadata);
-        free(raop_rtp->coverart);
-        free(raop_rtp->dacp_id);
-        free(raop_rtp->active_remote_header);
+        raop_rtp_event_t *event = raop_rtp->events;
+        while (event) {
+            raop_rtp_event_t *next = event->next;
+            raop_rtp_event_free(event);
+            event = next;
+        }
         free(raop_rtp);
     }
 }
@@ -227,6 +247,7 @@ raop_rtp_resend_callback(void *opaque, unsigned short seqnum, unsigned short cou
 
     logger_log(raop_rtp->logger, LOGGER_DEBUG, "raop_rtp got resend request %d %d", seqnum, count);
     ourseqnum = raop_rtp->control_seqnum++;
+    RAOP_STATS_ADD(raop_rtp->stats, audio_resend_requests, count);
 
     /* Fill the request buffer */
     packet[0] = 0x80;
@@ -277,111 +298,94 @@ raop_rtp_init_sockets(raop_rtp_t *raop_rtp, int use_ipv6)
     return -1;
 }
 
-static int
-raop_rtp_process_events(raop_rtp_t *raop_rtp, void *cb_data)
+static raop_rtp_event_t *
+raop_rtp_event_new(raop_rtp_event_type_t type)
 {
-    int flush;
-    float volume;
-    int volume_changed;
-    unsigned char *metadata;
-    int metadata_len;
-    unsigned char *coverart;
-    int coverart_len;
-    char *dacp_id;
-    char *active_remote_header;
-    unsigned int progress_start;
-    unsigned int progress_curr;
-    unsigned int progress_end;
-    int progress_changed;
-
-    assert(raop_rtp);
-
-    MUTEX_LOCK(raop_rtp->run_mutex);
-    if (!raop_rtp->running) {
-        MUTEX_UNLOCK(raop_rtp->run_mutex);
-        return 1;
-    }
-
-    /* Read the volume level */
-    volume = raop_rtp->volume;
-    volume_changed = raop_rtp->volume_changed;
-    raop_rtp->volume_changed = 0;
-
-    /* Read the flush value */
-    flush = raop_rtp->flush;
-    raop_rtp->flush = NO_FLUSH;
-
-    /* Read the metadata */
-    metadata = raop_rtp->metadata;
-    metadata_len = raop_rtp->metadata_len;
-    raop_rtp->metadata = NULL;
-    raop_rtp->metadata_len = 0;
-
-    /* Read the coverart */
-    coverart = raop_rtp->coverart;
-    coverart_len = raop_rtp->coverart_len;
-    raop_rtp->coverart = NULL;
-    raop_rtp->coverart_len = 0;
-
-    /* Read DACP remote control data */
-    dacp_id = raop_rtp->dacp_id;
-    active_remote_header = raop_rtp->active_remote_header;
-    raop_rtp->dacp_id = NULL;
-    raop_rtp->active_remote_header = NULL;
-
-    /* Read the progress values */
-    progress_start = raop_rtp->progress_start;
-    progress_curr = raop_rtp->progress_curr;
-    progress_end = raop_rtp->progress_end;
-    progress_changed = raop_rtp->progress_changed;
-    raop_rtp->progress_changed = 0;
+    raop_rtp_event_t *event = calloc(1, sizeof(raop_rtp_event_t));
+    assert(event);
+    event->type = type;
+    return event;
+}
 
-    MUTEX_UNLOCK(raop_rtp->run_mutex);
+/* may be called from any thread */
+static void
+raop_rtp_post_event(raop_rtp_t *raop_rtp, raop_rtp_event_t *event)
+{
+    raop_rtp_event_t *head = __atomic_load_n(&raop_rtp->events, __ATOMIC_RELAXED);
+    do {
+        event->next = head;
+    } while (!__atomic_compare_exchange_n(&raop_rtp->events, &head, event, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
 
-    /* Call set_volume callback if changed */
-    if (volume_changed) {
+static void
+raop_rtp_handle_event(raop_rtp_t *raop_rtp, raop_rtp_event_t *event)
+{
+    switch (event->type) {
+    case RAOP_RTP_EVENT_VOLUME:
         //raop_buffer_flush(raop_rtp->buffer, flush); /* seems to be unnecessary, may cause audio artefacts */
         if (raop_rtp->callbacks.audio_set_volume) {
-            raop_rtp->callbacks.audio_set_volume(raop_rtp->callbacks.cls, volume);
+            raop_rtp->callbacks.audio_set_volume(raop_rtp->callbacks.cls, event->volume);
         }
-    }
-
-    /* Handle flush if requested */
-    if (flush != NO_FLUSH) {
+        break;
+    case RAOP_RTP_EVENT_FLUSH:
         if (raop_rtp->callbacks.audio_flush) {
             raop_rtp->callbacks.audio_flush(raop_rtp->callbacks.cls);
         }
-    }
-
-    if (metadata != NULL) {
+        break;
+    case RAOP_RTP_EVENT_METADATA:
         if (raop_rtp->callbacks.audio_set_metadata) {
-            raop_rtp->callbacks.audio_set_metadata(raop_rtp->callbacks.cls, metadata, metadata_len);
+            raop_rtp->callbacks.audio_set_metadata(raop_rtp->callbacks.cls, event->data, event->datalen);
         }
-        free(metadata);
-        metadata = NULL;
-    }
-
-    if (coverart != NULL) {
+        break;
+    case RAOP_RTP_EVENT_COVERART:
         if (raop_rtp->callbacks.audio_set_coverart) {
-            raop_rtp->callbacks.audio_set_coverart(raop_rtp->callbacks.cls, coverart, coverart_len);
+            raop_rtp->callbacks.audio_set_coverart(raop_rtp->callbacks.cls, event->data, event->datalen);
         }
-        free(coverart);
-        coverart = NULL;
-    }
-    if (dacp_id && active_remote_header) {
+        break;
+    case RAOP_RTP_EVENT_REMOTE_CONTROL_ID:
         if (raop_rtp->callbacks.audio_remote_control_id) {
-            raop_rtp->callbacks.audio_remote_control_id(raop_rtp->callbacks.cls, dacp_id, active_remote_header);
+            raop_rtp->callbacks.audio_remote_control_id(raop_rtp->callbacks.cls, event->dacp_id,
+                                                        event->active_remote_header);
         }
-        free(dacp_id);
-        free(active_remote_header);
-        dacp_id = NULL;
-        active_remote_header = NULL;
-    }
-
-    if (progress_changed) {
+        break;
+    case RAOP_RTP_EVENT_PROGRESS:
         if (raop_rtp->callbacks.audio_set_progress) {
-            raop_rtp->callbacks.audio_set_progress(raop_rtp->callbacks.cls, progress_start, progress_curr, progress_end);
+            raop_rtp->callbacks.audio_set_progress(raop_rtp->callbacks.cls, event->progress[0],
+                                                   event->progress[1], event->progress[2]);
         }
+        break;
+    }
+}
+
+static int
+raop_rtp_process_events(raop_rtp_t *raop_rtp, void *cb_data)
+{
+    raop_rtp_event_t *events = NULL;
+    raop_rtp_event_t *event;
+
+    assert(raop_rtp);
+
+    if (!__atomic_load_n(&raop_rtp->running, __ATOMIC_RELAXED)) {
+        return 1;
+    }
+    if (!__atomic_load_n(&raop_rtp->events, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+
+    /* take all the posted events, and reverse them into the order they were posted */
+    event = __atomic_exchange_n(&raop_rtp->events, NULL, __ATOMIC_ACQUIRE);
+    while (event) {
+        raop_rtp_event_t *next = event->next;
+        event->next = events;
+        events = event;
+        event = next;
+    }
+
+    while (events) {
+        event = events;
+        events = event->next;
+        raop_rtp_handle_event(raop_rtp, event);
+        raop_rtp_event_free(event);
     }
     return 0;
 }
@@ -441,6 +445,28 @@ uint64_t rtp64_time (raop_rtp_t *raop_rtp, const uint32_t *rtp32) {
     return  raop_rtp->rtp_time;
 }
 
+/* transit time is local arrival time minus the (unsynchronized) sender rtp time, both   *
+ * in nsecs; only differences of transit times are used, so the constant offset cancels */
+static void
+raop_rtp_update_jitter(raop_rtp_t *raop_rtp, unsigned short seqnum, uint64_t rtp_time)
+{
+    int64_t transit = ((int64_t) raop_ntp_get_local_time(raop_rtp->ntp)) -
+                      (int64_t) (raop_rtp->rtp_clock_rate * rtp_time);
+    if (raop_rtp->jitter_started) {
+        /* AAC-ELD packets arrive in triplicate: only use the first copy of each new packet */
+        if ((short) (seqnum - raop_rtp->jitter_seqnum) <= 0) {
+            return;
+        }
+        int64_t d = transit - raop_rtp->last_transit_time;
+        if (d < 0) d = -d;
+        raop_rtp->interarrival_jitter += ((double) d - raop_rtp->interarrival_jitter) / 16.0;
+        RAOP_STATS_SET(raop_rtp->stats, audio_jitter, (uint64_t) raop_rtp->interarrival_jitter);
+    }
+    raop_rtp->jitter_started = true;
+    raop_rtp->jitter_seqnum = seqnum;
+    raop_rtp->last_transit_time = transit;
+}
+
 static THREAD_RETVAL
 raop_rtp_thread_udp(void *arg)
 {
@@ -460,6 +486,8 @@ raop_rtp_thread_udp(void *arg)
     unsigned short seqnum1 = 0, seqnum2 = 0;
 
     assert(raop_rtp);
+    THREAD_SET_NAME("raop-audio");
+    thread_policy_apply(THREAD_ROLE_AUDIO, raop_rtp->logger);
     bool logger_debug = (logger_get_level(raop_rtp->logger) >= LOGGER_DEBUG);
     raop_rtp->ntp_start_time = raop_ntp_get_local_time(raop_rtp->ntp);
     raop_rtp->rtp_clock_started = false;
@@ -480,6 +508,7 @@ raop_rtp_thread_udp(void *arg)
         if (raop_rtp_process_events(raop_rtp, NULL)) {
             break;
         }
+        RAOP_STATS_INC(raop_rtp->stats, audio_thread_loops);
 
         /* Set timeout value to 5ms */
         tv.tv_sec = 0;
@@ -517,6 +546,7 @@ raop_rtp_thread_udp(void *arg)
 	    } else {
                 packetlen = recvfrom(raop_rtp->csock, (char *)packet, sizeof(packet), 0, NULL, NULL);
             }
+            uint64_t time_received = raop_ntp_get_local_time(raop_rtp->ntp);
             int type_c = packet[1] & ~0x80;
             logger_log(raop_rtp->logger, LOGGER_DEBUG, "\nraop_rtp type_c 0x%02x, packetlen = %d", type_c, packetlen);
 
@@ -533,8 +563,12 @@ raop_rtp_thread_udp(void *arg)
                         ntp_time = (uint64_t) (raop_rtp->rtp_sync_offset + (int64_t) (raop_rtp->rtp_clock_rate * rtp_time));
 		    }
                     logger_log(raop_rtp->logger, LOGGER_DEBUG, "raop_rtp resent audio packet: seqnum=%u", seqnum);
-                    int result = raop_buffer_enqueue(raop_rtp->buffer, resent_packet, resent_packetlen, &ntp_time, &rtp_time, 1);
+                    RAOP_STATS_INC(raop_rtp->stats, audio_packets_resent);
+                    int result = raop_buffer_enqueue(raop_rtp->buffer, resent_packet, resent_packetlen, &ntp_time, &rtp_time,
+                                                     &time_received, 1);
                     assert(result >= 0);
+                    flight_recorder_add(raop_rtp->recorder, FLIGHT_RECORD_AUDIO_RESENT, seqnum, timestamp, resent_packetlen,
+                                        raop_buffer_get_depth(raop_rtp->buffer));
                 } else if (logger_debug) {
                     /* type_c = 0x56 packets  with length 8 have been reported */
                     char *str = utils_data_to_string(packet, packetlen, 16);
@@ -619,6 +653,7 @@ raop_rtp_thread_udp(void *arg)
             // Receiving audio data here
             saddrlen = sizeof(saddr);
             packetlen = recvfrom(raop_rtp->dsock, (char *)packet, sizeof(packet), 0, NULL, NULL);
+            uint64_t time_received = raop_ntp_get_local_time(raop_rtp->ntp);
             // rtp payload type
             //int type_d = packet[1] & ~0x80;
             //logger_log(raop_rtp->logger, LOGGER_DEBUG, "raop_rtp_thread_udp type_d 0x%02x, packetlen = %d", type_d, packetlen);
@@ -632,6 +667,7 @@ raop_rtp_thread_udp(void *arg)
                 }
                 continue;
 	    }
+            RAOP_STATS_INC(raop_rtp->stats, audio_packets_received);
 
             uint32_t rtp_timestamp =  byteutils_get_int_be(packet, 4);
             uint64_t rtp_time = rtp64_time(raop_rtp, &rtp_timestamp);
@@ -639,6 +675,8 @@ raop_rtp_thread_udp(void *arg)
 
 	    if (raop_rtp->ct == 2 && packetlen == 44)  continue;   /* ignore the ALAC packets with format information only. */
 
+            raop_rtp_update_jitter(raop_rtp, byteutils_get_short_be(packet, 2), rtp_time);
+
 	    if (have_synced) {
                 ntp_time = (uint64_t) (raop_rtp->rtp_sync_offset + (int64_t) (raop_rtp->rtp_clock_rate * rtp_time));
 	    } else if (packetlen == 16 && memcmp(packet + 12, no_data_marker, 4) == 0) {
@@ -665,8 +703,10 @@ raop_rtp_thread_udp(void *arg)
 	    } else {
                 no_data_yet = false;
 	    }
-            int result = raop_buffer_enqueue(raop_rtp->buffer, packet, packetlen, &ntp_time, &rtp_time, 1);
+            int result = raop_buffer_enqueue(raop_rtp->buffer, packet, packetlen, &ntp_time, &rtp_time, &time_received, 1);
             assert(result >= 0);
+            flight_recorder_add(raop_rtp->recorder, FLIGHT_RECORD_AUDIO, byteutils_get_short_be(packet, 2), rtp_timestamp,
+                                packetlen, raop_buffer_get_depth(raop_rtp->buffer));
 
 	    if (raop_rtp->ct == 2 && !have_synced) {
                 /* in ALAC Audio-only  mode wait until the first sync before dequeing */
@@ -678,10 +718,14 @@ raop_rtp_thread_udp(void *arg)
                 unsigned short seqnum;
                 uint64_t rtp64_timestamp;
                 uint64_t ntp_timestamp;
+                uint64_t time_received, time_decrypted;
 
-                while ((payload = raop_buffer_dequeue(raop_rtp->buffer, &payload_size, &ntp_timestamp, &rtp64_timestamp, &seqnum, no_resend))) {
+                while ((payload = raop_buffer_dequeue(raop_rtp->buffer, &payload_size, &ntp_timestamp, &rtp64_timestamp, &seqnum,
+                                                      &time_received, &time_decrypted, no_resend))) {
                     audio_decode_struct audio_data; 
                     audio_data.rtp_time = rtp64_timestamp;
+                    audio_data.time_received = time_received;
+                    audio_data.time_decrypted = time_decrypted;
                     audio_data.seqnum = seqnum;
                     audio_data.data_len = payload_size;
                     audio_data.data = payload;
@@ -712,6 +756,8 @@ raop_rtp_thread_udp(void *arg)
                     }
                 }
 
+                RAOP_STATS_SET(raop_rtp->stats, audio_buffer_depth, raop_buffer_get_depth(raop_rtp->buffer));
+
                 /* Handle possible resend requests */
                 if (!no_resend) {
                     raop_buffer_handle_resends(raop_rtp->buffer, raop_rtp_resend_callback, raop_rtp);
@@ -722,7 +768,7 @@ raop_rtp_thread_udp(void *arg)
 
     // Ensure running reflects the actual state
     MUTEX_LOCK(raop_rtp->run_mutex);
-    raop_rtp->running = false;
+    __atomic_store_n(&raop_rtp->running, 0, __ATOMIC_RELAXED);
     MUTEX_UNLOCK(raop_rtp->run_mutex);
 
     logger_log(raop_rtp->logger, LOGGER_DEBUG, "raop_rtp exiting thread");
@@ -748,6 +794,8 @@ raop_rtp_start_audio(raop_rtp_t *raop_rtp,  unsigned short *control_rport, unsig
 
     raop_rtp->ct = *ct;
     raop_rtp->rtp_clock_rate = SECOND_IN_NSECS / *sr;
+    raop_rtp->jitter_started = false;
+    raop_rtp->interarrival_jitter = 0.0;
 
     /* Initialize ports and sockets */
     raop_rtp->control_lport = *control_lport;
@@ -765,7 +813,7 @@ raop_rtp_start_audio(raop_rtp_t *raop_rtp,  unsigned short *control_rport, unsig
     *control_lport = raop_rtp->control_lport;
     *data_lport = raop_rtp->data_lport;
     /* Create the thread and initialize running values */
-    raop_rtp->running = 1;
+    __atomic_store_n(&raop_rtp->running, 1, __ATOMIC_RELAXED);
     raop_rtp->joined = 0;
 
     THREAD_CREATE(raop_rtp->thread, raop_rtp_thread_udp, raop_rtp);
@@ -775,6 +823,8 @@ raop_rtp_start_audio(raop_rtp_t *raop_rtp,  unsigned short *control_rport, unsig
 void
 raop_rtp_set_volume(raop_rtp_t *raop_rtp, float volume)
 {
+    raop_rtp_event_t *event;
+
     assert(raop_rtp);
 
     if (volume > 0.0f) {
@@ -784,57 +834,56 @@ raop_rtp_set_volume(raop_rtp_t *raop_rtp, float volume)
     }
 
     /* Set volume in thread instead */
-    MUTEX_LOCK(raop_rtp->run_mutex);
-    raop_rtp->volume = volume;
-    raop_rtp->volume_changed = 1;
-    MUTEX_UNLOCK(raop_rtp->run_mutex);
+    event = raop_rtp_event_new(RAOP_RTP_EVENT_VOLUME);
+    event->volume = volume;
+    raop_rtp_post_event(raop_rtp, event);
 }
 
 void
 raop_rtp_set_metadata(raop_rtp_t *raop_rtp, const char *data, int datalen)
 {
-    unsigned char *metadata;
+    raop_rtp_event_t *event;
 
     assert(raop_rtp);
 
     if (datalen <= 0) {
         return;
     }
-    metadata = malloc(datalen);
-    assert(metadata);
-    memcpy(metadata, data, datalen);
+    event = raop_rtp_event_new(RAOP_RTP_EVENT_METADATA);
+    event->data = malloc(datalen);
+    assert(event->data);
+    memcpy(event->data, data, datalen);
+    event->datalen = datalen;
 
     /* Set metadata in thread instead */
-    MUTEX_LOCK(raop_rtp->run_mutex);
-    raop_rtp->metadata = metadata;
-    raop_rtp->metadata_len = datalen;
-    MUTEX_UNLOCK(raop_rtp->run_mutex);
+    raop_rtp_post_event(raop_rtp, event);
 }
 
 void
 raop_rtp_set_coverart(raop_rtp_t *raop_rtp, const char *data, int datalen)
 {
-    unsigned char *coverart;
+    raop_rtp_event_t *event;
 
     assert(raop_rtp);
 
     if (datalen <= 0) {
         return;
     }
-    coverart = malloc(datalen);
-    assert(coverart);
-    memcpy(coverart, data, datalen);
+    event = raop_rtp_event_new(RAOP_RTP_EVENT_COVERART);
+    event->data = malloc(datalen);
+    assert(event->data);
+    memcpy(event->data, data, datalen);
+    event->datalen = datalen;
 
     /* Set coverart in thread instead */
-    MUTEX_LOCK(raop_rtp->run_mutex);
-    raop_rtp->coverart = coverart;
-    raop_rtp->coverart_len = datalen;
-    MUTEX_UNLOCK(raop_rtp->run_mutex);
+    raop_rtp_post_event(raop_rtp, event);
 }
 
 void
 raop_rtp_remote_control_id(raop_rtp_t *raop_rtp, const char *dacp_id, const char *active_remote_header)
 {
+    raop_rtp_event_t *event;
+
     assert(raop_rtp);
 
     if (!dacp_id || !active_remote_header) {
@@ -842,41 +891,37 @@ raop_rtp_remote_control_id(raop_rtp_t *raop_rtp, const char *dacp_id, const char
     }
 
     /* Set dacp stuff in thread instead */
-    MUTEX_LOCK(raop_rtp->run_mutex);
-    if (raop_rtp->dacp_id) {
-      free(raop_rtp->dacp_id);
-    }
-    raop_rtp->dacp_id = strdup(dacp_id);
-    if (raop_rtp->active_remote_header) {
-      free(raop_rtp->active_remote_header);
-    }
-    raop_rtp->active_remote_header = strdup(active_remote_header);
-    MUTEX_UNLOCK(raop_rtp->run_mutex);
+    event = raop_rtp_event_new(RAOP_RTP_EVENT_REMOTE_CONTROL_ID);
+    event->dacp_id = strdup(dacp_id);
+    event->active_remote_header = strdup(active_remote_header);
+    raop_rtp_post_event(raop_rtp, event);
 }
 
 void
 raop_rtp_set_progress(raop_rtp_t *raop_rtp, unsigned int start, unsigned int curr, unsigned int end)
 {
+    raop_rtp_event_t *event;
+
     assert(raop_rtp);
 
     /* Set progress in thread instead */
-    MUTEX_LOCK(raop_rtp->run_mutex);
-    raop_rtp->progress_start = start;
-    raop_rtp->progress_curr = curr;
-    raop_rtp->progress_end = end;
-    raop_rtp->progress_changed = 1;
-    MUTEX_UNLOCK(raop_rtp->run_mutex);
+    event = raop_rtp_event_new(RAOP_RTP_EVENT_PROGRESS);
+    event->progress[0] = start;
+    event->progress[1] = curr;
+    event->progress[2] = end;
+    raop_rtp_post_event(raop_rtp, event);
 }
 
 void
 raop_rtp_flush(raop_rtp_t *raop_rtp, int next_seq)
 {
+    raop_rtp_event_t *event;
+
     assert(raop_rtp);
 
     /* Call flush in thread instead */
-    MUTEX_LOCK(raop_rtp->run_mutex);
-    raop_rtp->flush = next_seq;
-    MUTEX_UNLOCK(raop_rtp->run_mutex);
+    event = raop_rtp_event_new(RAOP_RTP_EVENT_FLUSH);
+    raop_rtp_post_event(raop_rtp, event);
 }
 
 void
@@ -891,7 +936,7 @@ raop_rtp_stop(raop_rtp_t *raop_rtp)
         MUTEX_UNLOCK(raop_rtp->run_mutex);
         return;
     }
-    raop_rtp->running = 0;
+    __atomic_store_n(&raop_rtp->running, 0, __ATOMIC_RELAXED);
     MUTEX_UNLOCK(raop_rtp->run_mutex);
 
     /* Join the thread */
@@ -38,6 +38,8 @@
 #include "stream.h"
 #include "utils.h"
 #include "plist/plist.h"
+#include "sender_report.h"
+#include "thread_policy.h"
 
 #ifdef _WIN32
 #define CAST (char *)
@@ -79,6 +81,10 @@
 struct raop_rtp_mirror_s {
     logger_t *logger;
     raop_callbacks_t callbacks;
+    raop_stats_t *stats;
+    sender_report_series_t *sender_reports;
+    flight_recorder_t *recorder;
+    keyframe_cache_t *keyframe_cache;
     raop_ntp_t *ntp;
 
     /* Buffer to handle all resends */
@@ -104,8 +110,40 @@ struct raop_rtp_mirror_s {
 
      /* switch for displaying client FPS data */
      uint8_t show_client_FPS_data;
+
+    /* forward only IDR frames (and their SPS+PPS) to video_process */
+    uint8_t idr_only;
 };
 
+/* what IDR-only mode saved in a session, logged when it ends */
+typedef struct idr_only_session_s {
+    uint64_t first_frame, last_frame;        /* local times */
+    uint64_t forwarded_frames, forwarded_bytes;
+    uint64_t dropped_frames, dropped_bytes;
+    uint64_t undecrypted_frames;             /* dropped before decryption */
+    int unchecked_frames;                    /* flag-clear frames skipped since one was decrypted */
+    uint64_t crypto_time;                    /* nsecs spent decrypting (or skipping) */
+} idr_only_session_t;
+
+static void
+idr_only_session_log(raop_rtp_mirror_t *raop_rtp_mirror, const idr_only_session_t *session)
+{
+    uint64_t frames = session->forwarded_frames + session->dropped_frames;
+    double secs = (double) (session->last_frame - session->first_frame) / SECOND_IN_NSECS;
+    if (!frames) {
+        return;
+    }
+    logger_log(raop_rtp_mirror->logger, LOGGER_INFO, "IDR-only video: %llu of %llu frames (%.1f%%) sent to the decoder "
+               "in %.1f secs (%.2f per sec), %.1f kB of %.1f kB", (unsigned long long) session->forwarded_frames,
+               (unsigned long long) frames, 100.0 * session->forwarded_frames / frames, secs,
+               secs > 0 ? session->forwarded_frames / secs : 0.0, session->forwarded_bytes / 1000.0,
+               (session->forwarded_bytes + session->dropped_bytes) / 1000.0);
+    logger_log(raop_rtp_mirror->logger, LOGGER_INFO, "IDR-only video: %llu frames dropped, %llu of them without "
+               "decryption; decryption took %.1f ms (%.1f us/frame)", (unsigned long long) session->dropped_frames,
+               (unsigned long long) session->undecrypted_frames, (double) session->crypto_time / 1000000.0,
+               (double) session->crypto_time / frames / 1000.0);
+}
+
 static int
 raop_rtp_mirror_parse_remote(raop_rtp_mirror_t *raop_rtp_mirror, const char *remote, int remotelen)
 {
@@ -131,8 +169,10 @@ raop_rtp_mirror_parse_remote(raop_rtp_mirror_t *raop_rtp_mirror, const char *rem
 }
 
 #define NO_FLUSH (-42)
-raop_rtp_mirror_t *raop_rtp_mirror_init(logger_t *logger, raop_callbacks_t *callbacks, raop_ntp_t *ntp,
-                                        const char *remote, int remotelen, const unsigned char *aeskey)
+raop_rtp_mirror_t *raop_rtp_mirror_init(logger_t *logger, raop_callbacks_t *callbacks, raop_stats_t *stats,
+                                        sender_report_series_t *sender_reports, flight_recorder_t *recorder,
+                                        keyframe_cache_t *keyframe_cache, raop_ntp_t *ntp, const char *remote, int remotelen,
+                                        const unsigned char *aeskey)
 {
     raop_rtp_mirror_t *raop_rtp_mirror;
 
@@ -144,6 +184,10 @@ raop_rtp_mirror_t *raop_rtp_mirror_init(logger_t *logger, raop_callbacks_t *call
         return NULL;
     }
     raop_rtp_mirror->logger = logger;
+    raop_rtp_mirror->stats = stats;
+    raop_rtp_mirror->sender_reports = sender_reports;
+    raop_rtp_mirror->recorder = recorder;
+    raop_rtp_mirror->keyframe_cache = keyframe_cache;
     raop_rtp_mirror->ntp = ntp;
 
     memcpy(&raop_rtp_mirror->callbacks, callbacks, sizeof(raop_callbacks_t));
@@ -171,6 +215,8 @@ raop_rtp_mirror_init_aes(raop_rtp_mirror_t *raop_rtp_mirror, uint64_t *streamCon
 }
 
 #define RAOP_PACKET_LEN 32768
+/* IDR-only mode: one in this many frames without the IDR flag is still decrypted, to check the flag */
+#define IDR_FLAG_CHECK_INTERVAL 30
 /**
  * Mirror
  */
@@ -179,6 +225,8 @@ raop_rtp_mirror_thread(void *arg)
 {
     raop_rtp_mirror_t *raop_rtp_mirror = arg;
     assert(raop_rtp_mirror);
+    THREAD_SET_NAME("raop-mirror");
+    thread_policy_apply(THREAD_ROLE_MIRROR, raop_rtp_mirror->logger);
 
     int stream_fd = -1;
     unsigned char packet[128];
@@ -196,6 +244,20 @@ raop_rtp_mirror_thread(void *arg)
     unsigned char nal_start_code[4] = { 0x00, 0x00, 0x00, 0x01 };
     bool logger_debug = (logger_get_level(raop_rtp_mirror->logger) >= LOGGER_DEBUG);
     bool h265_video_detected = false;
+    /* IDR-only mode: non-IDR packets are skipped without decryption once the IDR flag in their *
+     * headers has been seen to match their content (0: not yet known, 1: it does, -1: it does not); *
+     * every IDR_FLAG_CHECK_INTERVAL-th flag-clear frame is still decrypted, so that an IDR frame    *
+     * without the flag withdraws this trust                                                          */
+    int idr_flag_valid = 0;
+    idr_only_session_t idr_only_session;
+    memset(&idr_only_session, 0, sizeof(idr_only_session));
+
+    if (raop_rtp_mirror->sender_reports) {
+        sender_report_series_reset(raop_rtp_mirror->sender_reports);
+    }
+    if (raop_rtp_mirror->keyframe_cache) {
+        keyframe_cache_clear(raop_rtp_mirror->keyframe_cache);
+    }
 
     while (1) {
         fd_set rfds;
@@ -208,6 +270,7 @@ raop_rtp_mirror_thread(void *arg)
             break;
         }
         MUTEX_UNLOCK(raop_rtp_mirror->run_mutex);
+        RAOP_STATS_INC(raop_rtp_mirror->stats, mirror_thread_loops);
 
         /* Set timeout valu to 5ms */
         tv.tv_sec = 0;
@@ -362,6 +425,9 @@ raop_rtp_mirror_thread(void *arg)
                 if (errno == ECONNRESET) conn_reset = true;
                 break;
             }
+            uint64_t time_received = raop_ntp_get_local_time(raop_rtp_mirror->ntp);
+            flight_recorder_add(raop_rtp_mirror->recorder, FLIGHT_RECORD_VIDEO, packet[4], (uint32_t) payload_size,
+                                (int64_t) ntp_timestamp_remote, 0);
 
 	    switch (packet[4]) {
             case  0x00:
@@ -408,7 +474,28 @@ raop_rtp_mirror_thread(void *arg)
 		        sps_pps = NULL;
                         prepend_sps_pps = false;
                 }
-		
+
+                bool idr_flag = (packet[5] & 0x10);
+                if (raop_rtp_mirror->idr_only) {
+                    if (!idr_only_session.first_frame) {
+                        idr_only_session.first_frame = time_received;
+                    }
+                    idr_only_session.last_frame = time_received;
+                }
+                if (raop_rtp_mirror->idr_only && idr_flag_valid > 0 && !idr_flag && !prepend_sps_pps &&
+                    ++idr_only_session.unchecked_frames < IDR_FLAG_CHECK_INTERVAL) {
+                    /* a non-IDR frame: only the AES-CTR keystream position needs to be updated */
+                    mirror_buffer_skip(raop_rtp_mirror->buffer, payload_size);
+                    idr_only_session.crypto_time += raop_ntp_get_local_time(raop_rtp_mirror->ntp) - time_received;
+                    idr_only_session.dropped_frames++;
+                    idr_only_session.dropped_bytes += payload_size;
+                    idr_only_session.undecrypted_frames++;
+                    RAOP_STATS_INC(raop_rtp_mirror->stats, video_dropped_frames);
+                    RAOP_STATS_ADD(raop_rtp_mirror->stats, video_dropped_bytes, payload_size);
+                    RAOP_STATS_INC(raop_rtp_mirror->stats, video_undecrypted_frames);
+                    break;
+                }
+
                 if (prepend_sps_pps) {
                     assert(sps_pps);
                     payload_out = (unsigned char*)  malloc(payload_size + sps_pps_len);
@@ -422,10 +509,12 @@ raop_rtp_mirror_thread(void *arg)
                 }
                 // Decrypt data
                 mirror_buffer_decrypt(raop_rtp_mirror->buffer, payload, payload_decrypted, payload_size);
+                uint64_t time_decrypted = raop_ntp_get_local_time(raop_rtp_mirror->ntp);
 
                 // It seems the AirPlay protocol prepends NALs with their size, which we're replacing with the 4-byte
                 // start code for the NAL Byte-Stream Format.
                 bool valid_data = true;
+                bool idr_frame = false;
                 int nalu_size = 0;
                 int nalus_count = 0;
                 while (nalu_size < payload_size) {
@@ -460,8 +549,10 @@ raop_rtp_mirror_thread(void *arg)
                         }
                     }
                     switch (nalu_type) {
-                    case 14:  /* Prefix NALu , seen before all VCL Nalu's in AirMyPc */
                     case 5:   /*IDR, slice_layer_without_partitioning */
+                        idr_frame = true;
+                        break;
+                    case 14:  /* Prefix NALu , seen before all VCL Nalu's in AirMyPc */
                     case 1:   /*non-IDR, slice_layer_without_partitioning */
                         break;
 	            case 2:   /* slice data partition A */
@@ -518,12 +609,41 @@ raop_rtp_mirror_thread(void *arg)
                 if(!valid_data) {
                     logger_log(raop_rtp_mirror->logger, LOGGER_DEBUG, "nalu marked as invalid");
                     payload_out[0] = 1; /* mark video data as invalid h264 (failed decryption) */
+                    RAOP_STATS_INC(raop_rtp_mirror->stats, video_invalid_frames);
+                } else if (idr_frame) {
+                    RAOP_STATS_INC(raop_rtp_mirror->stats, video_idr_frames);
+                }
+                if (raop_rtp_mirror->idr_only) {
+                    idr_only_session.crypto_time += time_decrypted - time_received;
+                }
+                if (raop_rtp_mirror->idr_only && valid_data) {
+                    if (!idr_flag) {
+                        idr_only_session.unchecked_frames = 0;
+                    }
+                    if (idr_frame != idr_flag && idr_flag_valid >= 0) {
+                        logger_log(raop_rtp_mirror->logger, LOGGER_INFO, "IDR-only video: the IDR flag in the packet "
+                                   "headers of this client is unreliable; non-IDR frames will be decrypted before they "
+                                   "are dropped");
+                        idr_flag_valid = -1;
+                    } else if (idr_frame && !idr_flag_valid) {
+                        idr_flag_valid = 1;
+                    }
+                    if (!idr_frame && !prepend_sps_pps) {
+                        idr_only_session.dropped_frames++;
+                        idr_only_session.dropped_bytes += payload_size;
+                        RAOP_STATS_INC(raop_rtp_mirror->stats, video_dropped_frames);
+                        RAOP_STATS_ADD(raop_rtp_mirror->stats, video_dropped_bytes, payload_size);
+                        free(payload_out);
+                        break;
+                    }
                 }
 
                 payload_decrypted = NULL;
                 h264_decode_struct h264_data;
                 h264_data.ntp_time_local = ntp_timestamp_local;
                 h264_data.ntp_time_remote = ntp_timestamp_remote;
+                h264_data.time_received = time_received;
+                h264_data.time_decrypted = time_decrypted;
                 h264_data.nal_count = nalus_count;   /*nal_count will be the number of nal units in the packet */
                 h264_data.data_len = payload_size;
                 h264_data.data = payload_out;
@@ -532,6 +652,16 @@ raop_rtp_mirror_thread(void *arg)
                     h264_data.nal_count += 2;
 		    prepend_sps_pps =  false;
                 }
+                if (valid_data && idr_frame && raop_rtp_mirror->keyframe_cache) {
+                    keyframe_cache_set_idr(raop_rtp_mirror->keyframe_cache, h264_data.data, h264_data.data_len,
+                                           h264_data.nal_count);
+                }
+                if (raop_rtp_mirror->idr_only) {
+                    idr_only_session.forwarded_frames++;
+                    idr_only_session.forwarded_bytes += h264_data.data_len;
+                }
+                RAOP_STATS_INC(raop_rtp_mirror->stats, video_frames);
+                RAOP_STATS_ADD(raop_rtp_mirror->stats, video_bytes, h264_data.data_len);
                 raop_rtp_mirror->callbacks.video_resume(raop_rtp_mirror->callbacks.cls);
                 raop_rtp_mirror->callbacks.video_process(raop_rtp_mirror->callbacks.cls, raop_rtp_mirror->ntp, &h264_data);
                 free(payload_out);
@@ -608,6 +738,9 @@ raop_rtp_mirror_thread(void *arg)
                 memcpy(sps_pps + sps_size + 4, nal_start_code, 4); 
                 memcpy(sps_pps + sps_size + 8, payload + sps_size + 11, pps_size);
                 prepend_sps_pps = true;
+                if (raop_rtp_mirror->keyframe_cache) {
+                    keyframe_cache_set_sps_pps(raop_rtp_mirror->keyframe_cache, sps_pps, sps_pps_len);
+                }
 
                 uint64_t ntp_offset = 0;
                 ntp_offset  = raop_ntp_convert_remote_time(raop_rtp_mirror->ntp, ntp_offset);
@@ -639,29 +772,23 @@ raop_rtp_mirror_thread(void *arg)
                            " payload_size %d header %s ts_raw = %llu", payload_size, packet_description, ntp_timestamp_raw);
                 /* payloads with packet[4] = 0x05 have no timestamp, and carry video info from the client as a binary plist *
                  * Sometimes (e.g, when the client has a locked screen), there is a 25kB trailer attached to the packet.    *
-                 * This 25000 Byte trailer with unidentified content seems to be the same data each time it is sent.        */
-
-                if (payload_size && raop_rtp_mirror->show_client_FPS_data) {
-                    //char *str = utils_data_to_string(packet, 128, 16);
-                    //logger_log(raop_rtp_mirror->logger, LOGGER_WARNING, "type 5 video packet header:\n%s", str);
-                    //free (str);
-		    
-                    int plist_size = payload_size;
-                    if (payload_size > 25000) {
-		        plist_size = payload_size - 25000;
-                        if (logger_debug) {
-                            char *str = utils_data_to_string(payload + plist_size, 16, 16);
-                            logger_log(raop_rtp_mirror->logger, LOGGER_DEBUG,
-                                       "video_info packet had 25kB trailer; first 16 bytes are:\n%s", str);
-                        free(str);
-                        }
+                 * This trailer with unidentified content seems to be the same data each time it is sent: the plist is     *
+                 * found by locating its own trailer (see sender_report.c)                                                  */
+
+                if (payload_size) {
+                    sender_report_t report;
+                    char *plist_xml = NULL;
+                    bool show = raop_rtp_mirror->show_client_FPS_data;
+                    if (sender_report_parse(payload, payload_size, &report, show ? &plist_xml : NULL) < 0) {
+                        logger_log(raop_rtp_mirror->logger, LOGGER_DEBUG, "video streaming report (%d bytes) was not a binary plist",
+                                   payload_size);
+                        break;
                     }
-                    if (plist_size) {
-                        char *plist_xml;
-                        uint32_t plist_len;
-                        plist_t root_node = NULL;
-                        plist_from_bin((char *) payload, plist_size, &root_node);
-                        plist_to_xml(root_node, &plist_xml, &plist_len);
+                    report.time = time_received;
+                    if (raop_rtp_mirror->sender_reports) {
+                        sender_report_series_add(raop_rtp_mirror->sender_reports, &report);
+                    }
+                    if (plist_xml) {
                         logger_log(raop_rtp_mirror->logger, LOGGER_INFO, "%s", plist_xml);
                         free(plist_xml);
                     }
@@ -680,6 +807,10 @@ raop_rtp_mirror_thread(void *arg)
         }
     }
 
+    if (raop_rtp_mirror->idr_only) {
+        idr_only_session_log(raop_rtp_mirror, &idr_only_session);
+    }
+
     /* Close the stream file descriptor */
     if (stream_fd != -1) {
         closesocket(stream_fd);
@@ -691,6 +822,9 @@ raop_rtp_mirror_thread(void *arg)
     MUTEX_UNLOCK(raop_rtp_mirror->run_mutex);
 
     logger_log(raop_rtp_mirror->logger, LOGGER_DEBUG, "raop_rtp_mirror exiting TCP thread");
+    if (conn_reset) {
+        flight_recorder_add(raop_rtp_mirror->recorder, FLIGHT_RECORD_CONN_RESET, 1, 0, 0, 0);
+    }
     if (conn_reset && raop_rtp_mirror->callbacks.conn_reset) {
         const bool video_reset = false;   /* leave "frozen video" showing */
         raop_rtp_mirror->callbacks.conn_reset(raop_rtp_mirror->callbacks.cls, 0, video_reset);
@@ -730,7 +864,7 @@ raop_rtp_mirror_init_socket(raop_rtp_mirror_t *raop_rtp_mirror, int use_ipv6)
 
 void
 raop_rtp_mirror_start(raop_rtp_mirror_t *raop_rtp_mirror, unsigned short *mirror_data_lport,
-                      uint8_t show_client_FPS_data)
+                      uint8_t show_client_FPS_data, uint8_t idr_only)
 {
     logger_log(raop_rtp_mirror->logger, LOGGER_INFO, "raop_rtp_mirror starting mirroring");
     int use_ipv6 = 0;
@@ -738,6 +872,7 @@ raop_rtp_mirror_start(raop_rtp_mirror_t *raop_rtp_mirror, unsigned short *mirror
     assert(raop_rtp_mirror);
     assert(mirror_data_lport);
     raop_rtp_mirror->show_client_FPS_data = show_client_FPS_data;
+    raop_rtp_mirror->idr_only = idr_only;
 
     MUTEX_LOCK(raop_rtp_mirror->run_mutex);
     if (raop_rtp_mirror->running || !raop_rtp_mirror->joined) {
@@ -21,14 +21,18 @@
 #include <stdint.h>
 #include "raop.h"
 #include "logger.h"
+#include "keyframe_cache.h"
 
 typedef struct raop_rtp_mirror_s raop_rtp_mirror_t;
 typedef struct h264codec_s h264codec_t;
 
-raop_rtp_mirror_t *raop_rtp_mirror_init(logger_t *logger, raop_callbacks_t *callbacks, raop_ntp_t *ntp,
-                                        const char *remote, int remotelen, const unsigned char *aeskey);
+raop_rtp_mirror_t *raop_rtp_mirror_init(logger_t *logger, raop_callbacks_t *callbacks, raop_stats_t *stats,
+                                        sender_report_series_t *sender_reports, flight_recorder_t *recorder,
+                                        keyframe_cache_t *keyframe_cache, raop_ntp_t *ntp, const char *remote, int remotelen,
+                                        const unsigned char *aeskey);
 void raop_rtp_mirror_init_aes(raop_rtp_mirror_t *raop_rtp_mirror, uint64_t *streamConnectionID);
-void raop_rtp_mirror_start(raop_rtp_mirror_t *raop_rtp_mirror, unsigned short *mirror_data_lport, uint8_t show_client_FPS_data);
+void raop_rtp_mirror_start(raop_rtp_mirror_t *raop_rtp_mirror, unsigned short *mirror_data_lport, uint8_t show_client_FPS_data,
+                           uint8_t idr_only);
 void raop_rtp_mirror_stop(raop_rtp_mirror_t *raop_rtp_mirror);
 void raop_rtp_mirror_destroy(raop_rtp_mirror_t *raop_rtp_mirror);
 #endif //RAOP_RTP_MIRROR_H
@@ -0,0 +1,82 @@
+/**
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *===================================================================
+ * UxPlay contributors 2026
+ */
+
+#ifndef RAOP_STATS_H
+#define RAOP_STATS_H
+
+#include <stdint.h>
+#include "sender_report.h"
+
+/* Runtime counters for a raop_t instance.  The live copy is owned by raop_t,  *
+ * and is updated without locking by the audio, mirror, ntp and httpd threads  *
+ * using relaxed atomics: individual fields are always consistent, but a       *
+ * snapshot taken by raop_get_stats() is not an atomic view of all fields.     *
+ * Counters accumulate over the lifetime of the raop_t (across connections);   *
+ * the "last value" fields describe the most recent connection.                */
+
+typedef struct raop_stats_s {
+    /* audio (raop_rtp, raop_buffer) */
+    uint64_t audio_packets_received;   /* rtp data packets received on the data socket */
+    uint64_t audio_packets_lost;       /* packets skipped over at dequeue (never arrived) */
+    uint64_t audio_packets_resent;     /* resent packets received on the control socket */
+    uint64_t audio_packets_late;       /* packets that arrived after their slot was dequeued */
+    uint64_t audio_resend_requests;    /* resend requests sent to the client */
+    uint64_t audio_buffer_depth;       /* last value: entries held in raop_buffer */
+    uint64_t audio_buffer_flushes;
+    uint64_t audio_jitter;             /* last value: RFC 3550 interarrival jitter, in nsecs */
+
+    /* video (raop_rtp_mirror) */
+    uint64_t video_frames;             /* encrypted VCL packets passed to video_process */
+    uint64_t video_bytes;
+    uint64_t video_idr_frames;
+    uint64_t video_invalid_frames;     /* packets marked invalid (payload_out[0] = 1) */
+    uint64_t video_dropped_frames;     /* non-IDR packets dropped in IDR-only mode */
+    uint64_t video_dropped_bytes;
+    uint64_t video_undecrypted_frames; /* dropped packets that were not decrypted */
+
+    /* clock sync (raop_ntp): last values */
+    int64_t  ntp_offset;               /* nsecs */
+    int64_t  ntp_delay;                /* nsecs */
+    uint64_t ntp_dispersion;           /* NTP short format, units of 2^-32 secs */
+    uint64_t ntp_timeouts;
+
+    /* loop iterations of each service thread */
+    uint64_t audio_thread_loops;
+    uint64_t mirror_thread_loops;
+    uint64_t ntp_thread_loops;
+    uint64_t httpd_thread_loops;
+
+    /* GET /info (raop_handlers) */
+    uint64_t info_requests;
+    uint64_t info_cache_hits;          /* responses served from the cached plist */
+    uint64_t info_built_nsecs;         /* last value: time taken to build (and send) an uncached response */
+    uint64_t info_cached_nsecs;        /* last value: time taken to send the cached response */
+
+    /* pair-verify handshakes by clients verified less than PAIRING_CLIENT_SECONDS before */
+    uint64_t pair_verify_known_clients;
+
+    /* client streaming reports (raop_rtp_mirror): only filled in by raop_get_stats() */
+    uint64_t sender_reports;
+    sender_report_t sender_last;       /* most recent report of the current session */
+} raop_stats_t;
+
+#define RAOP_STATS_ADD(stats, field, n)                                          \
+    do { if (stats) __atomic_fetch_add(&(stats)->field, (n), __ATOMIC_RELAXED); } while (0)
+#define RAOP_STATS_INC(stats, field) RAOP_STATS_ADD(stats, field, 1)
+#define RAOP_STATS_SET(stats, field, value)                                      \
+    do { if (stats) __atomic_store_n(&(stats)->field, (value), __ATOMIC_RELAXED); } while (0)
+#define RAOP_STATS_GET(stats, field) __atomic_load_n(&(stats)->field, __ATOMIC_RELAXED)
+
+#endif //RAOP_STATS_H
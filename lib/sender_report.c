@@ -0,0 +1,280 @@
+/**
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *===================================================================
+ * UxPlay contributors 2026
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "sender_report.h"
+#include "threads.h"
+#include "plist/plist.h"
+
+#define BPLIST_HEADER_LEN 8
+#define BPLIST_TRAILER_LEN 32
+#define MAX_DEPTH 4
+
+/* the keys (exact names, as sent by the client) of the values kept in sender_report_t; *
+ * other keys are ignored (but are shown by -FPSdata, which logs the whole report)       */
+static const struct {
+    const char *key;
+    unsigned int field;
+} report_keys[] = {
+    { "fps", SENDER_REPORT_FPS },
+    { "FPS", SENDER_REPORT_FPS },
+    { "frameRate", SENDER_REPORT_FPS },
+    { "bitRate", SENDER_REPORT_BITRATE },
+    { "bitrate", SENDER_REPORT_BITRATE },
+    { "droppedFrames", SENDER_REPORT_DROPPED },
+    { "framesDropped", SENDER_REPORT_DROPPED },
+};
+
+struct sender_report_series_s {
+    mutex_handle_t mutex;
+    sender_report_t reports[SENDER_REPORT_SERIES_LENGTH];
+    int index;
+    int count;
+    uint64_t total;
+};
+
+static uint64_t
+get_uint_be(const unsigned char *data, int size)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < size; i++) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+/* check for a binary plist trailer that ends at data + end:                  *
+ * 5 unused bytes, sort version, offset int size, object ref size,            *
+ * number of objects, top object, offset table offset (big-endian uint64)     */
+static int
+bplist_trailer_valid(const unsigned char *data, int end)
+{
+    const unsigned char *trailer = data + end - BPLIST_TRAILER_LEN;
+    int offset_size = trailer[6];
+    int ref_size = trailer[7];
+    uint64_t num_objects = get_uint_be(trailer + 8, 8);
+    uint64_t top_object = get_uint_be(trailer + 16, 8);
+    uint64_t table_offset = get_uint_be(trailer + 24, 8);
+
+    if (trailer[0] || trailer[1] || trailer[2] || trailer[3] || trailer[4]) {
+        return 0;
+    }
+    if (offset_size < 1 || offset_size > 8 || ref_size < 1 || ref_size > 8) {
+        return 0;
+    }
+    if (num_objects == 0 || num_objects > (uint64_t) end || top_object >= num_objects) {
+        return 0;
+    }
+    if (table_offset < BPLIST_HEADER_LEN || table_offset >= (uint64_t) end) {
+        return 0;
+    }
+    return (table_offset + num_objects * offset_size + BPLIST_TRAILER_LEN == (uint64_t) end);
+}
+
+/* length of the binary plist at the start of data, or -1 if there is none.         *
+ * The report plist is sometimes followed by a (~25 kB) trailer of unknown content,  *
+ * so if the plist trailer is not at the end of the data, search back for it.        */
+int
+sender_report_plist_length(const unsigned char *data, int len)
+{
+    if (len < BPLIST_HEADER_LEN + BPLIST_TRAILER_LEN || memcmp(data, "bplist00", BPLIST_HEADER_LEN)) {
+        return -1;
+    }
+    for (int end = len; end >= BPLIST_HEADER_LEN + BPLIST_TRAILER_LEN; end--) {
+        if (bplist_trailer_valid(data, end)) {
+            return end;
+        }
+    }
+    return -1;
+}
+
+static void
+set_field(sender_report_t *report, unsigned int field, double value)
+{
+    switch (field) {
+    case SENDER_REPORT_FPS:
+        report->fps = value;
+        break;
+    case SENDER_REPORT_BITRATE:
+        report->bitrate = value;
+        break;
+    case SENDER_REPORT_DROPPED:
+        report->dropped_frames = value;
+        break;
+    default:
+        return;
+    }
+    report->fields |= field;
+}
+
+static void
+parse_node(plist_t node, const char *key, int depth, sender_report_t *report)
+{
+    plist_type type = plist_get_node_type(node);
+    double value;
+
+    if (type == PLIST_DICT) {
+        plist_dict_iter iter = NULL;
+        if (depth >= MAX_DEPTH) {
+            return;
+        }
+        plist_dict_new_iter(node, &iter);
+        if (!iter) {
+            return;
+        }
+        while (1) {
+            char *item_key = NULL;
+            plist_t item = NULL;
+            plist_dict_next_item(node, iter, &item_key, &item);
+            if (!item) {
+                free(item_key);
+                break;
+            }
+            parse_node(item, item_key, depth + 1, report);
+            free(item_key);
+        }
+        free(iter);
+        return;
+    } else if (type == PLIST_UINT) {
+        uint64_t uint_val = 0;
+        plist_get_uint_val(node, &uint_val);
+        value = (double) uint_val;
+    } else if (type == PLIST_REAL) {
+        plist_get_real_val(node, &value);
+    } else {
+        return;
+    }
+    if (!key) {
+        return;
+    }
+
+    for (int i = 0; i < (int) (sizeof(report_keys) / sizeof(report_keys[0])); i++) {
+        if (!strcmp(key, report_keys[i].key)) {
+            set_field(report, report_keys[i].field, value);
+            return;
+        }
+    }
+}
+
+/* parse a streaming report (binary plist, without conversion to xml) into report;       *
+ * if xml is not NULL, it receives the whole report as an xml plist (free with free()),   *
+ * for -FPSdata.  returns 0 on success, -1 if the data is not a valid binary plist        */
+int
+sender_report_parse(const unsigned char *data, int len, sender_report_t *report, char **xml)
+{
+    plist_t root_node = NULL;
+    int plist_len;
+
+    assert(report);
+    report->fields = 0;
+    report->fps = 0.0;
+    report->bitrate = 0.0;
+    report->dropped_frames = 0.0;
+    if (xml) {
+        *xml = NULL;
+    }
+
+    plist_len = sender_report_plist_length(data, len);
+    if (plist_len < 0) {
+        return -1;
+    }
+    plist_from_bin((const char *) data, (uint32_t) plist_len, &root_node);
+    if (!root_node) {
+        return -1;
+    }
+    parse_node(root_node, NULL, 0, report);
+    if (xml) {
+        uint32_t xml_len;
+        plist_to_xml(root_node, xml, &xml_len);
+    }
+    plist_free(root_node);
+    return 0;
+}
+
+sender_report_series_t *
+sender_report_series_init()
+{
+    sender_report_series_t *series = calloc(1, sizeof(sender_report_series_t));
+    if (!series) {
+        return NULL;
+    }
+    MUTEX_CREATE(series->mutex);
+    return series;
+}
+
+void
+sender_report_series_destroy(sender_report_series_t *series)
+{
+    if (series) {
+        MUTEX_DESTROY(series->mutex);
+        free(series);
+    }
+}
+
+/* start a new series (at the start of a mirror session); the total count is kept */
+void
+sender_report_series_reset(sender_report_series_t *series)
+{
+    assert(series);
+    MUTEX_LOCK(series->mutex);
+    series->index = 0;
+    series->count = 0;
+    MUTEX_UNLOCK(series->mutex);
+}
+
+void
+sender_report_series_add(sender_report_series_t *series, const sender_report_t *report)
+{
+    assert(series);
+    MUTEX_LOCK(series->mutex);
+    series->reports[series->index] = *report;
+    series->index = (series->index + 1) % SENDER_REPORT_SERIES_LENGTH;
+    if (series->count < SENDER_REPORT_SERIES_LENGTH) {
+        series->count++;
+    }
+    series->total++;
+    MUTEX_UNLOCK(series->mutex);
+}
+
+/* copies the most recent (up to max) reports of the current session, oldest first */
+int
+sender_report_series_get(sender_report_series_t *series, sender_report_t *reports, int max)
+{
+    int count;
+    assert(series);
+    MUTEX_LOCK(series->mutex);
+    count = (series->count < max) ? series->count : max;
+    int start = (series->index + SENDER_REPORT_SERIES_LENGTH - count) % SENDER_REPORT_SERIES_LENGTH;
+    for (int i = 0; i < count; i++) {
+        reports[i] = series->reports[(start + i) % SENDER_REPORT_SERIES_LENGTH];
+    }
+    MUTEX_UNLOCK(series->mutex);
+    return count;
+}
+
+uint64_t
+sender_report_series_count(sender_report_series_t *series)
+{
+    uint64_t total;
+    assert(series);
+    MUTEX_LOCK(series->mutex);
+    total = series->total;
+    MUTEX_UNLOCK(series->mutex);
+    return total;
+}
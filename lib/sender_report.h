@@ -0,0 +1,53 @@
+/**
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *===================================================================
+ * UxPlay contributors 2026
+ */
+
+/* Once-per-second "streaming report" sent by the client on the mirror channel (type 0x05   *
+ * packets): a binary plist, sometimes followed by an unidentified trailer.  The key names  *
+ * are not documented; numeric values are matched to fields by exact key (report_keys[] in  *
+ * sender_report.c): "fps", "FPS" or "frameRate"; "bitRate" or "bitrate"; "droppedFrames"   *
+ * or "framesDropped".  Other keys are ignored (but shown by -FPSdata).                     */
+
+#ifndef SENDER_REPORT_H
+#define SENDER_REPORT_H
+
+#include <stdint.h>
+
+#define SENDER_REPORT_FPS      0x01
+#define SENDER_REPORT_BITRATE  0x02
+#define SENDER_REPORT_DROPPED  0x04
+
+#define SENDER_REPORT_SERIES_LENGTH 300    /* 5 minutes of reports */
+
+typedef struct sender_report_s {
+    uint64_t time;                 /* local time of receipt, nsecs */
+    double fps;                    /* frames per second sent */
+    double bitrate;                /* encoder bitrate, as reported (bits/sec) */
+    double dropped_frames;         /* frames dropped by the sender, as reported */
+    unsigned int fields;           /* SENDER_REPORT_* flags of the fields found */
+} sender_report_t;
+
+typedef struct sender_report_series_s sender_report_series_t;
+
+int sender_report_plist_length(const unsigned char *data, int len);
+int sender_report_parse(const unsigned char *data, int len, sender_report_t *report, char **xml);
+
+sender_report_series_t *sender_report_series_init();
+void sender_report_series_destroy(sender_report_series_t *series);
+void sender_report_series_reset(sender_report_series_t *series);
+void sender_report_series_add(sender_report_series_t *series, const sender_report_t *report);
+int sender_report_series_get(sender_report_series_t *series, sender_report_t *reports, int max);
+uint64_t sender_report_series_count(sender_report_series_t *series);
+
+#endif //SENDER_REPORT_H
@@ -0,0 +1,185 @@
+/**
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *===================================================================
+ * UxPlay contributors 2026
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stddef.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "shm_export.h"
+
+#define SHM_EXPORT_ALIGN 4096      /* slot data is page-aligned */
+
+struct shm_export_s {
+    char *name;
+    unsigned int slots;
+    shm_export_header_t *header;
+    size_t map_size;
+    uint64_t frames;
+};
+
+#ifndef _WIN32
+static void
+shm_export_unmap(shm_export_t *shm)
+{
+    if (!shm->header) {
+        return;
+    }
+    __atomic_store_n(&shm->header->closed, 1, __ATOMIC_RELEASE);
+    munmap(shm->header, shm->map_size);
+    shm_unlink(shm->name);
+    shm->header = NULL;
+}
+
+/* a new segment replaces the old one (readers of which see "closed", and reopen the name) */
+static int
+shm_export_map(shm_export_t *shm, uint64_t slot_size)
+{
+    size_t data_offset = (sizeof(shm_export_header_t) + SHM_EXPORT_ALIGN - 1) & ~((size_t) SHM_EXPORT_ALIGN - 1);
+    size_t map_size = data_offset + shm->slots * slot_size;
+    shm_export_header_t *header;
+    int fd;
+
+    shm_export_unmap(shm);
+    fd = shm_open(shm->name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    if (ftruncate(fd, (off_t) map_size) < 0) {
+        close(fd);
+        shm_unlink(shm->name);
+        return -1;
+    }
+    header = (shm_export_header_t *) mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED) {
+        shm_unlink(shm->name);
+        return -1;
+    }
+    /* the segment is zero-filled by ftruncate */
+    header->version = SHM_EXPORT_VERSION;
+    header->slots = shm->slots;
+    header->slot_size = slot_size;
+    header->data_offset = data_offset;
+    __atomic_store_n(&header->magic, SHM_EXPORT_MAGIC, __ATOMIC_RELEASE);
+    shm->header = header;
+    shm->map_size = map_size;
+    return 0;
+}
+#endif
+
+shm_export_t *
+shm_export_init(const char *name, unsigned int slots, char *error, int error_len)
+{
+#ifdef _WIN32
+    snprintf(error, error_len, "shared-memory export is not supported on Windows");
+    return NULL;
+#else
+    shm_export_t *shm;
+    int fd;
+
+    if (name[0] != '/' || strchr(name + 1, '/') || strlen(name) < 2 || strlen(name) > 200) {
+        snprintf(error, error_len, "\"%s\" is not a valid name: it must be \"/\" followed by a name with no \"/\"", name);
+        return NULL;
+    }
+    if (slots < 2 || slots > SHM_EXPORT_MAX_SLOTS) {
+        snprintf(error, error_len, "the number of slots must be in range [2,%d]", SHM_EXPORT_MAX_SLOTS);
+        return NULL;
+    }
+    /* check now that the segment can be created, rather than when the first frame arrives */
+    fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        snprintf(error, error_len, "cannot create shared memory \"%s\": %s", name, strerror(errno));
+        return NULL;
+    }
+    close(fd);
+    shm_unlink(name);
+
+    shm = calloc(1, sizeof(shm_export_t));
+    if (!shm) {
+        snprintf(error, error_len, "out of memory");
+        return NULL;
+    }
+    shm->name = strdup(name);
+    shm->slots = slots;
+    return shm;
+#endif
+}
+
+int
+shm_export_write(shm_export_t *shm, const uint8_t *data, uint32_t width, uint32_t height, uint32_t stride,
+                 uint32_t format, uint64_t timestamp)
+{
+#ifdef _WIN32
+    return -1;
+#else
+    uint64_t size = (uint64_t) stride * height;
+    shm_export_slot_t *slot;
+    uint64_t frame;
+    unsigned int index;
+
+    if (!shm->header || size > shm->header->slot_size) {
+        /* room for frames up to 1/8 larger, so small size changes do not need a new segment */
+        uint64_t slot_size = (size + size / 8 + SHM_EXPORT_ALIGN - 1) & ~((uint64_t) SHM_EXPORT_ALIGN - 1);
+        if (shm_export_map(shm, slot_size) < 0) {
+            return -1;
+        }
+    }
+    frame = shm->header->write_count;
+    index = (unsigned int) (frame % shm->slots);
+    slot = &shm->header->slot[index];
+
+    /* seqlock: readers that see an odd sequence, or a changed one, discard what they read */
+    __atomic_store_n(&slot->sequence, 2 * frame + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy((uint8_t *) shm->header + shm->header->data_offset + index * shm->header->slot_size, data, size);
+    slot->timestamp = timestamp;
+    slot->width = width;
+    slot->height = height;
+    slot->stride = stride;
+    slot->size = (uint32_t) size;
+    slot->format = format;
+    __atomic_store_n(&slot->sequence, 2 * frame + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&shm->header->write_count, frame + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&shm->frames, shm->frames + 1, __ATOMIC_RELAXED);
+    return 0;
+#endif
+}
+
+uint64_t
+shm_export_get_frames(shm_export_t *shm)
+{
+    return __atomic_load_n(&shm->frames, __ATOMIC_RELAXED);
+}
+
+void
+shm_export_destroy(shm_export_t *shm)
+{
+    if (!shm) {
+        return;
+    }
+#ifndef _WIN32
+    shm_export_unmap(shm);
+#endif
+    free(shm->name);
+    free(shm);
+}
@@ -0,0 +1,85 @@
+/**
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *===================================================================
+ * UxPlay contributors 2026
+ */
+
+/* Publishes decoded video frames in a POSIX shared-memory segment, for local readers (OCR,  *
+ * archiving, overlays, ...).  The segment is a header followed by a ring of slots, each    *
+ * holding one frame.  The writer never waits for readers: each slot has a sequence number *
+ * (a seqlock), which is odd while the slot is being written.  A reader maps the segment   *
+ * read-only and uses a frame in place:                                                    *
+ *                                                                                         *
+ *   count = atomic load (acquire) of header->write_count; if 0, no frame yet              *
+ *   slot = &header->slot[(count - 1) % header->slots]                                     *
+ *   seq = atomic load (acquire) of slot->sequence; if odd, try again                      *
+ *   use the frame at (uint8_t *) header + header->data_offset + index * header->slot_size *
+ *   if slot->sequence (acquire fence, then load) != seq, the frame was overwritten while  *
+ *   in use: discard the result                                                            *
+ *                                                                                         *
+ * If header->closed becomes non-zero, the writer has gone away, or has replaced the       *
+ * segment by a larger one (the frame size grew): unmap it and open the name again.        *
+ * This header is all a reader needs.                                                      */
+
+#ifndef SHM_EXPORT_H
+#define SHM_EXPORT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHM_EXPORT_MAGIC 0x46505855                   /* "UXPF" */
+#define SHM_EXPORT_VERSION 1
+#define SHM_EXPORT_MAX_SLOTS 16
+#define SHM_EXPORT_FORMAT_BGRX 0x78524742             /* fourcc "BGRx": 4 bytes per pixel, B G R unused */
+
+typedef struct shm_export_slot_s {
+    uint64_t sequence;          /* odd while being written; 2 * (frame number + 1) when complete */
+    uint64_t timestamp;         /* wall-clock (CLOCK_REALTIME) time in ns at which the frame is displayed */
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;            /* bytes per row */
+    uint32_t size;              /* bytes of frame data (stride * height) */
+    uint32_t format;            /* SHM_EXPORT_FORMAT_* */
+    uint32_t reserved[3];
+} shm_export_slot_t;
+
+typedef struct shm_export_header_s {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;             /* slots in the ring */
+    uint32_t closed;            /* set when the writer stops using this segment */
+    uint64_t slot_size;         /* bytes of frame data per slot */
+    uint64_t data_offset;       /* offset of the data of slot 0 from the start of the segment */
+    uint64_t write_count;       /* frames published; the newest is in slot (write_count - 1) % slots */
+    uint64_t reserved[3];
+    shm_export_slot_t slot[SHM_EXPORT_MAX_SLOTS];
+} shm_export_header_t;
+
+typedef struct shm_export_s shm_export_t;
+
+/* name: as for shm_open(), e.g. "/uxplay"; the segment is created when the first frame is written *
+ * (its size depends on the frame size).  Returns NULL (with a message in error) if not possible. */
+shm_export_t *shm_export_init(const char *name, unsigned int slots, char *error, int error_len);
+/* copies a frame (height rows of stride bytes) into the next slot; never blocks.  Returns 0, or  *
+ * -1 if the segment could not be (re)created                                                     */
+int shm_export_write(shm_export_t *shm, const uint8_t *data, uint32_t width, uint32_t height, uint32_t stride,
+                     uint32_t format, uint64_t timestamp);
+uint64_t shm_export_get_frames(shm_export_t *shm);
+void shm_export_destroy(shm_export_t *shm);   /* marks the segment closed and unlinks it */
+
+#ifdef __cplusplus
+}
+#endif
+#endif //SHM_EXPORT_H
@@ -46,16 +46,39 @@
 #include <openssl/sha.h>
 #include <openssl/crypto.h>
 #include <openssl/rand.h>
+#include <pthread.h>
 #include "srp.h"
 
 static int	g_initialized = 0;
 
+/* constants derived from N and g that depend on the hash algorithm */
 typedef struct
 {
-    BIGNUM     * N;
-    BIGNUM     * g;
+    BIGNUM        * k_orig;                           /* H(N, g) */
+    BIGNUM        * k_rfc5054;                        /* H(N, PAD(g)) */
+    unsigned char   H_xor[ SHA512_DIGEST_LENGTH ];    /* H(N) xor H(g) */
+} NGHashConstants;
+
+/* The standard groups are parsed once per process, together with a Montgomery  *
+ * context for N and the hash-dependent constants, and are then shared read-only *
+ * (shared = 1, never freed).  SRP_NG_CUSTOM groups are built for each use.      */
+typedef struct
+{
+    BIGNUM          * N;
+    BIGNUM          * g;
+    BN_MONT_CTX     * mont;
+    NGHashConstants * hash[ SRP_SHA512 + 1 ];
+    int               shared;
 } NGConstant;
 
+static pthread_mutex_t shared_ng_mutex = PTHREAD_MUTEX_INITIALIZER;
+static NGConstant * shared_ng[ SRP_NG_CUSTOM ];
+
+/* BN_CTX are kept for reuse by later calls (a BN_CTX must not be used by two threads at once) */
+#define BN_CTX_POOL_SIZE 4
+static BN_CTX * bn_ctx_pool[ BN_CTX_POOL_SIZE ];
+static int bn_ctx_pool_count = 0;
+
 struct NGHex
 {
     const char * n_hex;
@@ -206,41 +229,171 @@ static struct NGHex global_Ng_constants[] = {
 };
 
 
-static NGConstant * new_ng( SRP_NGType ng_type, const char * n_hex, const char * g_hex )
+static BN_CTX * get_bn_ctx()
 {
-    NGConstant * ng   = (NGConstant *) malloc( sizeof(NGConstant) );
-    ng->N             = BN_new();
-    ng->g             = BN_new();
+    BN_CTX * ctx = 0;
+    pthread_mutex_lock( &shared_ng_mutex );
+    if ( bn_ctx_pool_count > 0 )
+        ctx = bn_ctx_pool[ --bn_ctx_pool_count ];
+    pthread_mutex_unlock( &shared_ng_mutex );
+    return ctx ? ctx : BN_CTX_new();
+}
 
-    if( !ng || !ng->N || !ng->g )
-       return 0;
+static void put_bn_ctx( BN_CTX * ctx )
+{
+    if (!ctx)
+        return;
+    pthread_mutex_lock( &shared_ng_mutex );
+    if ( bn_ctx_pool_count < BN_CTX_POOL_SIZE )
+    {
+        bn_ctx_pool[ bn_ctx_pool_count++ ] = ctx;
+        ctx = 0;
+    }
+    pthread_mutex_unlock( &shared_ng_mutex );
+    BN_CTX_free( ctx );
+}
+
+static void delete_ng_data( NGConstant * ng )
+{
+    int i;
+    for (i = 0; i <= SRP_SHA512; i++)
+    {
+        if (ng->hash[i])
+        {
+            BN_free( ng->hash[i]->k_orig );
+            BN_free( ng->hash[i]->k_rfc5054 );
+            free( ng->hash[i] );
+        }
+    }
+    BN_MONT_CTX_free( ng->mont );
+    BN_free( ng->N );
+    BN_free( ng->g );
+    free( ng );
+}
+
+static BIGNUM * H_nn_orig( SRP_HashAlgorithm alg, const BIGNUM * n1, const BIGNUM * n2 );
+static BIGNUM * H_nn_rfc5054( SRP_HashAlgorithm alg, const BIGNUM * N, const BIGNUM * n1, const BIGNUM * n2 );
+static void hash_num( SRP_HashAlgorithm alg, const BIGNUM * n, unsigned char * dest );
+static int hash_length( SRP_HashAlgorithm alg );
+
+/* precompute the shared constants of a standard group */
+static int init_shared_ng( NGConstant * ng )
+{
+    unsigned char H_N[ SHA512_DIGEST_LENGTH ];
+    unsigned char H_g[ SHA512_DIGEST_LENGTH ];
+    BN_CTX * ctx = BN_CTX_new();
+    int alg, i;
+
+    ng->mont = BN_MONT_CTX_new();
+    if ( !ctx || !ng->mont || !BN_MONT_CTX_set( ng->mont, ng->N, ctx ) )
+    {
+        BN_CTX_free( ctx );
+        return 0;
+    }
+    BN_CTX_free( ctx );
+
+    for (alg = SRP_SHA1; alg <= SRP_SHA512; alg++)
+    {
+        NGHashConstants * hc = (NGHashConstants *) calloc( 1, sizeof(NGHashConstants) );
+        if (!hc)
+            return 0;
+        ng->hash[alg] = hc;
+        hc->k_orig    = H_nn_orig( alg, ng->N, ng->g );
+        hc->k_rfc5054 = H_nn_rfc5054( alg, ng->N, ng->N, ng->g );
+        if ( !hc->k_orig || !hc->k_rfc5054 )
+            return 0;
+        hash_num( alg, ng->N, H_N );
+        hash_num( alg, ng->g, H_g );
+        for (i = 0; i < hash_length(alg); i++)
+            hc->H_xor[i] = H_N[i] ^ H_g[i];
+    }
+    ng->shared = 1;
+    return 1;
+}
+
+static NGConstant * new_ng( SRP_NGType ng_type, const char * n_hex, const char * g_hex )
+{
+    NGConstant * ng;
+    int idx = -1;
 
     if ( ng_type != SRP_NG_CUSTOM )
     {
-        int idx = ng_type;
+        idx = ng_type;
         if ( ng_type > SRP_NG_CUSTOM )
            idx -= 1;
         n_hex = global_Ng_constants[ idx ].n_hex;
         g_hex = global_Ng_constants[ idx ].g_hex;
+
+        pthread_mutex_lock( &shared_ng_mutex );
+        ng = shared_ng[ idx ];
+        pthread_mutex_unlock( &shared_ng_mutex );
+        if (ng)
+            return ng;
+    }
+
+    ng                = (NGConstant *) calloc( 1, sizeof(NGConstant) );
+    if (!ng)
+       return 0;
+    ng->N             = BN_new();
+    ng->g             = BN_new();
+
+    if( !ng->N || !ng->g )
+    {
+       delete_ng_data( ng );
+       return 0;
     }
     BN_hex2bn( &ng->N, n_hex );
     BN_hex2bn( &ng->g, g_hex );
 
+    if ( idx >= 0 )
+    {
+        if ( !init_shared_ng( ng ) )
+        {
+            delete_ng_data( ng );
+            return 0;
+        }
+        pthread_mutex_lock( &shared_ng_mutex );
+        if ( shared_ng[ idx ] )
+        {
+            /* another thread got there first */
+            delete_ng_data( ng );
+            ng = shared_ng[ idx ];
+        }
+        else
+        {
+            shared_ng[ idx ] = ng;
+        }
+        pthread_mutex_unlock( &shared_ng_mutex );
+    }
     return ng;
 }
 
 static void delete_ng( NGConstant * ng )
 {
-   if (ng)
+   if (ng && !ng->shared)
    {
-      BN_free( ng->N );
-      BN_free( ng->g );
-      ng->N = 0;
-      ng->g = 0;
-      free(ng);
+      delete_ng_data( ng );
    }
 }
 
+/* r = a^p mod N */
+static int ng_mod_exp( BIGNUM * r, const BIGNUM * a, const BIGNUM * p, const NGConstant * ng, BN_CTX * ctx )
+{
+    if (ng->mont)
+        return BN_mod_exp_mont( r, a, p, ng->N, ctx, ng->mont );
+    return BN_mod_exp( r, a, p, ng->N, ctx );
+}
+
+/* the SRP-6a multiplier k (a new BIGNUM, to be freed by the caller) */
+static BIGNUM * ng_k( SRP_HashAlgorithm alg, const NGConstant * ng, int rfc5054_compat )
+{
+    if (ng->hash[alg])
+        return BN_dup( rfc5054_compat ? ng->hash[alg]->k_rfc5054 : ng->hash[alg]->k_orig );
+    if (rfc5054_compat)
+        return H_nn_rfc5054( alg, ng->N, ng->N, ng->g );
+    return H_nn_orig( alg, ng->N, ng->g );
+}
+
 typedef struct HashCTX_s {
    EVP_MD_CTX *digest_ctx;
 } HashCTX_t;
@@ -529,13 +682,19 @@ static void calculate_M( SRP_HashAlgorithm alg, NGConstant *ng, unsigned char *
     int           i = 0;
     int           hash_len = hash_length(alg);
 
-    hash_num( alg, ng->N, H_N );
-    hash_num( alg, ng->g, H_g );
+    if (ng->hash[alg])
+    {
+        memcpy( H_xor, ng->hash[alg]->H_xor, hash_len );
+    }
+    else
+    {
+        hash_num( alg, ng->N, H_N );
+        hash_num( alg, ng->g, H_g );
+        for (i=0; i < hash_len; i++ )
+            H_xor[i] = H_N[i] ^ H_g[i];
+    }
     hash(alg, (const unsigned char *)I, strlen(I), H_I);
 
-    for (i=0; i < hash_len; i++ )
-        H_xor[i] = H_N[i] ^ H_g[i];
-
     ctx = hash_create();
     hash_init( alg, ctx);
     hash_update( alg, ctx, H_xor, hash_len );
@@ -629,7 +788,7 @@ void srp_create_salted_verification_key( SRP_HashAlgorithm alg,
     BIGNUM     * s   = BN_new();
     BIGNUM     * v   = BN_new();
     BIGNUM     * x   = 0;
-    BN_CTX     * ctx = BN_CTX_new();
+    BN_CTX     * ctx = get_bn_ctx();
     NGConstant * ng  = new_ng( ng_type, n_hex, g_hex );
 
     if( !s || !v || !ctx || !ng )
@@ -647,7 +806,7 @@ void srp_create_salted_verification_key( SRP_HashAlgorithm alg,
     if( !x )
        goto cleanup_and_exit;
 
-    BN_mod_exp(v, ng->g, x, ng->N, ctx);
+    ng_mod_exp(v, ng->g, x, ng, ctx);
 
     *len_s   = BN_num_bytes(s);
     *len_v   = BN_num_bytes(v);
@@ -666,7 +825,7 @@ void srp_create_salted_verification_key( SRP_HashAlgorithm alg,
     BN_free(s);
     BN_free(v);
     BN_free(x);
-    BN_CTX_free(ctx);
+    put_bn_ctx(ctx);
 }
 #ifdef APPLE_VARIANT
 
@@ -686,7 +845,7 @@ void srp_create_server_ephemeral_key( SRP_HashAlgorithm alg, SRP_NGType ng_type,
   BIGNUM             *B    = BN_new();
   BIGNUM             *b    = BN_new();
   BIGNUM             *k    = 0;
-  BN_CTX             *ctx  = BN_CTX_new();
+  BN_CTX             *ctx  = get_bn_ctx();
   NGConstant         *ng   = new_ng( ng_type, n_hex, g_hex );
 
   *len_B   = 0;
@@ -695,12 +854,9 @@ void srp_create_server_ephemeral_key( SRP_HashAlgorithm alg, SRP_NGType ng_type,
   if( !v || !B || !b || !tmp1 || !tmp2 || !ctx || !ng )
     goto cleanup_and_exit;
 
-  b = BN_bin2bn(bytes_b, len_b, NULL);
+  b = BN_bin2bn(bytes_b, len_b, b);
   
-  if (rfc5054_compat)
-    k = H_nn_rfc5054(alg, ng->N, ng->N, ng->g);
-  else
-    k = H_nn_orig(alg, ng->N, ng->g);
+  k = ng_k(alg, ng, rfc5054_compat);
   
   if(!k)
     goto cleanup_and_exit;
@@ -709,13 +865,13 @@ void srp_create_server_ephemeral_key( SRP_HashAlgorithm alg, SRP_NGType ng_type,
   if (rfc5054_compat)
     {
       BN_mod_mul(tmp1, k, v, ng->N, ctx);
-      BN_mod_exp(tmp2, ng->g, b, ng->N, ctx);
+      ng_mod_exp(tmp2, ng->g, b, ng, ctx);
       BN_mod_add(B, tmp1, tmp2, ng->N, ctx);
     }
   else
     {
       BN_mul(tmp1, k, v, ctx);
-      BN_mod_exp(tmp2, ng->g, b, ng->N, ctx);
+      ng_mod_exp(tmp2, ng->g, b, ng, ctx);
       BN_add(B, tmp1, tmp2);
     }
 
@@ -730,7 +886,8 @@ void srp_create_server_ephemeral_key( SRP_HashAlgorithm alg, SRP_NGType ng_type,
    BN_free(b);
    BN_free(tmp1);
    BN_free(tmp2);
-   BN_CTX_free(ctx);
+   delete_ng(ng);
+   put_bn_ctx(ctx);
 }
 #endif
 
@@ -759,7 +916,7 @@ struct SRPVerifier *  srp_verifier_new( SRP_HashAlgorithm alg, SRP_NGType ng_typ
     BIGNUM             *k    = 0;
     BIGNUM             *tmp1 = BN_new();
     BIGNUM             *tmp2 = BN_new();
-    BN_CTX             *ctx  = BN_CTX_new();
+    BN_CTX             *ctx  = get_bn_ctx();
     int                 ulen = strlen(username) + 1;
     NGConstant         *ng   = new_ng( ng_type, n_hex, g_hex );
     struct SRPVerifier *ver  = 0;
@@ -803,14 +960,11 @@ struct SRPVerifier *  srp_verifier_new( SRP_HashAlgorithm alg, SRP_NGType ng_typ
        BN_rand(b, 256, -1, 0);
 #ifdef APPLE_VARIANT
        } else {
-           b = BN_bin2bn(bytes_b, len_b, NULL);
+           b = BN_bin2bn(bytes_b, len_b, b);
        }
 #endif
 
-       if (rfc5054_compat)
-          k = H_nn_rfc5054(alg, ng->N, ng->N, ng->g);
-       else
-          k = H_nn_orig(alg, ng->N, ng->g);
+       k = ng_k(alg, ng, rfc5054_compat);
 
        if(!k)
        {
@@ -823,13 +977,13 @@ struct SRPVerifier *  srp_verifier_new( SRP_HashAlgorithm alg, SRP_NGType ng_typ
        if (rfc5054_compat)
        {
           BN_mod_mul(tmp1, k, v, ng->N, ctx);
-          BN_mod_exp(tmp2, ng->g, b, ng->N, ctx);
+          ng_mod_exp(tmp2, ng->g, b, ng, ctx);
           BN_mod_add(B, tmp1, tmp2, ng->N, ctx);
        }
        else
        {
           BN_mul(tmp1, k, v, ctx);
-          BN_mod_exp(tmp2, ng->g, b, ng->N, ctx);
+          ng_mod_exp(tmp2, ng->g, b, ng, ctx);
           BN_add(B, tmp1, tmp2);
        }
 
@@ -846,9 +1000,9 @@ struct SRPVerifier *  srp_verifier_new( SRP_HashAlgorithm alg, SRP_NGType ng_typ
        }
 
        /* S = (A *(v^u)) ^ b */
-       BN_mod_exp(tmp1, v, u, ng->N, ctx);
+       ng_mod_exp(tmp1, v, u, ng, ctx);
        BN_mul(tmp2, A, tmp1, ctx);
-       BN_mod_exp(S, tmp2, b, ng->N, ctx);
+       ng_mod_exp(S, tmp2, b, ng, ctx);
 
 #ifdef APPLE_VARIANT
        hash_session_key(alg, S, ver->session_key);
@@ -889,7 +1043,7 @@ struct SRPVerifier *  srp_verifier_new( SRP_HashAlgorithm alg, SRP_NGType ng_typ
     BN_free(b);
     BN_free(tmp1);
     BN_free(tmp2);
-    BN_CTX_free(ctx);
+    put_bn_ctx(ctx);
 
     return ver;
 }
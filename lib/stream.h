@@ -27,6 +27,8 @@ typedef struct {
     int data_len;
     uint64_t ntp_time_local;
     uint64_t ntp_time_remote;
+    uint64_t time_received;     /* local time, see latency_trace.h */
+    uint64_t time_decrypted;
 } h264_decode_struct;
 
 typedef struct {
@@ -37,6 +39,8 @@ typedef struct {
     uint64_t ntp_time_local;
     uint64_t ntp_time_remote;
     uint64_t rtp_time;
+    uint64_t time_received;     /* local time, see latency_trace.h */
+    uint64_t time_decrypted;
     unsigned short seqnum;
 } audio_decode_struct;
 
@@ -0,0 +1,298 @@
+/**
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *===================================================================
+ * UxPlay contributors 2026
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE    /* pthread_setaffinity_np, cpu_set_t */
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+#include "thread_policy.h"
+#include "logger.h"
+
+#define MAX_CPUS 64                 /* cpus are kept as a 64-bit mask */
+#define DEFAULT_RT_PRIORITY 10      /* for sched=fifo or sched=rr without prio= */
+
+typedef struct thread_policy_s {
+    bool set;
+    int sched;                      /* SCHED_FIFO, SCHED_RR, SCHED_OTHER, or -1: unchanged */
+    int priority;
+    bool has_nice;
+    int nice;
+    uint64_t cpus;                  /* 0: unchanged */
+    char cpu_list[64];
+} thread_policy_t;
+
+static thread_policy_t policies[THREAD_ROLES];
+
+static const char *role_names[THREAD_ROLES] = { "audio", "mirror", "ntp", "httpd", "gst-audio", "gst-video" };
+
+static const char *
+sched_name(int sched)
+{
+    switch (sched) {
+    case SCHED_FIFO:
+        return "SCHED_FIFO";
+    case SCHED_RR:
+        return "SCHED_RR";
+    default:
+        return "SCHED_OTHER";
+    }
+}
+
+static bool
+parse_int(const char *str, int min, int max, int *value)
+{
+    char *end;
+    long n = strtol(str, &end, 10);
+    if (end == str || *end || n < min || n > max) {
+        return false;
+    }
+    *value = (int) n;
+    return true;
+}
+
+/* "0,2-3" -> 0b1101 */
+static bool
+parse_cpu_list(const char *str, uint64_t *cpus)
+{
+    const char *p = str;
+    *cpus = 0;
+    while (*p) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (end == p || first < 0 || first >= MAX_CPUS) {
+            return false;
+        }
+        p = end;
+        if (*p == '-') {
+            last = strtol(++p, &end, 10);
+            if (end == p || last < first || last >= MAX_CPUS) {
+                return false;
+            }
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            *cpus |= (uint64_t) 1 << cpu;
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p) {
+            return false;
+        }
+    }
+    return (*cpus != 0);
+}
+
+int
+thread_policy_parse(const char *spec, char *error, int error_len)
+{
+    thread_policy_t policy;
+    char buffer[256];
+    char *field, *saveptr = NULL;
+    bool has_priority = false;
+    unsigned int roles = 0;
+
+    memset(&policy, 0, sizeof(policy));
+    policy.set = true;
+    policy.sched = -1;
+    if (strlen(spec) >= sizeof(buffer)) {
+        snprintf(error, error_len, "too long");
+        return -1;
+    }
+    strcpy(buffer, spec);
+
+    field = strtok_r(buffer, ":", &saveptr);
+    if (field && !strcmp(field, "gst")) {
+        roles = (1 << THREAD_ROLE_GST_AUDIO) | (1 << THREAD_ROLE_GST_VIDEO);
+    } else {
+        for (int i = 0; field && i < THREAD_ROLES; i++) {
+            if (!strcmp(field, role_names[i])) {
+                roles = 1 << i;
+            }
+        }
+    }
+    if (!roles) {
+        snprintf(error, error_len, "unknown thread role \"%s\" (audio, mirror, ntp, httpd, gst-audio, gst-video, gst)",
+                 field ? field : "");
+        return -1;
+    }
+
+    while ((field = strtok_r(NULL, ":", &saveptr))) {
+        char *value = strchr(field, '=');
+        if (!value) {
+            snprintf(error, error_len, "\"%s\" is not of the form key=value", field);
+            return -1;
+        }
+        *value++ = '\0';
+        if (!strcmp(field, "sched")) {
+            if (!strcmp(value, "fifo")) {
+                policy.sched = SCHED_FIFO;
+            } else if (!strcmp(value, "rr")) {
+                policy.sched = SCHED_RR;
+            } else if (!strcmp(value, "other")) {
+                policy.sched = SCHED_OTHER;
+            } else {
+                snprintf(error, error_len, "unknown scheduling policy \"%s\" (fifo, rr, other)", value);
+                return -1;
+            }
+        } else if (!strcmp(field, "prio")) {
+            if (!parse_int(value, 1, 99, &policy.priority)) {
+                snprintf(error, error_len, "invalid priority \"%s\" (range 1-99)", value);
+                return -1;
+            }
+            has_priority = true;
+        } else if (!strcmp(field, "nice")) {
+            if (!parse_int(value, -20, 19, &policy.nice)) {
+                snprintf(error, error_len, "invalid nice value \"%s\" (range -20 to 19)", value);
+                return -1;
+            }
+            policy.has_nice = true;
+        } else if (!strcmp(field, "cpus")) {
+            if (strlen(value) >= sizeof(policy.cpu_list) || !parse_cpu_list(value, &policy.cpus)) {
+                snprintf(error, error_len, "invalid cpu list \"%s\" (like 0,2-3; cpus 0-%d)", value, MAX_CPUS - 1);
+                return -1;
+            }
+            strcpy(policy.cpu_list, value);
+        } else {
+            snprintf(error, error_len, "unknown key \"%s\" (sched, prio, nice, cpus)", field);
+            return -1;
+        }
+    }
+
+    if (policy.sched == SCHED_FIFO || policy.sched == SCHED_RR) {
+        int min = sched_get_priority_min(policy.sched);
+        int max = sched_get_priority_max(policy.sched);
+        if (!has_priority) {
+            policy.priority = DEFAULT_RT_PRIORITY;
+        }
+        if (policy.priority < min || policy.priority > max) {
+            snprintf(error, error_len, "priority %d is outside the %s range %d-%d", policy.priority,
+                     sched_name(policy.sched), min, max);
+            return -1;
+        }
+    } else if (has_priority) {
+        snprintf(error, error_len, "prio= needs sched=fifo or sched=rr");
+        return -1;
+    } else if (policy.sched == -1 && !policy.has_nice && !policy.cpus) {
+        snprintf(error, error_len, "nothing to set (sched, prio, nice, cpus)");
+        return -1;
+    }
+
+    for (int i = 0; i < THREAD_ROLES; i++) {
+        if (roles & (1 << i)) {
+            policies[i] = policy;
+        }
+    }
+    return 0;
+}
+
+bool
+thread_policy_is_set(thread_role_t role)
+{
+    assert(role < THREAD_ROLES);
+    return policies[role].set;
+}
+
+void
+thread_policy_apply(thread_role_t role, logger_t *logger)
+{
+    const thread_policy_t *policy;
+    char applied[128];
+    int len = 0;
+    int ret;
+
+    assert(role < THREAD_ROLES);
+    policy = &policies[role];
+    if (!policy->set) {
+        return;
+    }
+    applied[0] = '\0';
+
+    if (policy->sched >= 0) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = (policy->sched == SCHED_OTHER) ? 0 : policy->priority;
+        ret = pthread_setschedparam(pthread_self(), policy->sched, &param);
+        if (ret) {
+            logger_log(logger, LOGGER_WARNING, "%s thread: could not set %s priority %d: %s%s; "
+                       "continuing with the default scheduling policy", role_names[role], sched_name(policy->sched),
+                       param.sched_priority, strerror(ret),
+                       (ret == EPERM) ? " (needs CAP_SYS_NICE, or an RLIMIT_RTPRIO (ulimit -r) of at least the priority)" : "");
+        } else if (policy->sched == SCHED_OTHER) {
+            len += snprintf(applied + len, sizeof(applied) - len, "%s %s", len ? "," : "",
+                            sched_name(policy->sched));
+        } else {
+            len += snprintf(applied + len, sizeof(applied) - len, "%s %s priority %d", len ? "," : "",
+                            sched_name(policy->sched), param.sched_priority);
+        }
+    }
+
+    if (policy->has_nice) {
+#if defined(__linux__)
+        /* on Linux, nice values are per thread */
+        if (setpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid), policy->nice)) {
+            int err = errno;
+            logger_log(logger, LOGGER_WARNING, "%s thread: could not set nice %d: %s%s; continuing with nice %d",
+                       role_names[role], policy->nice, strerror(err),
+                       (err == EACCES || err == EPERM) ? " (lowering nice needs CAP_SYS_NICE, or RLIMIT_NICE (ulimit -e))" : "",
+                       getpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid)));
+        } else if (len < (int) sizeof(applied)) {
+            len += snprintf(applied + len, sizeof(applied) - len, "%s nice %d", len ? "," : "", policy->nice);
+        }
+#else
+        logger_log(logger, LOGGER_WARNING, "%s thread: per-thread nice values are not supported on this platform",
+                   role_names[role]);
+#endif
+    }
+
+    if (policy->cpus) {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+            if (policy->cpus & ((uint64_t) 1 << cpu)) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (ret) {
+            logger_log(logger, LOGGER_WARNING, "%s thread: could not set cpu affinity %s: %s; "
+                       "continuing on all cpus", role_names[role], policy->cpu_list, strerror(ret));
+        } else if (len < (int) sizeof(applied)) {
+            len += snprintf(applied + len, sizeof(applied) - len, "%s cpus %s", len ? "," : "", policy->cpu_list);
+        }
+#else
+        logger_log(logger, LOGGER_WARNING, "%s thread: cpu affinity is not supported on this platform",
+                   role_names[role]);
+#endif
+    }
+
+    if (len) {
+        logger_log(logger, LOGGER_INFO, "%s thread:%s", role_names[role], applied);
+    }
+}
@@ -0,0 +1,57 @@
+/**
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *===================================================================
+ * UxPlay contributors 2026
+ */
+
+/* Scheduling policy (SCHED_FIFO/SCHED_RR priority), nice value and CPU affinity for each   *
+ * receiver thread role.  Policies are process-wide, set (before the threads start) from   *
+ * "-thread" options, and applied by each thread to itself with thread_policy_apply() when *
+ * it starts; GStreamer streaming threads apply theirs from a bus sync handler when they   *
+ * post their STREAM_STATUS "enter" message.  If the process lacks the permission needed   *
+ * (CAP_SYS_NICE, or RLIMIT_RTPRIO / RLIMIT_NICE), a warning is logged and the thread      *
+ * continues with the settings it has.  Nice values and affinity are only set on Linux.    */
+
+#ifndef THREAD_POLICY_H
+#define THREAD_POLICY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "logger.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum thread_role_e {
+    THREAD_ROLE_AUDIO,          /* raop-audio: AirPlay audio RTP receiver */
+    THREAD_ROLE_MIRROR,         /* raop-mirror: screen-mirroring video receiver */
+    THREAD_ROLE_NTP,            /* raop-ntp: timing */
+    THREAD_ROLE_HTTPD,          /* httpd: RTSP/HTTP connections */
+    THREAD_ROLE_GST_AUDIO,      /* GStreamer streaming threads of the audio pipelines */
+    THREAD_ROLE_GST_VIDEO,      /* GStreamer streaming threads of the video pipeline */
+    THREAD_ROLES
+} thread_role_t;
+
+/* parse "<role>[:sched=fifo|rr|other][:prio=n][:nice=n][:cpus=list]" (list as in "0,2-3") *
+ * and set the policy of that role; returns 0, or -1 (with a message in error) if invalid  */
+int thread_policy_parse(const char *spec, char *error, int error_len);
+
+bool thread_policy_is_set(thread_role_t role);
+
+/* apply the policy (if any) of role to the calling thread, and log the result */
+void thread_policy_apply(thread_role_t role, logger_t *logger);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //THREAD_POLICY_H
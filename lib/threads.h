@@ -22,6 +22,9 @@
 
 #include <pthread.h>
 #include <unistd.h>
+#if defined(__linux__)
+#include <sys/prctl.h>
+#endif
 
 #define sleepms(x) usleep((x)*1000)
 
@@ -32,6 +35,15 @@ typedef pthread_t thread_handle_t;
 	if (pthread_create(&(handle), NULL, func, arg)) handle = 0
 #define THREAD_JOIN(handle) pthread_join(handle, NULL)
 
+/* name the calling thread (at most 15 characters), as seen by top -H, gdb, /proc */
+#if defined(__linux__)
+#define THREAD_SET_NAME(name) prctl(PR_SET_NAME, (unsigned long) (name), 0, 0, 0)
+#elif defined(__APPLE__)
+#define THREAD_SET_NAME(name) pthread_setname_np(name)
+#else
+#define THREAD_SET_NAME(name)
+#endif
+
 typedef pthread_mutex_t mutex_handle_t;
 
 typedef pthread_cond_t cond_handle_t;
@@ -0,0 +1,83 @@
+/**
+ * UxPlay - An open-source AirPlay mirroring server
+ * Copyright (C) 2026 UxPlay contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/*
+ * The part of the recorder and of re-streaming that follows the client sessions: a pipeline
+ * fed by appsrcs with the (undecoded) mirror video and/or audio of the current session.  It
+ * starts with the first video keyframe, or with the first audio frame of an audio-only session
+ * (AAC-ELD audio accompanies mirrored video, and waits for it), and is replaced by a new one
+ * when video is added to audio or the audio format changes.  Frames that cannot be queued are
+ * dropped, and video then resumes at the next keyframe.  Pipelines are finished (EOS) in
+ * background threads, so the receiver threads never wait for them.  Internal to renderers/.
+ */
+
+#ifndef APPSRC_SESSION_H
+#define APPSRC_SESSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <gst/gst.h>
+#include "../lib/logger.h"
+
+#define APPSRC_SESSION_AAC_ELD 8           /* ct of the audio stream that accompanies screen mirroring */
+#define APPSRC_SESSION_H264_CAPS "video/x-h264,stream-format=(string)byte-stream,alignment=(string)au"
+
+typedef struct appsrc_session_s {
+    GstElement *pipeline, *video_src, *audio_src;
+    unsigned char audio_ct;                /* 0: no audio (audio_src is NULL if the pipeline refused it) */
+    uint64_t base_time;                    /* remote ntp time of pts 0 */
+    bool need_keyframe;                    /* video was dropped: drop until the next IDR frame */
+    gint failed;
+} appsrc_session_t;
+
+typedef struct appsrc_session_stats_s {
+    uint64_t video_frames;                 /* frames queued */
+    uint64_t audio_frames;
+    uint64_t dropped_frames;               /* frames dropped because the pipeline could not keep up */
+    bool active;                           /* a session pipeline is running */
+} appsrc_session_stats_t;
+
+/* adds the elements fed by session->video_src and/or session->audio_src (already in          *
+ * session->pipeline) and links them; an audio_src that cannot be linked may be removed from  *
+ * the pipeline and set to NULL.  Returns false if the session cannot be started.            */
+typedef bool (*appsrc_session_build_t)(appsrc_session_t *session);
+/* called (in a streaming thread) with each element message of a session pipeline */
+typedef void (*appsrc_session_message_t)(const GstStructure *structure);
+
+typedef struct appsrc_sessions_s appsrc_sessions_t;
+
+/* activity ("recording", "re-streaming") is used in log messages; element_message may be NULL */
+appsrc_sessions_t *appsrc_sessions_init(logger_t *logger, const char *activity, uint64_t queue_bytes,
+                                        int close_timeout_secs, appsrc_session_build_t build,
+                                        appsrc_session_message_t element_message);
+/* the caps of the audio renderer (see audio_renderer_gstreamer.c) for compression type ct, *
+ * or NULL if ct is unknown                                                                */
+const char *appsrc_session_audio_caps(unsigned char ct);
+void appsrc_sessions_video_frame(appsrc_sessions_t *sessions, const unsigned char *data, int data_len,
+                                 bool keyframe, uint64_t ntp_time_remote);
+/* ct must have caps (appsrc_session_audio_caps) */
+void appsrc_sessions_audio_frame(appsrc_sessions_t *sessions, const unsigned char *data, int data_len,
+                                 unsigned char ct, uint64_t ntp_time_remote);
+void appsrc_sessions_stop(appsrc_sessions_t *sessions);      /* end of a client session */
+void appsrc_sessions_get_stats(appsrc_sessions_t *sessions, appsrc_session_stats_t *stats);
+/* ends the current session, and waits (at most close_timeout_secs + 1) for all pipelines to finish. *
+ * sessions is not freed: its stats can still be read (e.g. by the metrics thread)                    */
+void appsrc_sessions_finish(appsrc_sessions_t *sessions);
+
+#endif //APPSRC_SESSION_H
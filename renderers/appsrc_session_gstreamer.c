@@ -0,0 +1,324 @@
+/**
+ * UxPlay - An open-source AirPlay mirroring server
+ * Copyright (C) 2026 UxPlay contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+#include "appsrc_session.h"
+
+#define AUDIO_RECENT_USECS 1000000             /* a new session includes audio if it was received this recently */
+
+/* the caps of the audio renderer (see audio_renderer_gstreamer.c), but with a "channels" field: *
+ * the decoders there take it from codec_data, while muxers and payloaders refuse caps without it */
+static const char lpcm_caps[]="audio/x-raw,rate=(int)44100,channels=(int)2,format=S16LE,layout=interleaved";
+static const char alac_caps[] = "audio/x-alac,channels=(int)2,rate=(int)44100,codec_data=(buffer)"
+                           "00000024""616c6163""00000000""00000160""0010280a""0e0200ff""00000000""00000000""0000ac44";
+static const char aac_lc_caps[] ="audio/mpeg,mpegversion=(int)4,channels=(int)2,rate=(int)44100,stream-format=raw,codec_data=(buffer)1210";
+static const char aac_eld_caps[] ="audio/mpeg,mpegversion=(int)4,channels=(int)2,rate=(int)44100,stream-format=raw,codec_data=(buffer)f8e85000";
+
+struct appsrc_sessions_s {
+    logger_t *logger;
+    const char *activity;
+    uint64_t queue_bytes;                      /* per appsrc */
+    int close_timeout_secs;
+    appsrc_session_build_t build;
+    appsrc_session_message_t element_message;
+
+    GMutex mutex;                              /* protects the variables below */
+    appsrc_session_t *session;
+    bool session_failed;                       /* no new session until appsrc_sessions_stop() */
+    unsigned char audio_ct;                    /* format of the last audio frame */
+    gint64 audio_seen;                         /* when it was received (g_get_monotonic_time) */
+
+    GMutex close_mutex;
+    GCond close_cond;
+    int closing;                               /* pipelines being finished by close threads */
+
+    appsrc_session_stats_t stats;              /* updated atomically */
+};
+
+/* a session pipeline, with the sessions it belongs to (for its close thread and bus handler) */
+typedef struct session_pipeline_s {
+    appsrc_session_t session;
+    appsrc_sessions_t *sessions;
+} session_pipeline_t;
+
+const char *appsrc_session_audio_caps(unsigned char ct) {
+    switch (ct) {
+    case 1:
+        return lpcm_caps;
+    case 2:
+        return alac_caps;
+    case 4:
+        return aac_lc_caps;
+    case 8:
+        return aac_eld_caps;
+    default:
+        return NULL;
+    }
+}
+
+appsrc_sessions_t *appsrc_sessions_init(logger_t *logger, const char *activity, uint64_t queue_bytes,
+                                        int close_timeout_secs, appsrc_session_build_t build,
+                                        appsrc_session_message_t element_message) {
+    appsrc_sessions_t *sessions = (appsrc_sessions_t *) calloc(1, sizeof(appsrc_sessions_t));
+    g_assert(sessions);
+    sessions->logger = logger;
+    sessions->activity = activity;
+    sessions->queue_bytes = queue_bytes;
+    sessions->close_timeout_secs = close_timeout_secs;
+    sessions->build = build;
+    sessions->element_message = element_message;
+    g_mutex_init(&sessions->mutex);
+    g_mutex_init(&sessions->close_mutex);
+    g_cond_init(&sessions->close_cond);
+    return sessions;
+}
+
+static GstBusSyncReply session_sync_handler(GstBus *bus, GstMessage *message, gpointer user_data) {
+    session_pipeline_t *pipeline = (session_pipeline_t *) user_data;
+    appsrc_sessions_t *sessions = pipeline->sessions;
+    switch (GST_MESSAGE_TYPE(message)) {
+    case GST_MESSAGE_ERROR: {
+        GError *err = NULL;
+        gst_message_parse_error(message, &err, NULL);
+        logger_log(sessions->logger, LOGGER_ERR, "%s failed: %s", sessions->activity,
+                   err ? err->message : "unknown error");
+        g_clear_error(&err);
+        g_atomic_int_set(&pipeline->session.failed, 1);
+        return GST_BUS_PASS;
+    }
+    case GST_MESSAGE_EOS:
+        return GST_BUS_PASS;
+    case GST_MESSAGE_ELEMENT:
+        if (sessions->element_message && gst_message_get_structure(message)) {
+            sessions->element_message(gst_message_get_structure(message));
+        }
+        break;
+    default:
+        break;
+    }
+    /* nothing reads the bus except the close thread, which waits for EOS or ERROR */
+    return GST_BUS_DROP;
+}
+
+static GstElement *make_appsrc(const char *caps_string, uint64_t queue_bytes) {
+    GstElement *appsrc = gst_element_factory_make("appsrc", NULL);
+    GstCaps *caps = gst_caps_from_string(caps_string);
+    g_object_set(appsrc, "caps", caps, "stream-type", 0, "is-live", TRUE, "format", GST_FORMAT_TIME,
+                 "max-bytes", (guint64) queue_bytes, "block", FALSE, NULL);
+    gst_caps_unref(caps);
+    return appsrc;
+}
+
+/* call with mutex held */
+static appsrc_session_t *session_start(appsrc_sessions_t *sessions, bool video, unsigned char ct,
+                                       uint64_t base_time) {
+    session_pipeline_t *pipeline = (session_pipeline_t *) calloc(1, sizeof(session_pipeline_t));
+    g_assert(pipeline);
+    appsrc_session_t *session = &pipeline->session;
+    pipeline->sessions = sessions;
+    session->pipeline = gst_pipeline_new(NULL);
+    session->base_time = base_time;
+    if (video) {
+        session->video_src = make_appsrc(APPSRC_SESSION_H264_CAPS, sessions->queue_bytes);
+        gst_bin_add(GST_BIN(session->pipeline), session->video_src);
+    }
+    if (ct && appsrc_session_audio_caps(ct)) {
+        session->audio_src = make_appsrc(appsrc_session_audio_caps(ct), sessions->queue_bytes);
+        session->audio_ct = ct;
+        gst_bin_add(GST_BIN(session->pipeline), session->audio_src);
+    }
+    bool built = sessions->build(session);
+
+    GstBus *bus = gst_element_get_bus(session->pipeline);
+    gst_bus_set_sync_handler(bus, session_sync_handler, pipeline, NULL);
+    gst_object_unref(bus);
+
+    if (!built || gst_element_set_state(session->pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        logger_log(sessions->logger, LOGGER_ERR, "could not start %s", sessions->activity);
+        gst_element_set_state(session->pipeline, GST_STATE_NULL);
+        gst_object_unref(session->pipeline);
+        free(pipeline);
+        return NULL;
+    }
+    logger_log(sessions->logger, LOGGER_INFO, "started %s (%s%s%s)", sessions->activity, video ? "h264" : "",
+               (video && session->audio_src) ? " + " : "", session->audio_src ? "audio" : "");
+    return session;
+}
+
+/* sends EOS, and waits for the pipeline to finish (e.g. the files to be written) */
+static gpointer close_thread(gpointer data) {
+    session_pipeline_t *pipeline = (session_pipeline_t *) data;
+    appsrc_session_t *session = &pipeline->session;
+    appsrc_sessions_t *sessions = pipeline->sessions;
+    GstBus *bus = gst_element_get_bus(session->pipeline);
+    if (session->video_src) {
+        gst_app_src_end_of_stream(GST_APP_SRC(session->video_src));
+    }
+    if (session->audio_src) {
+        gst_app_src_end_of_stream(GST_APP_SRC(session->audio_src));
+    }
+    GstMessage *message = gst_bus_timed_pop_filtered(bus, sessions->close_timeout_secs * GST_SECOND,
+                                                     (GstMessageType) (GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+    if (!message) {
+        logger_log(sessions->logger, LOGGER_ERR, "%s was not finished within %d seconds", sessions->activity,
+                   sessions->close_timeout_secs);
+    } else {
+        gst_message_unref(message);
+    }
+    gst_object_unref(bus);
+    gst_element_set_state(session->pipeline, GST_STATE_NULL);
+    gst_object_unref(session->pipeline);
+    free(pipeline);
+
+    g_mutex_lock(&sessions->close_mutex);
+    sessions->closing--;
+    g_cond_broadcast(&sessions->close_cond);
+    g_mutex_unlock(&sessions->close_mutex);
+    return NULL;
+}
+
+/* call with mutex held; the receiver threads do not wait for the pipeline to finish */
+static void session_close(appsrc_sessions_t *sessions) {
+    if (!sessions->session) {
+        return;
+    }
+    g_mutex_lock(&sessions->close_mutex);
+    sessions->closing++;
+    g_mutex_unlock(&sessions->close_mutex);
+    /* (session is the first member of its session_pipeline_t) */
+    g_thread_unref(g_thread_new("appsrc-close", close_thread, sessions->session));
+    sessions->session = NULL;
+    __atomic_store_n(&sessions->stats.active, false, __ATOMIC_RELAXED);
+}
+
+/* call with mutex held */
+static void session_check_failed(appsrc_sessions_t *sessions) {
+    if (sessions->session && g_atomic_int_get(&sessions->session->failed)) {
+        session_close(sessions);
+        sessions->session_failed = true;
+    }
+}
+
+/* call with mutex held */
+static void session_open(appsrc_sessions_t *sessions, bool video, unsigned char ct, uint64_t base_time) {
+    sessions->session = session_start(sessions, video, ct, base_time);
+    sessions->session_failed = !sessions->session;
+    __atomic_store_n(&sessions->stats.active, sessions->session != NULL, __ATOMIC_RELAXED);
+}
+
+static bool push(appsrc_sessions_t *sessions, GstElement *appsrc, const unsigned char *data, int len,
+                 uint64_t ntp_time, bool delta) {
+    appsrc_session_t *session = sessions->session;
+    if (ntp_time < session->base_time) {
+        return false;
+    }
+    if (gst_app_src_get_current_level_bytes(GST_APP_SRC(appsrc)) + len > sessions->queue_bytes) {
+        __atomic_fetch_add(&sessions->stats.dropped_frames, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    GstBuffer *buffer = gst_buffer_new_allocate(NULL, len, NULL);
+    g_assert(buffer);
+    gst_buffer_fill(buffer, 0, data, len);
+    GST_BUFFER_PTS(buffer) = (GstClockTime) (ntp_time - session->base_time);
+    GST_BUFFER_DTS(buffer) = GST_BUFFER_PTS(buffer);
+    if (delta) {
+        GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    }
+    gst_app_src_push_buffer(GST_APP_SRC(appsrc), buffer);
+    return true;
+}
+
+static bool audio_recent(appsrc_sessions_t *sessions) {
+    return sessions->audio_ct && (g_get_monotonic_time() - sessions->audio_seen < AUDIO_RECENT_USECS);
+}
+
+void appsrc_sessions_video_frame(appsrc_sessions_t *sessions, const unsigned char *data, int data_len,
+                                 bool keyframe, uint64_t ntp_time_remote) {
+    g_mutex_lock(&sessions->mutex);
+    session_check_failed(sessions);
+    appsrc_session_t *session = sessions->session;
+    if (session && keyframe &&
+        (!session->video_src || (audio_recent(sessions) && session->audio_ct != sessions->audio_ct))) {
+        /* video was added to audio, or audio (or a new audio format) to video: start a new session */
+        session_close(sessions);
+    }
+    if (!sessions->session && keyframe && !sessions->session_failed) {
+        session_open(sessions, true, audio_recent(sessions) ? sessions->audio_ct : 0, ntp_time_remote);
+    }
+    session = sessions->session;
+    if (session && session->video_src) {
+        if (session->need_keyframe && !keyframe) {
+            __atomic_fetch_add(&sessions->stats.dropped_frames, 1, __ATOMIC_RELAXED);
+        } else if (push(sessions, session->video_src, data, data_len, ntp_time_remote, !keyframe)) {
+            session->need_keyframe = false;
+            __atomic_fetch_add(&sessions->stats.video_frames, 1, __ATOMIC_RELAXED);
+        } else {
+            session->need_keyframe = true;
+        }
+    }
+    g_mutex_unlock(&sessions->mutex);
+}
+
+void appsrc_sessions_audio_frame(appsrc_sessions_t *sessions, const unsigned char *data, int data_len,
+                                 unsigned char ct, uint64_t ntp_time_remote) {
+    g_mutex_lock(&sessions->mutex);
+    sessions->audio_ct = ct;
+    sessions->audio_seen = g_get_monotonic_time();
+    session_check_failed(sessions);
+    if (sessions->session && !sessions->session->video_src && sessions->session->audio_ct != ct) {
+        session_close(sessions);
+    }
+    /* AAC-ELD audio accompanies mirrored video: the session starts with the first video keyframe */
+    if (!sessions->session && ct != APPSRC_SESSION_AAC_ELD && !sessions->session_failed) {
+        session_open(sessions, false, ct, ntp_time_remote);
+    }
+    appsrc_session_t *session = sessions->session;
+    if (session && session->audio_src && session->audio_ct == ct) {
+        if (push(sessions, session->audio_src, data, data_len, ntp_time_remote, false)) {
+            __atomic_fetch_add(&sessions->stats.audio_frames, 1, __ATOMIC_RELAXED);
+        }
+    }
+    g_mutex_unlock(&sessions->mutex);
+}
+
+void appsrc_sessions_stop(appsrc_sessions_t *sessions) {
+    g_mutex_lock(&sessions->mutex);
+    session_close(sessions);
+    sessions->session_failed = false;
+    sessions->audio_ct = 0;
+    g_mutex_unlock(&sessions->mutex);
+}
+
+void appsrc_sessions_get_stats(appsrc_sessions_t *sessions, appsrc_session_stats_t *copy) {
+    copy->video_frames = __atomic_load_n(&sessions->stats.video_frames, __ATOMIC_RELAXED);
+    copy->audio_frames = __atomic_load_n(&sessions->stats.audio_frames, __ATOMIC_RELAXED);
+    copy->dropped_frames = __atomic_load_n(&sessions->stats.dropped_frames, __ATOMIC_RELAXED);
+    copy->active = __atomic_load_n(&sessions->stats.active, __ATOMIC_RELAXED);
+}
+
+void appsrc_sessions_finish(appsrc_sessions_t *sessions) {
+    appsrc_sessions_stop(sessions);
+    gint64 end_time = g_get_monotonic_time() + (sessions->close_timeout_secs + 1) * G_TIME_SPAN_SECOND;
+    g_mutex_lock(&sessions->close_mutex);
+    while (sessions->closing && g_cond_wait_until(&sessions->close_cond, &sessions->close_mutex, end_time)) {
+    }
+    g_mutex_unlock(&sessions->close_mutex);
+}
@@ -0,0 +1,106 @@
+/**
+ * UxPlay - An open-source AirPlay mirroring server
+ * Copyright (C) 2026 UxPlay contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/*
+ * The audio_renderer_* functions: each renderer is created by the backend selected with
+ * audio_renderer_set_backend(), and is then driven through the functions of that backend.
+ */
+
+#include <string.h>
+#include "audio_renderer.h"
+
+static const audio_renderer_funcs_t *backends[] = { &audio_renderer_gstreamer_funcs, &audio_renderer_null_funcs };
+static const audio_renderer_funcs_t *backend = &audio_renderer_gstreamer_funcs;
+
+/* the struct audio_renderer_s of each backend starts with a pointer to its functions */
+#define FUNCS(renderer) (*(const audio_renderer_funcs_t **) (renderer))
+
+bool audio_renderer_set_backend(const char *name) {
+    for (int i = 0; i < (int) (sizeof(backends) / sizeof(backends[0])); i++) {
+        if (!strcmp(name, backends[i]->name)) {
+            backend = backends[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+audio_renderer_t *audio_renderer_init(logger_t *logger, const char* audiosink, const bool *audio_sync,
+                                      const bool *video_sync, const audio_renderer_extras_t *extras) {
+    return backend->init(logger, audiosink, audio_sync, video_sync, extras);
+}
+
+bool audio_renderer_add_sink(audio_renderer_extras_t *extras, const char *audiosink, int delay_ms) {
+    if (extras->n_sinks == AUDIO_RENDERER_MAX_SINKS - 1) {
+        return false;
+    }
+    extras->sinks[extras->n_sinks].audiosink = strdup(audiosink);
+    extras->sinks[extras->n_sinks].delay_ms = delay_ms;
+    extras->n_sinks++;
+    return true;
+}
+
+bool audio_renderer_get_sink_stats(audio_renderer_t *renderer, int index, const char **audiosink, int64_t *drift,
+                                   uint64_t *late, uint64_t *dropped) {
+    if (!renderer) {
+        return false;
+    }
+    return FUNCS(renderer)->get_sink_stats(renderer, index, audiosink, drift, late, dropped);
+}
+
+void audio_renderer_prewarm(audio_renderer_t *renderer, unsigned char compression_type, bool background) {
+    FUNCS(renderer)->prewarm(renderer, compression_type, background);
+}
+
+void audio_renderer_start(audio_renderer_t *renderer, unsigned char* compression_type) {
+    FUNCS(renderer)->start(renderer, compression_type);
+}
+
+void audio_renderer_stop(audio_renderer_t *renderer) {
+    if (renderer) {
+        FUNCS(renderer)->stop(renderer);
+    }
+}
+
+void audio_renderer_render_buffer(audio_renderer_t *renderer, unsigned char* data, int *data_len,
+                                  unsigned short *seqnum, uint64_t *ntp_time) {
+    FUNCS(renderer)->render_buffer(renderer, data, data_len, seqnum, ntp_time);
+}
+
+void audio_renderer_set_volume(audio_renderer_t *renderer, double volume) {
+    FUNCS(renderer)->set_volume(renderer, volume);
+}
+
+void audio_renderer_flush(audio_renderer_t *renderer) {
+    FUNCS(renderer)->flush(renderer);
+}
+
+bool audio_renderer_get_queue_level(audio_renderer_t *renderer, unsigned int *buffers, unsigned int *bytes,
+                                    uint64_t *time) {
+    if (!renderer) {
+        return false;
+    }
+    return FUNCS(renderer)->get_queue_level(renderer, buffers, bytes, time);
+}
+
+void audio_renderer_destroy(audio_renderer_t *renderer) {
+    if (renderer) {
+        FUNCS(renderer)->destroy(renderer);
+    }
+}
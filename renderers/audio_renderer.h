@@ -31,15 +31,78 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 #include "../lib/logger.h"
+#include "../lib/latency_trace.h"
+
+/* a renderer instance: each receiver hosted by the process has its own (with a pipeline for each   *
+ * compression type); the latency trace and extra audiosinks belong to the primary one.            */
+typedef struct audio_renderer_s audio_renderer_t;
+
+/* render to more audiosinks (up to AUDIO_RENDERER_MAX_SINKS, including the main one): audio is decoded *
+ * once, then sent by a tee through a leaky queue to each sink; all sinks use the pipeline clock, and   *
+ * delay_ms (which can be negative) is the sink's ts-offset relative to the main sink, to compensate   *
+ * for differences in device latency.                                                                 */
+#define AUDIO_RENDERER_MAX_SINKS 4
+typedef struct audio_renderer_sink_s {
+    char *audiosink;
+    int delay_ms;
+} audio_renderer_sink_t;
+
+/* what the primary renderer has besides its pipelines; it is copied by audio_renderer_init */
+typedef struct audio_renderer_extras_s {
+    latency_trace_t *trace;
+    int n_sinks;                                            /* the extra audiosinks */
+    audio_renderer_sink_t sinks[AUDIO_RENDERER_MAX_SINKS - 1];
+} audio_renderer_extras_t;
+
+/* a renderer backend (see audio_renderer.c): the struct audio_renderer_s of each backend starts with *
+ * a pointer to its functions, which the audio_renderer_* functions below call                       */
+typedef struct audio_renderer_funcs_s {
+    const char *name;
+    audio_renderer_t *(*init)(logger_t *logger, const char* audiosink, const bool *audio_sync,
+                              const bool *video_sync, const audio_renderer_extras_t *extras);
+    void (*prewarm)(audio_renderer_t *renderer, unsigned char compression_type, bool background);
+    void (*start)(audio_renderer_t *renderer, unsigned char *compression_type);
+    void (*stop)(audio_renderer_t *renderer);
+    void (*render_buffer)(audio_renderer_t *renderer, unsigned char *data, int *data_len, unsigned short *seqnum,
+                          uint64_t *ntp_time);
+    void (*set_volume)(audio_renderer_t *renderer, double volume);
+    void (*flush)(audio_renderer_t *renderer);
+    bool (*get_queue_level)(audio_renderer_t *renderer, unsigned int *buffers, unsigned int *bytes, uint64_t *time);
+    bool (*get_sink_stats)(audio_renderer_t *renderer, int index, const char **audiosink, int64_t *drift,
+                           uint64_t *late, uint64_t *dropped);
+    void (*destroy)(audio_renderer_t *renderer);
+} audio_renderer_funcs_t;
+
+extern const audio_renderer_funcs_t audio_renderer_gstreamer_funcs;
+/* uses no GStreamer and no audio device: checks the framing of each packet, records its timing, *
+ * and drops it, so the receiver itself (lib/) can be benchmarked and load-tested               */
+extern const audio_renderer_funcs_t audio_renderer_null_funcs;
+
+/* "gstreamer" (the default) or "null"; call before audio_renderer_init; false if unknown */
+bool audio_renderer_set_backend(const char *name);
 
 bool gstreamer_init();
-void audio_renderer_init(logger_t *logger, const char* audiosink, const bool *audio_sync, const bool *video_sync);
-void audio_renderer_start(unsigned char* compression_type);
-void audio_renderer_stop();
-void audio_renderer_render_buffer(unsigned char* data, int *data_len, unsigned short *seqnum, uint64_t *ntp_time);
-void audio_renderer_set_volume(double volume);
-void audio_renderer_flush();
-void audio_renderer_destroy();
+
+/* false if there are too many sinks */
+bool audio_renderer_add_sink(audio_renderer_extras_t *extras, const char *audiosink, int delay_ms);
+/* index 0 is the main sink.  drift: position of the sink minus that of the main sink (0 if unknown); *
+ * late: buffers that reached the sink after they were due to be played (so the device underran);    *
+ * dropped: buffers dropped because the sink could not keep up                                       */
+bool audio_renderer_get_sink_stats(audio_renderer_t *renderer, int index, const char **audiosink, int64_t *drift,
+                                   uint64_t *late, uint64_t *dropped);
+/* extras: NULL for all but the renderer of the main receiver (at most one at a time) */
+audio_renderer_t *audio_renderer_init(logger_t *logger, const char* audiosink, const bool *audio_sync,
+                                      const bool *video_sync, const audio_renderer_extras_t *extras);
+void audio_renderer_prewarm(audio_renderer_t *renderer, unsigned char compression_type, bool background);
+void audio_renderer_start(audio_renderer_t *renderer, unsigned char* compression_type);
+void audio_renderer_stop(audio_renderer_t *renderer);
+void audio_renderer_render_buffer(audio_renderer_t *renderer, unsigned char* data, int *data_len,
+                                  unsigned short *seqnum, uint64_t *ntp_time);
+void audio_renderer_set_volume(audio_renderer_t *renderer, double volume);
+void audio_renderer_flush(audio_renderer_t *renderer);
+bool audio_renderer_get_queue_level(audio_renderer_t *renderer, unsigned int *buffers, unsigned int *bytes,
+                                    uint64_t *time);
+void audio_renderer_destroy(audio_renderer_t *renderer);
 
 #ifdef __cplusplus
 }
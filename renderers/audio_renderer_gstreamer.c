@@ -24,31 +24,56 @@
 #include <gst/gst.h>
 #include <gst/app/gstappsrc.h>
 #include "audio_renderer.h"
+#include "../lib/thread_policy.h"
 #define SECOND_IN_NSECS 1000000000UL
 
 #define NFORMATS 2     /* set to 4 to enable AAC_LD and PCM:  allowed, but  never seen in real-world use */
 
-static GstClockTime gst_audio_pipeline_base_time = GST_CLOCK_TIME_NONE;
 static logger_t *logger = NULL;
 const char * format[NFORMATS];
 
 static const gchar *avdec_aac = "avdec_aac";
 static const gchar *avdec_alac = "avdec_alac";
+static gboolean features_checked = FALSE;
 static gboolean aac = FALSE;
 static gboolean alac = FALSE;
-static gboolean render_audio = FALSE;
-static gboolean async = FALSE;
-static gboolean vsync = FALSE;
-static gboolean sync = FALSE;
 
-typedef struct audio_renderer_s {
+/* the pipeline for one compression type */
+typedef struct audio_pipeline_s {
     GstElement *appsrc; 
     GstElement *pipeline;
     GstElement *volume;
+    GstElement *queue;
+    GstElement *sinks[AUDIO_RENDERER_MAX_SINKS];    /* only with more than one audiosink */
     unsigned char ct;
-} audio_renderer_t ;
-static audio_renderer_t *renderer_type[NFORMATS];
-static audio_renderer_t *renderer = NULL;
+} audio_pipeline_t ;
+
+typedef struct audio_output_s {
+    audio_renderer_t *renderer;
+    char *audiosink;
+    int delay_ms;
+    GstClockTime latency;                      /* of the pipeline, as seen by this sink */
+    uint64_t late;                             /* updated atomically */
+    uint64_t dropped;
+} audio_output_t;
+
+struct audio_renderer_s {
+    const audio_renderer_funcs_t *funcs;            /* must be first (see audio_renderer.c) */
+    audio_pipeline_t *pipelines[NFORMATS];          /* built when first needed */
+    audio_pipeline_t *current;                      /* the active pipeline, or NULL */
+    GstClockTime base_time;
+    gboolean render_audio;
+    gboolean async;
+    gboolean vsync;
+    gboolean sync;
+    bool primary;
+    latency_trace_t *trace;                         /* primary renderer only, as are extra outputs */
+    /* outputs[0] is the main audiosink; there is a tee if n_outputs > 1 */
+    audio_output_t outputs[AUDIO_RENDERER_MAX_SINKS];
+    int n_outputs;
+    GThread *prewarm_thread;
+    unsigned char prewarm_ct;                       /* the types built by prewarm_thread (0: all) */
+};
 
 /* GStreamer Caps strings for Airplay-defined audio compression types (ct) */
 
@@ -120,192 +145,428 @@ static gboolean check_plugin_feature (const gchar *needed_feature)
     return ret;
 }
 
+/* see the video renderer: with sync, the render time is when the buffer is due at the sink */
+static void trace_buffer(audio_renderer_t *renderer, GstBuffer *buffer, latency_trace_stage_t stage) {
+    uint64_t id = LATENCY_TRACE_NEXT;
+    uint64_t now = latency_trace_now();
+    if (renderer->sync && GST_BUFFER_PTS_IS_VALID(buffer)) {
+        id = (uint64_t) GST_BUFFER_PTS(buffer) + renderer->base_time;
+        if (stage == LATENCY_TRACE_RENDER && id > now) {
+            now = id;
+        }
+    }
+    latency_trace_stage(renderer->trace, LATENCY_TRACE_AUDIO, id, stage, now);
+}
+
+static GstPadProbeReturn trace_decode_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    trace_buffer((audio_renderer_t *) user_data, GST_PAD_PROBE_INFO_BUFFER(info), LATENCY_TRACE_DECODE);
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn trace_render_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    trace_buffer((audio_renderer_t *) user_data, GST_PAD_PROBE_INFO_BUFFER(info), LATENCY_TRACE_RENDER);
+    return GST_PAD_PROBE_OK;
+}
+
+static void add_trace_probe(audio_renderer_t *renderer, GstElement *pipeline, const char *name,
+                            GstPadProbeCallback probe) {
+    GstElement *element = gst_bin_get_by_name (GST_BIN (pipeline), name);
+    g_assert(element);
+    GstPad *pad = gst_element_get_static_pad(element, "sink");
+    g_assert(pad);
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, probe, renderer, NULL);
+    gst_object_unref(pad);
+    gst_object_unref(element);
+}
+
+/* a streaming thread posts STREAM_STATUS "enter" (synchronously, from that thread) when it starts */
+static GstBusSyncReply thread_policy_sync_handler(GstBus *bus, GstMessage *message, gpointer user_data) {
+    if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_STREAM_STATUS) {
+        GstStreamStatusType type;
+        gst_message_parse_stream_status(message, &type, NULL);
+        if (type == GST_STREAM_STATUS_TYPE_ENTER) {
+            thread_policy_apply((thread_role_t) GPOINTER_TO_INT(user_data), logger);
+        }
+    }
+    return GST_BUS_PASS;
+}
+
+static void output_overrun(GstElement *queue, gpointer user_data) {
+    audio_output_t *output = (audio_output_t *) user_data;
+    __atomic_fetch_add(&output->dropped, 1, __ATOMIC_RELAXED);
+}
+
+/* a buffer that reaches its sink after base time + pts + latency + ts-offset is late: the sink drops *
+ * (part of) it, and the device plays silence (an underrun)                                          */
+static GstPadProbeReturn output_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    audio_output_t *output = (audio_output_t *) user_data;
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    audio_renderer_t *renderer = output->renderer;
+    audio_pipeline_t *current = renderer->current;
+    if (!current || !renderer->sync || !GST_BUFFER_PTS_IS_VALID(buffer)) {
+        return GST_PAD_PROBE_OK;
+    }
+    if (!GST_CLOCK_TIME_IS_VALID(output->latency)) {
+        /* once per session: the latency is only known when the pipeline is playing */
+        GstQuery *query = gst_query_new_latency();
+        GstClockTime min_latency = GST_CLOCK_TIME_NONE;
+        if (gst_element_query(current->pipeline, query)) {
+            gst_query_parse_latency(query, NULL, &min_latency, NULL);
+        }
+        gst_query_unref(query);
+        output->latency = min_latency;
+        if (!GST_CLOCK_TIME_IS_VALID(min_latency)) {
+            return GST_PAD_PROBE_OK;
+        }
+    }
+    gint64 due = (gint64) (renderer->base_time + GST_BUFFER_PTS(buffer) + output->latency) +
+        (gint64) output->delay_ms * GST_MSECOND;
+    if ((gint64) latency_trace_now() > due) {
+        __atomic_fetch_add(&output->late, 1, __ATOMIC_RELAXED);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+static bool audio_renderer_gstreamer_get_sink_stats(audio_renderer_t *renderer, int index, const char **audiosink,
+                                                    int64_t *drift, uint64_t *late, uint64_t *dropped) {
+    audio_pipeline_t *current = renderer->current;
+    gint64 position = 0, main_position = 0;
+    if (index < 0 || index >= renderer->n_outputs) {
+        return false;
+    }
+    *audiosink = renderer->outputs[index].audiosink;
+    *late = __atomic_load_n(&renderer->outputs[index].late, __ATOMIC_RELAXED);
+    *dropped = __atomic_load_n(&renderer->outputs[index].dropped, __ATOMIC_RELAXED);
+    *drift = 0;
+    if (current && current->sinks[index] &&
+        gst_element_query_position(current->sinks[index], GST_FORMAT_TIME, &position) &&
+        gst_element_query_position(current->sinks[0], GST_FORMAT_TIME, &main_position)) {
+        *drift = position - main_position;
+    }
+    return true;
+}
+
 bool gstreamer_init(){
     gst_init(NULL,NULL);    
     return (bool) check_plugins ();
 }
 
-void audio_renderer_init(logger_t *render_logger, const char* audiosink, const bool* audio_sync, const bool* video_sync) {
+static GMutex build_mutex;
+
+/* build the GStreamer pipeline for renderer->pipelines[i], if this has not yet been done */
+static void build_pipeline(audio_renderer_t *renderer, int i) {
     GError *error = NULL;
     GstCaps *caps = NULL;
+    gint64 start_time;
+    audio_pipeline_t *pipeline = renderer->pipelines[i];
+    bool use_trace = (renderer->trace != NULL);
+    int use_outputs = renderer->n_outputs;
+    audio_output_t *outputs = renderer->outputs;
+
+    g_mutex_lock(&build_mutex);
+    if (pipeline->pipeline) {
+        g_mutex_unlock(&build_mutex);
+        return;
+    }
+    start_time = g_get_monotonic_time();
     GstClock *clock = gst_system_clock_obtain();
     g_object_set(clock, "clock-type", GST_CLOCK_TYPE_REALTIME, NULL);
 
-    logger = render_logger;
-    
-    aac = check_plugin_feature (avdec_aac);
-    alac = check_plugin_feature (avdec_alac);
-
-    for (int i = 0; i < NFORMATS ; i++) {
-        renderer_type[i] = (audio_renderer_t *)  calloc(1,sizeof(audio_renderer_t));
-        g_assert(renderer_type[i]);
-        GString *launch = g_string_new("appsrc name=audio_source ! ");
-        g_string_append(launch, "queue ! ");
-        switch (i) {
-        case 0:    /* AAC-ELD */
-        case 2:    /* AAC-LC */
-            if (aac) g_string_append(launch, "avdec_aac ! ");
-            break;
-        case 1:    /* ALAC */
-            if (alac) g_string_append(launch, "avdec_alac ! ");
-            break;
-        case 3:   /*PCM*/
-            break;
-        default:
-            break;
+    GString *launch = g_string_new("appsrc name=audio_source ! ");
+    g_string_append(launch, "queue name=audio_queue ! ");
+    switch (i) {
+    case 0:    /* AAC-ELD */
+    case 2:    /* AAC-LC */
+        if (aac) g_string_append(launch, "avdec_aac ! ");
+        break;
+    case 1:    /* ALAC */
+        if (alac) g_string_append(launch, "avdec_alac ! ");
+        break;
+    case 3:   /*PCM*/
+        break;
+    default:
+        break;
+    }
+    if (use_trace) {
+        g_string_append (launch, "identity name=audio_decoded silent=true ! ");
+    }
+    g_string_append (launch, "audioconvert ! ");
+    g_string_append (launch, "audioresample ! ");    /* wasapisink must resample from 44.1 kHz to 48 kHz */
+    g_string_append (launch, "volume name=volume ! level ! ");
+    const char *sink_sync = ((i == 1) ? renderer->async : renderer->vsync) ? " sync=true" : " sync=false";   /* i = 1: ALAC */
+    if (use_outputs == 1) {
+        g_string_append (launch, outputs[0].audiosink);
+        if (use_trace) {
+            g_string_append (launch, " name=audio_sink");
         }
-        g_string_append (launch, "audioconvert ! ");
-        g_string_append (launch, "audioresample ! ");    /* wasapisink must resample from 44.1 kHz to 48 kHz */
-        g_string_append (launch, "volume name=volume ! level ! ");
-        g_string_append (launch, audiosink);
-        switch(i) {
-        case 1:  /*ALAC*/
-            if (*audio_sync) {
-                g_string_append (launch, " sync=true");
-                async = TRUE;
-            } else {
-                g_string_append (launch, " sync=false");
-                async = FALSE;
-            }
-            break;
-        default:
-	    if (*video_sync) {
-                g_string_append (launch, " sync=true");
-                vsync = TRUE;
-            } else {
-                g_string_append (launch, " sync=false");
-                vsync = FALSE;
+        g_string_append (launch, sink_sync);
+    } else {
+        /* decoded once; each sink has its own queue (and thread), so a stalled sink only loses its own audio */
+        g_string_append (launch, "tee name=audio_tee allow-not-linked=true");
+        for (int k = 0; k < use_outputs; k++) {
+            /* the main sink keeps the name "audio_sink" used by the latency trace */
+            gchar *name = k ? g_strdup_printf("audio_sink_%d", k) : g_strdup("audio_sink");
+            guint64 max_time = (guint64) (1000 + ABS(outputs[k].delay_ms)) * GST_MSECOND;
+            g_string_append_printf (launch, " audio_tee. ! queue name=audio_output_%d leaky=downstream max-size-buffers=0"
+                                    " max-size-bytes=0 max-size-time=%" G_GUINT64_FORMAT " ! audioconvert ! audioresample ! "
+                                    "%s name=%s%s", k, max_time, outputs[k].audiosink, name, sink_sync);
+            g_free(name);
+            if (outputs[k].delay_ms) {
+                g_string_append_printf (launch, " ts-offset=%" G_GINT64_FORMAT,
+                                        (gint64) outputs[k].delay_ms * GST_MSECOND);
             }
-            break;
-        }
-        renderer_type[i]->pipeline  = gst_parse_launch(launch->str, &error);
-	if (error) {
-          g_error ("gst_parse_launch error (audio %d):\n %s\n", i+1, error->message);
-          g_clear_error (&error);
         }
+    }
+    pipeline->pipeline  = gst_parse_launch(launch->str, &error);
+    if (error) {
+        g_error ("gst_parse_launch error (audio %d):\n %s\n", i+1, error->message);
+        g_clear_error (&error);
+    }
+
+    g_assert (pipeline->pipeline);
+    gst_pipeline_use_clock(GST_PIPELINE_CAST(pipeline->pipeline), clock);
+    if (thread_policy_is_set(THREAD_ROLE_GST_AUDIO)) {
+        GstBus *bus = gst_element_get_bus(pipeline->pipeline);
+        gst_bus_set_sync_handler(bus, thread_policy_sync_handler, GINT_TO_POINTER(THREAD_ROLE_GST_AUDIO), NULL);
+        gst_object_unref(bus);
+    }
+
+    pipeline->appsrc = gst_bin_get_by_name (GST_BIN (pipeline->pipeline), "audio_source");
+    pipeline->volume = gst_bin_get_by_name (GST_BIN (pipeline->pipeline), "volume");
+    pipeline->queue = gst_bin_get_by_name (GST_BIN (pipeline->pipeline), "audio_queue");
+    if (use_trace) {
+        add_trace_probe(renderer, pipeline->pipeline, "audio_decoded", trace_decode_probe);
+        add_trace_probe(renderer, pipeline->pipeline, "audio_sink", trace_render_probe);
+    }
+    for (int k = 0; k < use_outputs && use_outputs > 1; k++) {
+        gchar *name = g_strdup_printf("audio_output_%d", k);
+        GstElement *queue = gst_bin_get_by_name (GST_BIN (pipeline->pipeline), name);
+        g_assert(queue);
+        g_signal_connect(queue, "overrun", G_CALLBACK(output_overrun), &outputs[k]);
+        gst_object_unref(queue);
+        g_free(name);
+        name = k ? g_strdup_printf("audio_sink_%d", k) : g_strdup("audio_sink");
+        pipeline->sinks[k] = gst_bin_get_by_name (GST_BIN (pipeline->pipeline), name);
+        g_assert(pipeline->sinks[k]);
+        GstPad *pad = gst_element_get_static_pad(pipeline->sinks[k], "sink");
+        g_assert(pad);
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, output_probe, &outputs[k], NULL);
+        gst_object_unref(pad);
+        g_free(name);
+    }
+    switch (i) {
+    case 0:
+        caps =  gst_caps_from_string(aac_eld_caps);
+        break;
+    case 1:
+        caps =  gst_caps_from_string(alac_caps);
+        break;
+    case 2:
+        caps =  gst_caps_from_string(aac_lc_caps);
+        break;
+    case 3:
+        caps =  gst_caps_from_string(lpcm_caps);
+        break;
+    default:
+        break;
+    }
+    logger_log(logger, LOGGER_DEBUG, "GStreamer audio pipeline %d: \"%s\"", i+1, launch->str);
+    g_string_free(launch, TRUE);
+    g_object_set(pipeline->appsrc, "caps", caps, "stream-type", 0, "is-live", TRUE, "format", GST_FORMAT_TIME, NULL);
+    gst_caps_unref(caps);
+    gst_object_unref(clock);
+    logger_log(logger, LOGGER_INFO, "built GStreamer audio pipeline for %s in %.1f ms", format[i],
+               (double) (g_get_monotonic_time() - start_time) / 1000.0);
+    g_mutex_unlock(&build_mutex);
+}
+
+/* pipelines are built when first needed (by audio_renderer_start), or in advance by audio_renderer_prewarm */
+static audio_renderer_t *audio_renderer_gstreamer_init(logger_t *render_logger, const char* audiosink,
+                                                       const bool* audio_sync, const bool* video_sync,
+                                                       const audio_renderer_extras_t *extras) {
+    audio_renderer_t *renderer;
+    logger = render_logger;
 
-        g_assert (renderer_type[i]->pipeline);
-        gst_pipeline_use_clock(GST_PIPELINE_CAST(renderer_type[i]->pipeline), clock);
+    if (!features_checked) {
+        aac = check_plugin_feature (avdec_aac);
+        alac = check_plugin_feature (avdec_alac);
+        features_checked = TRUE;
+    }
+    renderer = (audio_renderer_t *) calloc(1, sizeof(audio_renderer_t));
+    g_assert(renderer);
+    renderer->funcs = &audio_renderer_gstreamer_funcs;
+    renderer->primary = (extras != NULL);
+    renderer->base_time = GST_CLOCK_TIME_NONE;
+    renderer->async = (*audio_sync ? TRUE : FALSE);
+    renderer->vsync = (*video_sync ? TRUE : FALSE);
+    renderer->outputs[0].audiosink = g_strdup(audiosink);
+    renderer->n_outputs = 1;
+    if (extras) {
+        renderer->trace = extras->trace;
+        for (int k = 0; k < extras->n_sinks; k++) {
+            audio_output_t *output = &renderer->outputs[renderer->n_outputs++];
+            output->audiosink = g_strdup(extras->sinks[k].audiosink);
+            output->delay_ms = extras->sinks[k].delay_ms;
+            logger_log(logger, LOGGER_INFO, "audio is also rendered to \"%s\" (delay %d ms)", output->audiosink,
+                       output->delay_ms);
+        }
+    }
+    for (int k = 0; k < renderer->n_outputs; k++) {
+        renderer->outputs[k].renderer = renderer;
+    }
 
-        renderer_type[i]->appsrc = gst_bin_get_by_name (GST_BIN (renderer_type[i]->pipeline), "audio_source");
-        renderer_type[i]->volume = gst_bin_get_by_name (GST_BIN (renderer_type[i]->pipeline), "volume");
+    for (int i = 0; i < NFORMATS ; i++) {
+        audio_pipeline_t *pipeline = (audio_pipeline_t *)  calloc(1,sizeof(audio_pipeline_t));
+        g_assert(pipeline);
+        renderer->pipelines[i] = pipeline;
         switch (i) {
         case 0:
-            caps =  gst_caps_from_string(aac_eld_caps);
-            renderer_type[i]->ct = 8;
+            pipeline->ct = 8;
             format[i] = "AAC-ELD 44100/2";
             break;
         case 1:
-            caps =  gst_caps_from_string(alac_caps);
-            renderer_type[i]->ct = 2;
+            pipeline->ct = 2;
             format[i] = "ALAC 44100/16/2";
             break;
         case 2:
-            caps =  gst_caps_from_string(aac_lc_caps);
-            renderer_type[i]->ct = 4;
+            pipeline->ct = 4;
             format[i] = "AAC-LC 44100/2";
             break;
         case 3:
-            caps =  gst_caps_from_string(lpcm_caps);
-            renderer_type[i]->ct = 1;
+            pipeline->ct = 1;
             format[i] = "PCM 44100/16/2 S16LE";
             break;
         default:
             break;
         }
         logger_log(logger, LOGGER_DEBUG, "Audio format %d: %s",i+1,format[i]);
-        logger_log(logger, LOGGER_DEBUG, "GStreamer audio pipeline %d: \"%s\"", i+1, launch->str);
-        g_string_free(launch, TRUE);
-        g_object_set(renderer_type[i]->appsrc, "caps", caps, "stream-type", 0, "is-live", TRUE, "format", GST_FORMAT_TIME, NULL);
-        gst_caps_unref(caps);
-        g_object_unref(clock);
+    }
+    return renderer;
+}
+
+/* build the pipelines for compression type ct (ct = 0: all types) */
+static void prewarm_pipelines(audio_renderer_t *renderer, unsigned char ct) {
+    for (int i = 0; i < NFORMATS; i++) {
+        if (!ct || renderer->pipelines[i]->ct == ct) {
+            build_pipeline(renderer, i);
+        }
+    }
+}
+
+static gpointer prewarm(gpointer data) {
+    audio_renderer_t *renderer = (audio_renderer_t *) data;
+    prewarm_pipelines(renderer, renderer->prewarm_ct);
+    return NULL;
+}
+
+/* build the pipelines for compression type ct now (ct = 0: all types), in a background thread if     *
+ * requested; there is only one such thread, so if it was already started, they are built right away */
+static void audio_renderer_gstreamer_prewarm(audio_renderer_t *renderer, unsigned char ct, bool background) {
+    if (background && !renderer->prewarm_thread) {
+        renderer->prewarm_ct = ct;
+        renderer->prewarm_thread = g_thread_new("audio-prewarm", prewarm, renderer);
+    } else {
+        prewarm_pipelines(renderer, ct);
     }
 }
 
-void audio_renderer_stop() {
-    if (renderer) {
-        gst_app_src_end_of_stream(GST_APP_SRC(renderer->appsrc));
-        gst_element_set_state (renderer->pipeline, GST_STATE_NULL);
-        renderer = NULL;
+static void audio_renderer_gstreamer_stop(audio_renderer_t *renderer) {
+    if (renderer->current) {
+        gst_app_src_end_of_stream(GST_APP_SRC(renderer->current->appsrc));
+        gst_element_set_state (renderer->current->pipeline, GST_STATE_NULL);
+        renderer->current = NULL;
     }
 }
 
-static void get_renderer_type(unsigned char *ct, int *id) {
-    render_audio = FALSE;
+static void get_renderer_type(audio_renderer_t *renderer, unsigned char *ct, int *id) {
+    renderer->render_audio = FALSE;
     *id = -1;
     for (int i = 0; i < NFORMATS; i++) {
-        if (renderer_type[i]->ct == *ct) {
+        if (renderer->pipelines[i]->ct == *ct) {
 	    *id = i;
             break;
         }
     }
+    if (*id >= 0) {
+        build_pipeline(renderer, *id);
+    }
     switch (*id) {
     case 2:
     case 0:
         if (aac) {
-            render_audio = TRUE;
+            renderer->render_audio = TRUE;
         } else {
             logger_log(logger, LOGGER_INFO, "*** GStreamer libav plugin feature avdec_aac is missing, cannot decode AAC audio");
         }
-        sync = vsync;
+        renderer->sync = renderer->vsync;
         break;
     case 1:
         if (alac) {
-            render_audio = TRUE;
+            renderer->render_audio = TRUE;
         } else {
             logger_log(logger, LOGGER_INFO, "*** GStreamer libav plugin feature avdec_alac is missing, cannot decode ALAC audio");
         }
-        sync = async;
+        renderer->sync = renderer->async;
         break;
     case 3:
-        render_audio = TRUE;
-	sync = FALSE;
+        renderer->render_audio = TRUE;
+	renderer->sync = FALSE;
         break;
     default:
         break;
     }
 }
 
-void  audio_renderer_start(unsigned char *ct) {
+static void reset_output_latency(audio_renderer_t *renderer) {
+    for (int k = 0; k < renderer->n_outputs; k++) {
+        renderer->outputs[k].latency = GST_CLOCK_TIME_NONE;
+    }
+}
+
+static void audio_renderer_gstreamer_start(audio_renderer_t *renderer, unsigned char *ct) {
     int id = -1;
-    get_renderer_type(ct, &id);
-    if (id >= 0 && renderer) {
-        if(*ct != renderer->ct) {
-            gst_app_src_end_of_stream(GST_APP_SRC(renderer->appsrc));
-            gst_element_set_state (renderer->pipeline, GST_STATE_NULL);
+    get_renderer_type(renderer, ct, &id);
+    if (id >= 0 && renderer->current) {
+        if(*ct != renderer->current->ct) {
+            gst_app_src_end_of_stream(GST_APP_SRC(renderer->current->appsrc));
+            gst_element_set_state (renderer->current->pipeline, GST_STATE_NULL);
             logger_log(logger, LOGGER_INFO, "changed audio connection, format %s", format[id]);
-            renderer = renderer_type[id];
-            gst_element_set_state (renderer->pipeline, GST_STATE_PLAYING);
-            gst_audio_pipeline_base_time = gst_element_get_base_time(renderer->appsrc);
+            reset_output_latency(renderer);
+            renderer->current = renderer->pipelines[id];
+            gst_element_set_state (renderer->current->pipeline, GST_STATE_PLAYING);
+            renderer->base_time = gst_element_get_base_time(renderer->current->appsrc);
         }
     } else if (id >= 0) {
         logger_log(logger, LOGGER_INFO, "start audio connection, format %s", format[id]);
-        renderer = renderer_type[id];
-        gst_element_set_state (renderer->pipeline, GST_STATE_PLAYING);
-        gst_audio_pipeline_base_time = gst_element_get_base_time(renderer->appsrc);
+        reset_output_latency(renderer);
+        renderer->current = renderer->pipelines[id];
+        gst_element_set_state (renderer->current->pipeline, GST_STATE_PLAYING);
+        renderer->base_time = gst_element_get_base_time(renderer->current->appsrc);
     } else {
         logger_log(logger, LOGGER_ERR, "unknown audio compression type ct = %d", *ct);
     }
 }
 
-void audio_renderer_render_buffer(unsigned char* data, int *data_len, unsigned short *seqnum, uint64_t *ntp_time) {
+static void audio_renderer_gstreamer_render_buffer(audio_renderer_t *renderer, unsigned char* data, int *data_len,
+                                                   unsigned short *seqnum, uint64_t *ntp_time) {
     GstBuffer *buffer;
     bool valid;
+    audio_pipeline_t *current = renderer->current;
 
-    if (!render_audio) return;    /* do nothing unless render_audio == TRUE */
+    if (!renderer->render_audio) return;    /* do nothing unless render_audio == TRUE */
 
     GstClockTime pts = (GstClockTime) *ntp_time ;    /* now in nsecs */
-    //GstClockTimeDiff latency = GST_CLOCK_DIFF(gst_element_get_current_clock_time (renderer->appsrc), pts);
-    if (sync) {
-        if (pts >= gst_audio_pipeline_base_time) {
-            pts -= gst_audio_pipeline_base_time;
+    //GstClockTimeDiff latency = GST_CLOCK_DIFF(gst_element_get_current_clock_time (current->appsrc), pts);
+    if (renderer->sync) {
+        if (pts >= renderer->base_time) {
+            pts -= renderer->base_time;
         } else {
             logger_log(logger, LOGGER_ERR, "*** invalid ntp_time < gst_audio_pipeline_base_time\n%8.6f ntp_time\n%8.6f base_time",
-                       ((double) *ntp_time) / SECOND_IN_NSECS, ((double) gst_audio_pipeline_base_time) / SECOND_IN_NSECS);
+                       ((double) *ntp_time) / SECOND_IN_NSECS, ((double) renderer->base_time) / SECOND_IN_NSECS);
             return;
         }
     }
-    if (data_len == 0 || renderer == NULL) return;
+    if (data_len == 0 || current == NULL) return;
 
     /* all audio received seems to be either ct = 8 (AAC_ELD 44100/2 spf 460 ) AirPlay Mirror protocol *
      * or ct = 2 (ALAC 44100/16/2 spf 352) AirPlay protocol.                                           *
@@ -317,11 +578,11 @@ void audio_renderer_render_buffer(unsigned char* data, int *data_len, unsigned s
     buffer = gst_buffer_new_allocate(NULL, *data_len, NULL);
     g_assert(buffer != NULL);
     //g_print("audio latency %8.6f\n", (double) latency / SECOND_IN_NSECS);
-    if (sync) {
+    if (renderer->sync) {
         GST_BUFFER_PTS(buffer) = pts;
     }
     gst_buffer_fill(buffer, 0, data, *data_len);
-    switch (renderer->ct){
+    switch (current->ct){
     case 8: /*AAC-ELD*/
         switch (data[0]){
         case 0x8c:
@@ -348,31 +609,81 @@ void audio_renderer_render_buffer(unsigned char* data, int *data_len, unsigned s
         break;
     }
     if (valid) {
-        gst_app_src_push_buffer(GST_APP_SRC(renderer->appsrc), buffer);
+        if (renderer->trace) {
+            latency_trace_stage(renderer->trace, LATENCY_TRACE_AUDIO, *ntp_time, LATENCY_TRACE_PUSH, latency_trace_now());
+        }
+        gst_app_src_push_buffer(GST_APP_SRC(current->appsrc), buffer);
     } else {
-        logger_log(logger, LOGGER_ERR, "*** ERROR invalid  audio frame (compression_type %d) skipped ", renderer->ct);
+        logger_log(logger, LOGGER_ERR, "*** ERROR invalid  audio frame (compression_type %d) skipped ", current->ct);
         logger_log(logger, LOGGER_ERR, "***       first byte of invalid frame was  0x%2.2x ", (unsigned int) data[0]);
     }
 }
 
-void audio_renderer_set_volume(double volume) {
+static void audio_renderer_gstreamer_set_volume(audio_renderer_t *renderer, double volume) {
     volume = (volume > 10.0) ? 10.0 : volume;
     volume = (volume < 0.0) ? 0.0 : volume;
-    g_object_set(renderer->volume, "volume", volume, NULL);
+    g_object_set(renderer->current->volume, "volume", volume, NULL);
 }
 
-void audio_renderer_flush() {
+static void audio_renderer_gstreamer_flush(audio_renderer_t *renderer) {
 }
 
-void audio_renderer_destroy() {
-    audio_renderer_stop();
+/* current fill level of the queue after appsrc in the active pipeline (time in nsecs) */
+static bool audio_renderer_gstreamer_get_queue_level(audio_renderer_t *renderer, unsigned int *buffers,
+                                                     unsigned int *bytes, uint64_t *time) {
+    guint64 level_time = 0;
+    audio_pipeline_t *current = renderer ? renderer->current : NULL;
+    if (!current) {
+        return false;
+    }
+    g_object_get(current->queue, "current-level-buffers", buffers, "current-level-bytes", bytes,
+                 "current-level-time", &level_time, NULL);
+    *time = (uint64_t) level_time;
+    return true;
+}
+
+static void audio_renderer_gstreamer_destroy(audio_renderer_t *renderer) {
+    audio_renderer_gstreamer_stop(renderer);
+    if (renderer->prewarm_thread) {
+        g_thread_join(renderer->prewarm_thread);
+        renderer->prewarm_thread = NULL;
+    }
     for (int i = 0; i < NFORMATS ; i++ ) {
-        gst_object_unref (renderer_type[i]->volume);
-	renderer_type[i]->volume = NULL;
-        gst_object_unref (renderer_type[i]->appsrc);
-        renderer_type[i]->appsrc = NULL;
-	gst_object_unref (renderer_type[i]->pipeline);
-        renderer_type[i]->pipeline = NULL;
-        free(renderer_type[i]);
+        audio_pipeline_t *pipeline = renderer->pipelines[i];
+        if (pipeline->pipeline) {
+            gst_object_unref (pipeline->volume);
+            pipeline->volume = NULL;
+            gst_object_unref (pipeline->queue);
+            pipeline->queue = NULL;
+            gst_object_unref (pipeline->appsrc);
+            pipeline->appsrc = NULL;
+            for (int k = 0; k < AUDIO_RENDERER_MAX_SINKS; k++) {
+                if (pipeline->sinks[k]) {
+                    gst_object_unref (pipeline->sinks[k]);
+                    pipeline->sinks[k] = NULL;
+                }
+            }
+            gst_object_unref (pipeline->pipeline);
+            pipeline->pipeline = NULL;
+        }
+        free(pipeline);
+    }
+    for (int k = 0; k < renderer->n_outputs; k++) {
+        g_free(renderer->outputs[k].audiosink);
     }
+    free(renderer);
 }
+
+const audio_renderer_funcs_t audio_renderer_gstreamer_funcs = {
+    .name = "gstreamer",
+    .init = audio_renderer_gstreamer_init,
+    .prewarm = audio_renderer_gstreamer_prewarm,
+    .start = audio_renderer_gstreamer_start,
+    .stop = audio_renderer_gstreamer_stop,
+    .render_buffer = audio_renderer_gstreamer_render_buffer,
+    .set_volume = audio_renderer_gstreamer_set_volume,
+    .flush = audio_renderer_gstreamer_flush,
+    .get_queue_level = audio_renderer_gstreamer_get_queue_level,
+    .get_sink_stats = audio_renderer_gstreamer_get_sink_stats,
+    .destroy = audio_renderer_gstreamer_destroy,
+};
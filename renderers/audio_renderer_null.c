@@ -0,0 +1,203 @@
+/**
+ * UxPlay - An open-source AirPlay mirroring server
+ * Copyright (C) 2026 UxPlay contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/*
+ * The "null" audio renderer backend: no GStreamer, no decoding and no audio device.  Each
+ * packet is checked (first byte and size of a frame of the compression type in use, as in
+ * audio_renderer_gstreamer.c, and gaps in the sequence numbers), the time it arrived before it
+ * was due to be played is recorded, and it is dropped.  A summary is logged at the end of
+ * each session.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "audio_renderer.h"
+#include "../lib/latency_trace.h"
+#include "../lib/metrics.h"
+
+#define MAX_FRAME_BYTES 4096     /* 352 (ALAC) or 480 (AAC-ELD) 16-bit stereo samples need < 2 kB */
+
+struct audio_renderer_s {
+    const audio_renderer_funcs_t *funcs;      /* must be first (see audio_renderer.c) */
+    logger_t *logger;
+    unsigned char ct;                         /* compression type, 0 if not started */
+    double volume;
+    bool have_seqnum;
+    unsigned short last_seqnum;
+    uint64_t packets, bytes;
+    uint64_t bad_packets;                     /* not a frame of type ct */
+    uint64_t missing_packets;                 /* gaps in the sequence numbers */
+    uint64_t late_packets;                    /* arrived after they were due */
+    metrics_histogram_t lead;                 /* arrival to presentation time */
+};
+
+static bool check_frame(unsigned char ct, const unsigned char *data, int len) {
+    if (len <= 0 || len > MAX_FRAME_BYTES) {
+        return false;
+    }
+    switch (ct) {
+    case 1:  /* LPCM: whole 16-bit stereo samples */
+        return (len % 4 == 0);
+    case 2:  /* ALAC */
+        return (data[0] == 0x20);
+    case 4:  /* AAC-LC */
+        return (data[0] == 0xff);
+    case 8:  /* AAC-ELD: 0x8c-0x8e, or 0x80-0x82 from older iOS */
+        return ((data[0] >= 0x8c && data[0] <= 0x8e) || (data[0] >= 0x80 && data[0] <= 0x82));
+    default:
+        return false;
+    }
+}
+
+static void log_summary(audio_renderer_t *renderer) {
+    if (!renderer->packets && !renderer->bad_packets) {
+        return;
+    }
+    logger_log(renderer->logger, LOGGER_INFO, "null audio renderer: %llu packets (compression type %d), %.1f kB; "
+               "%llu invalid, %llu missing (sequence number gaps)", (unsigned long long) renderer->packets,
+               renderer->ct, (double) renderer->bytes / 1000.0, (unsigned long long) renderer->bad_packets,
+               (unsigned long long) renderer->missing_packets);
+    if (renderer->lead.count) {
+        logger_log(renderer->logger, LOGGER_INFO, "null audio renderer: packets arrived (ms before due) "
+                   "p50 %.2f p10 %.2f p1 %.2f; %llu arrived late",
+                   1000.0 * metrics_histogram_quantile(&renderer->lead, 0.5),
+                   1000.0 * metrics_histogram_quantile(&renderer->lead, 0.1),
+                   1000.0 * metrics_histogram_quantile(&renderer->lead, 0.01),
+                   (unsigned long long) renderer->late_packets);
+    }
+}
+
+static void clear_stats(audio_renderer_t *renderer) {
+    renderer->have_seqnum = false;
+    renderer->packets = renderer->bytes = 0;
+    renderer->bad_packets = renderer->missing_packets = renderer->late_packets = 0;
+    memset(&renderer->lead, 0, sizeof(renderer->lead));
+}
+
+static audio_renderer_t *audio_renderer_null_init(logger_t *logger, const char* audiosink, const bool *audio_sync,
+                                                  const bool *video_sync, const audio_renderer_extras_t *extras) {
+    audio_renderer_t *renderer = calloc(1, sizeof(audio_renderer_t));
+    if (!renderer) {
+        return NULL;
+    }
+    renderer->funcs = &audio_renderer_null_funcs;
+    renderer->logger = logger;
+    renderer->volume = 1.0;
+    logger_log(logger, LOGGER_INFO, "using the null audio renderer (no decoding or audio output)");
+    return renderer;
+}
+
+static void audio_renderer_null_prewarm(audio_renderer_t *renderer, unsigned char compression_type,
+                                        bool background) {
+}
+
+static void audio_renderer_null_start(audio_renderer_t *renderer, unsigned char *ct) {
+    switch (*ct) {
+    case 1:
+    case 2:
+    case 4:
+    case 8:
+        if (*ct != renderer->ct) {
+            log_summary(renderer);
+            clear_stats(renderer);
+            logger_log(renderer->logger, LOGGER_INFO, "start audio connection (null renderer), compression type %d",
+                       *ct);
+            renderer->ct = *ct;
+        }
+        break;
+    default:
+        logger_log(renderer->logger, LOGGER_ERR, "unknown audio compression type ct = %d", *ct);
+        break;
+    }
+}
+
+static void audio_renderer_null_stop(audio_renderer_t *renderer) {
+    log_summary(renderer);
+    clear_stats(renderer);
+    renderer->ct = 0;
+}
+
+static void audio_renderer_null_render_buffer(audio_renderer_t *renderer, unsigned char *data, int *data_len,
+                                              unsigned short *seqnum, uint64_t *ntp_time) {
+    uint64_t now = latency_trace_now();
+    if (!renderer->ct) {
+        return;
+    }
+    if (!check_frame(renderer->ct, data, *data_len)) {
+        if (!renderer->bad_packets) {
+            logger_log(renderer->logger, LOGGER_WARNING, "null audio renderer: invalid %d-byte frame "
+                       "(compression type %d), first byte 0x%2.2x", *data_len, renderer->ct,
+                       *data_len > 0 ? (unsigned int) data[0] : 0);
+        }
+        renderer->bad_packets++;
+        return;
+    }
+    if (renderer->have_seqnum) {
+        unsigned short gap = (unsigned short) (*seqnum - renderer->last_seqnum);
+        if (gap > 1 && gap < 0x8000) {
+            renderer->missing_packets += gap - 1;
+        }
+    }
+    renderer->have_seqnum = true;
+    renderer->last_seqnum = *seqnum;
+    renderer->packets++;
+    renderer->bytes += *data_len;
+    if (*ntp_time >= now) {
+        metrics_histogram_observe(&renderer->lead, (int64_t) (*ntp_time - now));
+    } else {
+        renderer->late_packets++;
+    }
+}
+
+static void audio_renderer_null_set_volume(audio_renderer_t *renderer, double volume) {
+    renderer->volume = volume;
+}
+
+static void audio_renderer_null_flush(audio_renderer_t *renderer) {
+    renderer->have_seqnum = false;
+}
+
+static bool audio_renderer_null_get_queue_level(audio_renderer_t *renderer, unsigned int *buffers,
+                                                unsigned int *bytes, uint64_t *time) {
+    return false;
+}
+
+static bool audio_renderer_null_get_sink_stats(audio_renderer_t *renderer, int index, const char **audiosink,
+                                               int64_t *drift, uint64_t *late, uint64_t *dropped) {
+    return false;
+}
+
+static void audio_renderer_null_destroy(audio_renderer_t *renderer) {
+    log_summary(renderer);
+    free(renderer);
+}
+
+const audio_renderer_funcs_t audio_renderer_null_funcs = {
+    .name = "null",
+    .init = audio_renderer_null_init,
+    .prewarm = audio_renderer_null_prewarm,
+    .start = audio_renderer_null_start,
+    .stop = audio_renderer_null_stop,
+    .render_buffer = audio_renderer_null_render_buffer,
+    .set_volume = audio_renderer_null_set_volume,
+    .flush = audio_renderer_null_flush,
+    .get_queue_level = audio_renderer_null_get_queue_level,
+    .get_sink_stats = audio_renderer_null_get_sink_stats,
+    .destroy = audio_renderer_null_destroy,
+};
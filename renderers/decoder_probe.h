@@ -0,0 +1,55 @@
+/**
+ * UxPlay - An open-source AirPlay mirroring server
+ * Copyright (C) 2026 UxPlay contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/*
+ * Selection of the fastest h264 decoder on this host.  Short 1080p and 4K h264 clips are
+ * encoded (from videotestsrc, with the first h264 encoder found), and each h264 decoder in
+ * the GStreamer registry decodes them as fast as it can; the decoder with the highest 1080p
+ * frame rate (that also decodes the 4K clip) wins, and is cached in a file, one line per
+ * host: "<hostname> <GStreamer version> <decoder> <1080p fps>".  The probe runs again when
+ * the GStreamer version changes, or when the cached decoder is no longer installed.  Failures
+ * are cached too: <decoder> is "none" if no decoder could be tested or none decoded the clips,
+ * and "probing:<decoder>" while <decoder> is tested, so that a decoder that crashes UxPlay is
+ * not probed again at the next start (unless reprobe is set).
+ */
+
+#ifndef DECODER_PROBE_H
+#define DECODER_PROBE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "../lib/logger.h"
+
+/* call after gstreamer_init().  The decoder is read from cache_file (if not NULL), unless   *
+ * reprobe is set; otherwise the probe is run (this takes a few seconds) and the result is    *
+ * saved in cache_file.  The videoconverter that matches the decoder (v4l2convert for the     *
+ * v4l2 decoders, else videoconvert) is written to converter.  Returns false (and leaves      *
+ * decoder and converter unchanged) if no decoder was selected, now or by the cached probe    */
+bool decoder_probe_select(logger_t *logger, const char *cache_file, bool reprobe, char *decoder, size_t len,
+                          char *converter, size_t converter_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //DECODER_PROBE_H
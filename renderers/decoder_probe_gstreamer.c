@@ -0,0 +1,437 @@
+/**
+ * UxPlay - An open-source AirPlay mirroring server
+ * Copyright (C) 2026 UxPlay contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+#include <gst/app/gstappsink.h>
+#include "decoder_probe.h"
+
+#define PROBE_TIMEOUT_SECS 10            /* for making a clip, or decoding it */
+#define SAME_FPS_PERCENT 5               /* decoders this close in speed are compared by cpu use */
+#define MAX_NAME 64
+#define MAX_LINE 512
+
+static const char h264_caps[]="video/x-h264,stream-format=(string)byte-stream,alignment=(string)au";
+
+/* h264 encoders for making the clips, in order of preference, with options for a stream *
+ * like the one sent by the client: no B-frames, and an IDR frame every second           */
+static const struct {
+    const char *name;
+    const char *options;
+} encoders[] = {
+    { "x264enc", "speed-preset=ultrafast tune=zerolatency bframes=0 key-int-max=30 bitrate=20000" },
+    { "openh264enc", "" },
+    { "vah264enc", "" },
+    { "vaapih264enc", "" },
+    { "v4l2h264enc", "" },
+    { "vtenc_h264", "realtime=true allow-frame-reordering=false" },
+    { "nvh264enc", "" },
+    { "mfh264enc", "" },
+};
+
+/* cache entries that are not a decoder name */
+#define CACHE_NONE "none"                /* no decoder could be tested, or none decoded the clips */
+#define CACHE_PROBING "probing:"         /* followed by the decoder under test: the probe did not finish */
+
+typedef enum cache_lookup_e {
+    CACHE_MISS,
+    CACHE_DECODER,
+    CACHE_FAILED
+} cache_lookup_t;
+
+typedef struct clip_s {
+    const char *name;
+    int width, height, frames;
+    GstBuffer **buffers;                 /* the access units */
+    int count;
+} clip_t;
+
+typedef struct decode_run_s {
+    int frames;                          /* decoded frames seen by fakesink */
+    gint64 first, last;                  /* when the first and last of them arrived */
+} decode_run_t;
+
+typedef struct result_s {
+    double fps;                          /* decoded frames per second */
+    double cpu_msecs;                    /* cpu time per frame, < 0 if not measured */
+} result_t;
+
+/* the Video4Linux2 decoders output buffers that v4l2convert can convert without copying them */
+static void set_converter(const char *decoder, char *converter, size_t len) {
+    snprintf(converter, len, "%s", strncmp(decoder, "v4l2", 4) ? "videoconvert" : "v4l2convert");
+}
+
+static double cpu_secs() {
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return (double) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+            (double) (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+    }
+#endif
+    return -1.0;
+}
+
+/* returns true (and logs the error) if the pipeline has posted an error message */
+static bool pipeline_failed(logger_t *logger, GstElement *pipeline, const char *what) {
+    GstBus *bus = gst_element_get_bus(pipeline);
+    GstMessage *message = gst_bus_pop_filtered(bus, GST_MESSAGE_ERROR);
+    gst_object_unref(bus);
+    if (!message) {
+        return false;
+    }
+    GError *err = NULL;
+    gst_message_parse_error(message, &err, NULL);
+    logger_log(logger, LOGGER_DEBUG, "decoder probe: %s failed: %s", what, err ? err->message : "unknown error");
+    g_clear_error(&err);
+    gst_message_unref(message);
+    return true;
+}
+
+static void free_clip(clip_t *clip) {
+    for (int i = 0; i < clip->count; i++) {
+        gst_buffer_unref(clip->buffers[i]);
+    }
+    free(clip->buffers);
+    clip->buffers = NULL;
+    clip->count = 0;
+}
+
+static bool encode_clip(logger_t *logger, const char *encoder, const char *options, clip_t *clip) {
+    GError *error = NULL;
+    gchar *launch = g_strdup_printf("videotestsrc num-buffers=%d pattern=smpte horizontal-speed=8 ! "
+                                    "video/x-raw,format=I420,width=%d,height=%d,framerate=30/1 ! %s %s ! "
+                                    "h264parse config-interval=-1 ! %s ! appsink name=clip_sink sync=false",
+                                    clip->frames, clip->width, clip->height, encoder, options, h264_caps);
+    GstElement *pipeline = gst_parse_launch(launch, &error);
+    g_free(launch);
+    if (error) {
+        logger_log(logger, LOGGER_DEBUG, "decoder probe: cannot encode the %s clip with %s: %s", clip->name,
+                   encoder, error->message);
+        g_clear_error(&error);
+        if (pipeline) {
+            gst_object_unref(pipeline);
+        }
+        return false;
+    }
+
+    GstElement *sink = gst_bin_get_by_name(GST_BIN(pipeline), "clip_sink");
+    gint64 deadline = g_get_monotonic_time() + PROBE_TIMEOUT_SECS * G_TIME_SPAN_SECOND;
+    clip->buffers = calloc(clip->frames, sizeof(GstBuffer *));
+    clip->count = 0;
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    while (clip->buffers && clip->count < clip->frames && g_get_monotonic_time() < deadline) {
+        GstSample *sample = gst_app_sink_try_pull_sample(GST_APP_SINK(sink), 100 * GST_MSECOND);
+        if (sample) {
+            clip->buffers[clip->count++] = gst_buffer_ref(gst_sample_get_buffer(sample));
+            gst_sample_unref(sample);
+        } else if (gst_app_sink_is_eos(GST_APP_SINK(sink)) || pipeline_failed(logger, pipeline, encoder)) {
+            break;
+        }
+    }
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(sink);
+    gst_object_unref(pipeline);
+
+    /* some hardware encoders stop early; half the frames are still enough to time a decoder */
+    if (clip->count < clip->frames / 2) {
+        logger_log(logger, LOGGER_DEBUG, "decoder probe: %s made %d of the %d frames of the %s clip", encoder,
+                   clip->count, clip->frames, clip->name);
+        free_clip(clip);
+        return false;
+    }
+    return true;
+}
+
+static bool make_clip(logger_t *logger, clip_t *clip) {
+    for (int i = 0; i < (int) (sizeof(encoders) / sizeof(encoders[0])); i++) {
+        GstElementFactory *factory = gst_element_factory_find(encoders[i].name);
+        if (!factory) {
+            continue;
+        }
+        gst_object_unref(factory);
+        if (encode_clip(logger, encoders[i].name, encoders[i].options, clip)) {
+            logger_log(logger, LOGGER_DEBUG, "decoder probe: %s clip (%d frames) encoded with %s", clip->name,
+                       clip->count, encoders[i].name);
+            return true;
+        }
+    }
+    return false;
+}
+
+static GstPadProbeReturn count_frame(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    decode_run_t *run = (decode_run_t *) user_data;
+    gint64 now = g_get_monotonic_time();
+    if (!run->frames) {
+        run->first = now;
+    }
+    run->last = now;
+    run->frames++;
+    return GST_PAD_PROBE_OK;
+}
+
+static bool decode_clip(logger_t *logger, const char *decoder, const clip_t *clip, result_t *result) {
+    GError *error = NULL;
+    decode_run_t run = { 0 };
+    char converter[MAX_NAME];
+    set_converter(decoder, converter, sizeof(converter));
+    gchar *launch = g_strdup_printf("appsrc name=probe_src ! h264parse ! %s ! %s ! fakesink name=probe_sink sync=false",
+                                    decoder, converter);
+    GstElement *pipeline = gst_parse_launch(launch, &error);
+    g_free(launch);
+    if (error) {
+        logger_log(logger, LOGGER_DEBUG, "decoder probe: cannot use %s: %s", decoder, error->message);
+        g_clear_error(&error);
+        if (pipeline) {
+            gst_object_unref(pipeline);
+        }
+        return false;
+    }
+
+    GstElement *src = gst_bin_get_by_name(GST_BIN(pipeline), "probe_src");
+    GstCaps *caps = gst_caps_from_string(h264_caps);
+    g_object_set(src, "caps", caps, "stream-type", 0, "is-live", FALSE, "format", GST_FORMAT_TIME, NULL);
+    gst_caps_unref(caps);
+    GstElement *sink = gst_bin_get_by_name(GST_BIN(pipeline), "probe_sink");
+    GstPad *pad = gst_element_get_static_pad(sink, "sink");
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, count_frame, &run, NULL);
+    gst_object_unref(pad);
+    gst_object_unref(sink);
+
+    double cpu_start = cpu_secs();
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    for (int i = 0; i < clip->count; i++) {
+        gst_app_src_push_buffer(GST_APP_SRC(src), gst_buffer_ref(clip->buffers[i]));
+    }
+    gst_app_src_end_of_stream(GST_APP_SRC(src));
+    gst_object_unref(src);
+
+    bool ok = false;
+    GstBus *bus = gst_element_get_bus(pipeline);
+    GstMessage *message = gst_bus_timed_pop_filtered(bus, PROBE_TIMEOUT_SECS * GST_SECOND,
+                                                     (GstMessageType) (GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+    double cpu_end = cpu_secs();
+    if (!message) {
+        logger_log(logger, LOGGER_INFO, "decoder probe: %s did not decode the %s clip within %d seconds", decoder,
+                   clip->name, PROBE_TIMEOUT_SECS);
+    } else if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_ERROR) {
+        GError *err = NULL;
+        gst_message_parse_error(message, &err, NULL);
+        logger_log(logger, LOGGER_INFO, "decoder probe: %s failed on the %s clip: %s", decoder, clip->name,
+                   err ? err->message : "unknown error");
+        g_clear_error(&err);
+    } else if (run.frames != clip->count) {
+        logger_log(logger, LOGGER_INFO, "decoder probe: %s decoded %d of the %d frames of the %s clip", decoder,
+                   run.frames, clip->count, clip->name);
+    } else {
+        ok = true;
+    }
+    if (message) {
+        gst_message_unref(message);
+    }
+    gst_object_unref(bus);
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pipeline);
+
+    if (!ok) {
+        return false;
+    }
+    /* from the first decoded frame: plugin loading and setup are not part of the frame rate */
+    result->fps = (run.last > run.first) ? (double) (run.frames - 1) * 1000000.0 / (double) (run.last - run.first) : 0.0;
+    result->cpu_msecs = (cpu_start >= 0.0) ? (cpu_end - cpu_start) * 1000.0 / run.frames : -1.0;
+    return true;
+}
+
+static cache_lookup_t read_cache(logger_t *logger, const char *cache_file, const char *host, const char *version,
+                                 char *decoder, size_t len) {
+    char line[MAX_LINE], line_host[MAX_LINE], line_version[MAX_NAME], line_decoder[MAX_NAME];
+    double fps;
+    cache_lookup_t found = CACHE_MISS;
+    FILE *fp = fopen(cache_file, "r");
+    if (!fp) {
+        return CACHE_MISS;
+    }
+    while (found == CACHE_MISS && fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "%511s %63s %63s %lf", line_host, line_version, line_decoder, &fps) != 4 ||
+            strcmp(line_host, host) || strcmp(line_version, version)) {
+            continue;
+        }
+        if (!strcmp(line_decoder, CACHE_NONE)) {
+            logger_log(logger, LOGGER_INFO, "decoder probe: the last probe found no usable h264 decoder (see %s); "
+                       "using %s (use \"-vdprobe new\" to probe again)", cache_file, decoder);
+            found = CACHE_FAILED;
+            break;
+        }
+        if (!strncmp(line_decoder, CACHE_PROBING, strlen(CACHE_PROBING))) {
+            logger_log(logger, LOGGER_WARNING, "decoder probe: the last probe did not finish while testing %s "
+                       "(it may have crashed UxPlay); using %s (use \"-vdprobe new\" to probe again)",
+                       line_decoder + strlen(CACHE_PROBING), decoder);
+            found = CACHE_FAILED;
+            break;
+        }
+        GstElementFactory *factory = gst_element_factory_find(line_decoder);
+        if (!factory) {
+            logger_log(logger, LOGGER_INFO, "decoder probe: cached decoder %s is no longer installed", line_decoder);
+            break;
+        }
+        gst_object_unref(factory);
+        snprintf(decoder, len, "%s", line_decoder);
+        logger_log(logger, LOGGER_INFO, "using h264 decoder %s (%.0f fps at 1080p, from %s; use \"-vdprobe new\" "
+                   "to probe again)", decoder, fps, cache_file);
+        found = CACHE_DECODER;
+    }
+    fclose(fp);
+    return found;
+}
+
+/* the line for this host replaces any earlier one; lines of other hosts (with a shared home directory) are kept. *
+ * entry is a decoder name, CACHE_NONE, or CACHE_PROBING followed by a decoder name                               */
+static void write_cache(logger_t *logger, const char *cache_file, const char *host, const char *version,
+                        const char *entry, double fps) {
+    char line[MAX_LINE], line_host[MAX_LINE];
+    GString *contents = g_string_new("");
+    FILE *fp = fopen(cache_file, "r");
+    if (fp) {
+        while (fgets(line, sizeof(line), fp)) {
+            if (sscanf(line, "%511s", line_host) == 1 && strcmp(line_host, host)) {
+                g_string_append(contents, line);
+            }
+        }
+        fclose(fp);
+    }
+    g_string_append_printf(contents, "%s %s %s %.1f\n", host, version, entry, fps);
+    fp = fopen(cache_file, "w");
+    if (!fp || fputs(contents->str, fp) == EOF) {
+        logger_log(logger, LOGGER_WARNING, "decoder probe: could not save the result in %s", cache_file);
+    }
+    if (fp) {
+        fclose(fp);
+    }
+    g_string_free(contents, TRUE);
+}
+
+bool decoder_probe_select(logger_t *logger, const char *cache_file, bool reprobe, char *decoder, size_t len,
+                          char *converter, size_t converter_len) {
+    clip_t clips[2] = { { "1080p", 1920, 1080, 60, NULL, 0 }, { "4K", 3840, 2160, 30, NULL, 0 } };
+    char host[MAX_LINE], version[MAX_NAME];
+    char best[MAX_NAME] = "";
+    result_t best_result = { 0.0, -1.0 };
+    guint major, minor, micro, nano;
+    int tested = 0;
+    gint64 start_time = g_get_monotonic_time();
+
+    /* the host name and GStreamer version are written as single words */
+    snprintf(host, sizeof(host), "%s", g_get_host_name());
+    for (char *c = host; *c; c++) {
+        if (*c == ' ' || *c == '\t') {
+            *c = '_';
+        }
+    }
+    gst_version(&major, &minor, &micro, &nano);
+    snprintf(version, sizeof(version), "%u.%u.%u", major, minor, micro);
+
+    if (cache_file && !reprobe) {
+        switch (read_cache(logger, cache_file, host, version, decoder, len)) {
+        case CACHE_DECODER:
+            set_converter(decoder, converter, converter_len);
+            return true;
+        case CACHE_FAILED:
+            return false;
+        default:
+            break;
+        }
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (!make_clip(logger, &clips[i])) {
+            logger_log(logger, LOGGER_INFO, "decoder probe: no GStreamer h264 encoder could make the %s test clip; "
+                       "not probing the h264 decoders (using %s)", clips[i].name, decoder);
+            free_clip(&clips[0]);
+            if (cache_file) {
+                write_cache(logger, cache_file, host, version, CACHE_NONE, 0.0);
+            }
+            return false;
+        }
+    }
+
+    GstCaps *caps = gst_caps_from_string("video/x-h264");
+    GList *factories = gst_element_factory_list_get_elements(GST_ELEMENT_FACTORY_TYPE_DECODER |
+                                                             GST_ELEMENT_FACTORY_TYPE_MEDIA_VIDEO, GST_RANK_MARGINAL);
+    /* highest rank first, so the decoder decodebin would choose wins a tie */
+    factories = g_list_sort(factories, (GCompareFunc) gst_plugin_feature_rank_compare_func);
+    for (GList *l = factories; l; l = l->next) {
+        GstElementFactory *factory = (GstElementFactory *) l->data;
+        const char *name = gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(factory));
+        result_t result[2];
+        if (!gst_element_factory_can_sink_any_caps(factory, caps) || strlen(name) >= MAX_NAME) {
+            continue;
+        }
+        tested++;
+        /* if this decoder crashes UxPlay, the next start finds this entry and does not probe again */
+        if (cache_file) {
+            gchar *entry = g_strdup_printf("%s%s", CACHE_PROBING, name);
+            write_cache(logger, cache_file, host, version, entry, 0.0);
+            g_free(entry);
+        }
+        if (!decode_clip(logger, name, &clips[0], &result[0]) || !decode_clip(logger, name, &clips[1], &result[1])) {
+            continue;
+        }
+        if (result[0].cpu_msecs >= 0.0) {
+            logger_log(logger, LOGGER_INFO, "decoder probe: %-20s 1080p %6.0f fps (cpu %.2f ms/frame), "
+                       "4K %6.0f fps (cpu %.2f ms/frame)", name, result[0].fps, result[0].cpu_msecs,
+                       result[1].fps, result[1].cpu_msecs);
+        } else {
+            logger_log(logger, LOGGER_INFO, "decoder probe: %-20s 1080p %6.0f fps, 4K %6.0f fps", name,
+                       result[0].fps, result[1].fps);
+        }
+        bool faster = (result[0].fps * 100 > best_result.fps * (100 + SAME_FPS_PERCENT));
+        bool same_speed = (result[0].fps * 100 >= best_result.fps * (100 - SAME_FPS_PERCENT));
+        if (!best[0] || faster || (same_speed && result[0].cpu_msecs < best_result.cpu_msecs)) {
+            snprintf(best, sizeof(best), "%s", name);
+            best_result = result[0];
+        }
+    }
+    gst_plugin_feature_list_free(factories);
+    gst_caps_unref(caps);
+    free_clip(&clips[0]);
+    free_clip(&clips[1]);
+
+    if (!best[0]) {
+        logger_log(logger, LOGGER_WARNING, "decoder probe: none of the %d h264 decoders found decoded the test clips; "
+                   "using %s", tested, decoder);
+        if (cache_file) {
+            write_cache(logger, cache_file, host, version, CACHE_NONE, 0.0);
+        }
+        return false;
+    }
+    snprintf(decoder, len, "%s", best);
+    set_converter(decoder, converter, converter_len);
+    logger_log(logger, LOGGER_INFO, "decoder probe: using h264 decoder %s with %s (probe took %.1f secs)", decoder,
+               converter, (double) (g_get_monotonic_time() - start_time) / 1000000.0);
+    if (cache_file) {
+        write_cache(logger, cache_file, host, version, decoder, best_result.fps);
+    }
+    return true;
+}
@@ -0,0 +1,81 @@
+/**
+ * UxPlay - An open-source AirPlay mirroring server
+ * Copyright (C) 2026 UxPlay contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/*
+ * Recording of the received (still compressed) h264 video and audio to fragmented MP4 or
+ * Matroska files, using GStreamer.  Frames are copied into bounded appsrc queues and are
+ * muxed and written by GStreamer streaming threads, so a slow disk never blocks the
+ * receiver threads: when a queue is full, the frame is dropped (and counted), and video
+ * is then dropped until the next IDR frame.  Timestamps are the sender's (remote) NTP
+ * times, so audio and video stay in sync.  Files are split into segments by size and/or
+ * duration; a new recording (set of segments) starts with each client session.
+ *
+ * The "instant replay" keeps the frames of the last n seconds (starting at an IDR frame,
+ * and within a memory limit) in a ring in memory instead; recorder_replay_save() writes
+ * them to an MP4 file from a background thread.
+ */
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../lib/logger.h"
+
+typedef enum recorder_container_e {
+    RECORDER_MP4,
+    RECORDER_MKV,
+} recorder_container_t;
+
+typedef struct recorder_stats_s {
+    uint64_t video_frames;         /* frames queued for writing */
+    uint64_t audio_frames;
+    uint64_t dropped_frames;       /* frames dropped because the writer could not keep up */
+    uint64_t segments;             /* files opened */
+    bool recording;
+    uint64_t replay_bytes;         /* memory used by the instant-replay ring */
+    uint64_t replays_saved;
+} recorder_stats_t;
+
+/* call after gstreamer_init(); files are "<location>.<date-time>.<nnn>.mp4|mkv". *
+ * max_bytes, max_seconds: segment size limits (0 = none); returns false if the    *
+ * GStreamer plugins needed are missing (recording is then disabled)              */
+bool recorder_init(logger_t *logger, const char *location, recorder_container_t container,
+                   uint64_t max_bytes, unsigned int max_seconds);
+/* call after gstreamer_init(); replays are saved to "<location>.<date-time>.mp4"; max_bytes: *
+ * memory limit of the ring.  Can be used with or without recorder_init()                  */
+bool recorder_replay_init(logger_t *logger, const char *location, unsigned int seconds, uint64_t max_bytes);
+void recorder_replay_save();      /* returns at once; the file is written in the background */
+void recorder_video_frame(const unsigned char *data, int data_len, uint64_t ntp_time_remote);
+void recorder_audio_frame(const unsigned char *data, int data_len, unsigned char ct, uint64_t ntp_time_remote);
+void recorder_stop();             /* end the current recording (end of a client session) */
+void recorder_get_stats(recorder_stats_t *stats);
+/* true if an access unit of the mirror stream has an SPS or IDR slice (also used by restream) */
+bool recorder_is_keyframe(const unsigned char *data, int len);
+void recorder_destroy();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RECORDER_H
@@ -0,0 +1,545 @@
+/**
+ * UxPlay - An open-source AirPlay mirroring server
+ * Copyright (C) 2026 UxPlay contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+#include "recorder.h"
+#include "appsrc_session.h"
+
+#define QUEUE_BYTES (8 * 1024 * 1024)          /* per stream; several seconds of mirror video */
+#define FRAGMENT_MSECS 1000                    /* mp4 fragment duration: at most 1 sec is lost on a crash */
+#define CLOSE_TIMEOUT_SECS 10
+#define REPLAY_SAVE_TIMEOUT_SECS 60
+
+static logger_t *logger = NULL;
+static bool enabled = false;
+static char *location = NULL;
+static recorder_container_t container = RECORDER_MP4;
+static uint64_t max_bytes = 0;
+static unsigned int max_seconds = 0;
+static appsrc_sessions_t *sessions = NULL;     /* the recordings (see appsrc_session.h); never freed */
+
+static GMutex close_mutex;
+static GCond close_cond;
+static int closing = 0;                        /* instant replays being saved */
+
+static recorder_stats_t stats;                 /* updated atomically */
+
+/* instant replay: the frames of the last replay_seconds, oldest first, in memory.  Frames are *
+ * reference-counted, so a save thread can write a snapshot while the ring keeps changing     */
+typedef struct replay_frame_s {
+    struct replay_frame_s *next;
+    gint refcount;
+    uint64_t ntp_time;
+    unsigned char ct;                          /* 0: video */
+    bool keyframe;
+    int len;
+    unsigned char data[];
+} replay_frame_t;
+
+static bool replay_enabled = false;
+static char *replay_location = NULL;
+static uint64_t replay_usecs = 0;
+static uint64_t replay_max_bytes = 0;
+
+static GMutex replay_mutex;                    /* protects the variables below */
+static replay_frame_t *replay_head = NULL, *replay_tail = NULL;
+static uint64_t replay_bytes = 0;
+static int replay_keyframes = 0;               /* video keyframes in the ring */
+static bool replay_new_session = false;        /* the next frame clears the ring */
+static bool replay_saving = false;
+
+/* access units have 0x00 0x00 0x00 0x01 start codes; SPS, PPS and SEI NALs come before the *
+ * (first) VCL NAL, so only these need to be checked for an SPS or IDR slice                */
+bool recorder_is_keyframe(const unsigned char *data, int len) {
+    for (int i = 0; i + 4 < len; i++) {
+        if (data[i] || data[i + 1] || data[i + 2] || data[i + 3] != 1) {
+            continue;
+        }
+        int type = data[i + 4] & 0x1f;
+        if (type == 5 || type == 7) {
+            return true;
+        } else if (type >= 1 && type <= 4) {
+            return false;
+        }
+        i += 4;
+    }
+    return false;
+}
+
+static void recording_message(const GstStructure *structure);
+static bool recording_build(appsrc_session_t *session);
+
+bool recorder_init(logger_t *render_logger, const char *filename, recorder_container_t format,
+                   uint64_t segment_bytes, unsigned int segment_seconds) {
+    const char *muxer = (format == RECORDER_MP4) ? "mp4mux" : "matroskamux";
+    const char *needed[] = { muxer, "splitmuxsink", "h264parse", "appsrc" };
+
+    logger = render_logger;
+    for (int i = 0; i < (int) (sizeof(needed) / sizeof(needed[0])); i++) {
+        GstElementFactory *factory = gst_element_factory_find(needed[i]);
+        if (!factory) {
+            logger_log(logger, LOGGER_ERR, "recording is disabled: GStreamer element \"%s\" was not found", needed[i]);
+            return false;
+        }
+        gst_object_unref(factory);
+    }
+    g_free(location);
+    location = g_strdup(filename);
+    container = format;
+    max_bytes = segment_bytes;
+    max_seconds = segment_seconds;
+    if (!sessions) {
+        sessions = appsrc_sessions_init(logger, "recording", QUEUE_BYTES, CLOSE_TIMEOUT_SECS, recording_build,
+                                        recording_message);
+    }
+    enabled = true;
+    return true;
+}
+
+static void recording_message(const GstStructure *structure) {
+    if (gst_structure_has_name(structure, "splitmuxsink-fragment-opened")) {
+        const gchar *file = gst_structure_get_string(structure, "location");
+        __atomic_fetch_add(&stats.segments, 1, __ATOMIC_RELAXED);
+        logger_log(logger, LOGGER_INFO, "recording to %s", file ? file : "(unknown file)");
+    }
+}
+
+/* the appsrcs feed splitmuxsink, which starts a new file (at a keyframe) when a limit is reached */
+static bool recording_build(appsrc_session_t *session) {
+    char date[32];
+    time_t now = time(NULL);
+
+    strftime(date, sizeof(date), "%Y%m%d-%H%M%S", localtime(&now));
+    gchar *pattern = g_strdup_printf("%s.%s.%%03d.%s", location, date, (container == RECORDER_MP4) ? "mp4" : "mkv");
+    GstElement *mux = gst_element_factory_make((container == RECORDER_MP4) ? "mp4mux" : "matroskamux", NULL);
+    GstElement *sink = gst_element_factory_make("splitmuxsink", NULL);
+    g_assert(mux && sink);
+    if (container == RECORDER_MP4) {
+        /* fragmented mp4: playable up to the last complete fragment if uxplay stops without finishing it */
+        g_object_set(mux, "fragment-duration", FRAGMENT_MSECS, NULL);
+    }
+    g_object_set(sink, "muxer", mux, "location", pattern, "max-size-bytes", (guint64) max_bytes,
+                 "max-size-time", (guint64) max_seconds * GST_SECOND, NULL);
+    g_free(pattern);
+
+    gst_bin_add(GST_BIN(session->pipeline), sink);
+    if (session->video_src) {
+        GstElement *parse = gst_element_factory_make("h264parse", NULL);
+        gst_bin_add(GST_BIN(session->pipeline), parse);
+        if (!gst_element_link(session->video_src, parse) || !gst_element_link_pads(parse, "src", sink, "video")) {
+            return false;
+        }
+    }
+    if (session->audio_src && !gst_element_link_pads(session->audio_src, "src", sink, "audio_%u")) {
+        /* e.g. LPCM, which mp4mux does not take: record the video without it */
+        logger_log(logger, LOGGER_WARNING, "this audio format (ct=%d) cannot be recorded in %s", session->audio_ct,
+                   (container == RECORDER_MP4) ? "mp4" : "mkv");
+        gst_bin_remove(GST_BIN(session->pipeline), session->audio_src);
+        session->audio_src = NULL;
+        return session->video_src != NULL;
+    }
+    return true;
+}
+
+static void replay_frame_unref(replay_frame_t *frame) {
+    if (g_atomic_int_dec_and_test(&frame->refcount)) {
+        free(frame);
+    }
+}
+
+/* call with replay_mutex held */
+static void replay_pop() {
+    replay_frame_t *frame = replay_head;
+    replay_head = frame->next;
+    if (!replay_head) {
+        replay_tail = NULL;
+    }
+    replay_bytes -= sizeof(replay_frame_t) + frame->len;
+    if (!frame->ct && frame->keyframe) {
+        replay_keyframes--;
+    }
+    replay_frame_unref(frame);
+}
+
+/* call with replay_mutex held */
+static void replay_clear() {
+    while (replay_head) {
+        replay_pop();
+    }
+    __atomic_store_n(&stats.replay_bytes, 0, __ATOMIC_RELAXED);
+}
+
+/* call with replay_mutex held.  The ring is trimmed a GOP at a time, so it always starts with *
+ * a keyframe: the oldest keyframe is only removed for age if there is a later one (so with     *
+ * infrequent keyframes the ring can hold more than replay_seconds), but always to stay within *
+ * the memory limit; video then restarts at the next keyframe                                  */
+static void replay_trim() {
+    while (replay_head) {
+        /* video frames before the first keyframe cannot be decoded */
+        if (!replay_head->ct && !replay_head->keyframe) {
+            replay_pop();
+            continue;
+        }
+        /* audio and video timestamps are not in step, so the tail can be older than the head */
+        bool too_old = replay_tail->ntp_time > replay_head->ntp_time &&
+                       (replay_tail->ntp_time - replay_head->ntp_time) / 1000 > replay_usecs;
+        if (replay_bytes > replay_max_bytes ||
+            (too_old && (replay_head->ct || replay_keyframes > 1))) {
+            replay_pop();
+        } else {
+            break;
+        }
+    }
+}
+
+static void replay_add(const unsigned char *data, int len, unsigned char ct, bool keyframe, uint64_t ntp_time) {
+    g_mutex_lock(&replay_mutex);
+    /* a video frame is only useful if the ring has its keyframe */
+    bool skip = !replay_enabled || (!ct && !keyframe && (!replay_keyframes || replay_new_session));
+    g_mutex_unlock(&replay_mutex);
+    if (skip) {
+        return;
+    }
+    /* copy the frame before taking the lock */
+    replay_frame_t *frame = (replay_frame_t *) malloc(sizeof(replay_frame_t) + len);
+    if (!frame) {
+        return;
+    }
+    frame->next = NULL;
+    frame->refcount = 1;
+    frame->ntp_time = ntp_time;
+    frame->ct = ct;
+    frame->keyframe = keyframe;
+    frame->len = len;
+    memcpy(frame->data, data, len);
+
+    g_mutex_lock(&replay_mutex);
+    if (!replay_enabled) {
+        g_mutex_unlock(&replay_mutex);
+        free(frame);
+        return;
+    }
+    if (replay_new_session) {
+        /* frames of different sessions have unrelated timestamps */
+        replay_clear();
+        replay_new_session = false;
+    }
+    if (replay_tail && ntp_time < replay_tail->ntp_time && replay_tail->ntp_time - ntp_time > replay_usecs * 1000) {
+        /* the client's clock jumped back */
+        replay_clear();
+    }
+    if (replay_tail) {
+        replay_tail->next = frame;
+    } else {
+        replay_head = frame;
+    }
+    replay_tail = frame;
+    replay_bytes += sizeof(replay_frame_t) + len;
+    if (!ct && keyframe) {
+        replay_keyframes++;
+    }
+    replay_trim();
+    __atomic_store_n(&stats.replay_bytes, replay_bytes, __ATOMIC_RELAXED);
+    g_mutex_unlock(&replay_mutex);
+}
+
+bool recorder_replay_init(logger_t *render_logger, const char *filename, unsigned int seconds, uint64_t max_bytes) {
+    const char *needed[] = { "mp4mux", "h264parse", "appsrc", "filesink" };
+
+    logger = render_logger;
+    for (int i = 0; i < (int) (sizeof(needed) / sizeof(needed[0])); i++) {
+        GstElementFactory *factory = gst_element_factory_find(needed[i]);
+        if (!factory) {
+            logger_log(logger, LOGGER_ERR, "instant replay is disabled: GStreamer element \"%s\" was not found",
+                       needed[i]);
+            return false;
+        }
+        gst_object_unref(factory);
+    }
+    g_free(replay_location);
+    replay_location = g_strdup(filename);
+    replay_usecs = (uint64_t) seconds * 1000000;
+    replay_max_bytes = max_bytes;
+    g_mutex_lock(&replay_mutex);
+    replay_enabled = true;
+    g_mutex_unlock(&replay_mutex);
+    return true;
+}
+
+typedef struct replay_save_s {
+    replay_frame_t **frames;
+    int count;
+    char *filename;
+} replay_save_t;
+
+static GstElement *make_replay_appsrc(const char *caps_string) {
+    GstElement *appsrc = gst_element_factory_make("appsrc", NULL);
+    GstCaps *caps = gst_caps_from_string(caps_string);
+    /* not live, and blocking: the save thread feeds the muxer as fast as the disk allows */
+    g_object_set(appsrc, "caps", caps, "stream-type", 0, "format", GST_FORMAT_TIME,
+                 "max-bytes", (guint64) QUEUE_BYTES, "block", TRUE, NULL);
+    gst_caps_unref(caps);
+    return appsrc;
+}
+
+static void replay_push(GstElement *appsrc, replay_frame_t *frame, uint64_t base_time) {
+    /* the buffer wraps the frame data, and holds a reference to the frame */
+    g_atomic_int_inc(&frame->refcount);
+    GstBuffer *buffer = gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY, frame->data, frame->len, 0,
+                                                    frame->len, frame, (GDestroyNotify) replay_frame_unref);
+    GST_BUFFER_PTS(buffer) = (GstClockTime) (frame->ntp_time - base_time);
+    GST_BUFFER_DTS(buffer) = GST_BUFFER_PTS(buffer);
+    if (!frame->ct && !frame->keyframe) {
+        GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    }
+    gst_app_src_push_buffer(GST_APP_SRC(appsrc), buffer);
+}
+
+/* write the frames of a snapshot of the ring to an mp4 file */
+static gpointer replay_save_thread(gpointer data) {
+    replay_save_t *save = (replay_save_t *) data;
+    GstElement *video_src = NULL, *audio_src = NULL;
+    unsigned char ct = 0;
+    uint64_t base_time = 0;
+    int first = -1;
+
+    /* the snapshot starts with a keyframe, if it has video; use the format of the latest audio */
+    for (int i = 0; i < save->count; i++) {
+        if (!save->frames[i]->ct && first < 0) {
+            first = i;
+        } else if (save->frames[i]->ct) {
+            ct = save->frames[i]->ct;
+        }
+    }
+    base_time = save->frames[first < 0 ? 0 : first]->ntp_time;
+
+    GstElement *pipeline = gst_pipeline_new("replay");
+    GstElement *mux = gst_element_factory_make("mp4mux", NULL);
+    GstElement *sink = gst_element_factory_make("filesink", NULL);
+    g_object_set(sink, "location", save->filename, NULL);
+    gst_bin_add_many(GST_BIN(pipeline), mux, sink, NULL);
+    bool linked = gst_element_link(mux, sink);
+    if (first >= 0) {
+        GstElement *parse = gst_element_factory_make("h264parse", NULL);
+        video_src = make_replay_appsrc(APPSRC_SESSION_H264_CAPS);
+        gst_bin_add_many(GST_BIN(pipeline), video_src, parse, NULL);
+        linked = linked && gst_element_link_many(video_src, parse, mux, NULL);
+    }
+    if (ct && appsrc_session_audio_caps(ct)) {
+        audio_src = make_replay_appsrc(appsrc_session_audio_caps(ct));
+        gst_bin_add(GST_BIN(pipeline), audio_src);
+        if (!gst_element_link(audio_src, mux)) {
+            logger_log(logger, LOGGER_WARNING, "this audio format (ct=%d) cannot be saved in an mp4 replay", ct);
+            gst_bin_remove(GST_BIN(pipeline), audio_src);
+            audio_src = NULL;
+            linked = linked && video_src;
+        }
+    }
+
+    GstBus *bus = gst_element_get_bus(pipeline);
+    GstMessage *message = NULL;
+    if (!linked || gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        logger_log(logger, LOGGER_ERR, "could not save the instant replay to %s", save->filename);
+    } else {
+        for (int i = 0; i < save->count; i++) {
+            replay_frame_t *frame = save->frames[i];
+            if (frame->ntp_time < base_time) {
+                continue;
+            } else if (!frame->ct && video_src) {
+                replay_push(video_src, frame, base_time);
+            } else if (frame->ct == ct && audio_src) {
+                replay_push(audio_src, frame, base_time);
+            }
+        }
+        if (video_src) {
+            gst_app_src_end_of_stream(GST_APP_SRC(video_src));
+        }
+        if (audio_src) {
+            gst_app_src_end_of_stream(GST_APP_SRC(audio_src));
+        }
+        message = gst_bus_timed_pop_filtered(bus, REPLAY_SAVE_TIMEOUT_SECS * GST_SECOND,
+                                             (GstMessageType) (GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        if (!message) {
+            logger_log(logger, LOGGER_ERR, "instant replay %s was not finished within %d seconds", save->filename,
+                       REPLAY_SAVE_TIMEOUT_SECS);
+        } else if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_ERROR) {
+            GError *err = NULL;
+            gst_message_parse_error(message, &err, NULL);
+            logger_log(logger, LOGGER_ERR, "could not save the instant replay to %s: %s", save->filename,
+                       err ? err->message : "unknown error");
+            g_clear_error(&err);
+        } else {
+            double seconds = ((double) save->frames[save->count - 1]->ntp_time - (double) base_time) / 1000000000;
+            logger_log(logger, LOGGER_INFO, "saved the last %.1f seconds (%s%s%s) to %s", seconds,
+                       video_src ? "h264" : "", (video_src && audio_src) ? " + " : "", audio_src ? "audio" : "",
+                       save->filename);
+            __atomic_fetch_add(&stats.replays_saved, 1, __ATOMIC_RELAXED);
+        }
+    }
+    if (message) {
+        gst_message_unref(message);
+    }
+    gst_object_unref(bus);
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pipeline);
+
+    for (int i = 0; i < save->count; i++) {
+        replay_frame_unref(save->frames[i]);
+    }
+    free(save->frames);
+    g_free(save->filename);
+    free(save);
+
+    g_mutex_lock(&replay_mutex);
+    replay_saving = false;
+    g_mutex_unlock(&replay_mutex);
+    g_mutex_lock(&close_mutex);
+    closing--;
+    g_cond_broadcast(&close_cond);
+    g_mutex_unlock(&close_mutex);
+    return NULL;
+}
+
+/* takes a snapshot of the ring (a reference to each frame, so the receiver threads are only *
+ * held up briefly) and saves it in the background                                           */
+void recorder_replay_save() {
+    char date[32];
+    time_t now = time(NULL);
+    int count = 0;
+
+    g_mutex_lock(&replay_mutex);
+    if (!replay_enabled) {
+        g_mutex_unlock(&replay_mutex);
+        return;
+    } else if (replay_saving) {
+        g_mutex_unlock(&replay_mutex);
+        logger_log(logger, LOGGER_INFO, "the previous instant replay is still being saved");
+        return;
+    } else if (!replay_head) {
+        g_mutex_unlock(&replay_mutex);
+        logger_log(logger, LOGGER_INFO, "instant replay: nothing has been received");
+        return;
+    }
+    for (replay_frame_t *frame = replay_head; frame; frame = frame->next) {
+        count++;
+    }
+    replay_save_t *save = (replay_save_t *) calloc(1, sizeof(replay_save_t));
+    g_assert(save);
+    save->frames = (replay_frame_t **) malloc(count * sizeof(replay_frame_t *));
+    g_assert(save->frames);
+    for (replay_frame_t *frame = replay_head; frame; frame = frame->next) {
+        g_atomic_int_inc(&frame->refcount);
+        save->frames[save->count++] = frame;
+    }
+    replay_saving = true;
+    g_mutex_unlock(&replay_mutex);
+
+    strftime(date, sizeof(date), "%Y%m%d-%H%M%S", localtime(&now));
+    save->filename = g_strdup_printf("%s.%s.mp4", replay_location, date);
+    g_mutex_lock(&close_mutex);
+    closing++;
+    g_mutex_unlock(&close_mutex);
+    g_thread_unref(g_thread_new("recorder-replay", replay_save_thread, save));
+}
+
+void recorder_video_frame(const unsigned char *data, int data_len, uint64_t ntp_time_remote) {
+    if ((!enabled && !replay_enabled) || data_len < 5 || data[0]) {
+        return;
+    }
+    bool keyframe = recorder_is_keyframe(data, data_len);
+    if (replay_enabled) {
+        replay_add(data, data_len, 0, keyframe, ntp_time_remote);
+    }
+    if (enabled) {
+        appsrc_sessions_video_frame(sessions, data, data_len, keyframe, ntp_time_remote);
+    }
+}
+
+void recorder_audio_frame(const unsigned char *data, int data_len, unsigned char ct, uint64_t ntp_time_remote) {
+    if (!data_len || !appsrc_session_audio_caps(ct)) {
+        return;
+    }
+    if (replay_enabled) {
+        replay_add(data, data_len, ct, false, ntp_time_remote);
+    }
+    if (enabled) {
+        appsrc_sessions_audio_frame(sessions, data, data_len, ct, ntp_time_remote);
+    }
+}
+
+void recorder_stop() {
+    if (enabled) {
+        appsrc_sessions_stop(sessions);
+    }
+
+    /* the replay of a session can still be saved after it ended, until the next session starts */
+    g_mutex_lock(&replay_mutex);
+    replay_new_session = true;
+    g_mutex_unlock(&replay_mutex);
+}
+
+void recorder_get_stats(recorder_stats_t *copy) {
+    appsrc_session_stats_t recording_stats = { 0 };
+    if (sessions) {
+        appsrc_sessions_get_stats(sessions, &recording_stats);
+    }
+    copy->video_frames = recording_stats.video_frames;
+    copy->audio_frames = recording_stats.audio_frames;
+    copy->dropped_frames = recording_stats.dropped_frames;
+    copy->segments = __atomic_load_n(&stats.segments, __ATOMIC_RELAXED);
+    copy->recording = recording_stats.active;
+    copy->replay_bytes = __atomic_load_n(&stats.replay_bytes, __ATOMIC_RELAXED);
+    copy->replays_saved = __atomic_load_n(&stats.replays_saved, __ATOMIC_RELAXED);
+}
+
+/* finishes the current recording, and waits for all recordings and replays to be finished */
+void recorder_destroy() {
+    if (!enabled && !replay_enabled) {
+        return;
+    }
+    recorder_stop();
+    if (enabled) {
+        recorder_stats_t copy;
+        recorder_get_stats(&copy);
+        appsrc_sessions_finish(sessions);
+        enabled = false;
+        g_free(location);
+        location = NULL;
+        logger_log(logger, LOGGER_INFO, "recorded %llu video and %llu audio frames in %llu files; %llu frames dropped",
+                   (unsigned long long) copy.video_frames, (unsigned long long) copy.audio_frames,
+                   (unsigned long long) copy.segments, (unsigned long long) copy.dropped_frames);
+    }
+    if (replay_enabled) {
+        gint64 end_time = g_get_monotonic_time() + (REPLAY_SAVE_TIMEOUT_SECS + 1) * G_TIME_SPAN_SECOND;
+        g_mutex_lock(&close_mutex);
+        while (closing && g_cond_wait_until(&close_cond, &close_mutex, end_time)) {
+        }
+        g_mutex_unlock(&close_mutex);
+        g_mutex_lock(&replay_mutex);
+        replay_enabled = false;
+        replay_clear();
+        g_mutex_unlock(&replay_mutex);
+        g_free(replay_location);
+        replay_location = NULL;
+    }
+}
@@ -0,0 +1,67 @@
+/**
+ * UxPlay - An open-source AirPlay mirroring server
+ * Copyright (C) 2026 UxPlay contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/*
+ * Re-streaming of the received (still compressed) h264 video and audio to other players on
+ * the local network, without decoding or re-encoding: as RTP over UDP (with an SDP file that
+ * players such as ffplay, vlc or gst-launch can open), or as HLS segments and a playlist in a
+ * local directory (to be served by any web server).  Buffers are timestamped with the
+ * sender's (remote) NTP times and sent out at those times, so the pacing follows the sender.
+ * A new stream starts at the first keyframe of each client session.
+ */
+
+#ifndef RESTREAM_H
+#define RESTREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../lib/logger.h"
+
+typedef enum restream_mode_e {
+    RESTREAM_RTP,
+    RESTREAM_HLS,
+} restream_mode_t;
+
+typedef struct restream_stats_s {
+    uint64_t video_frames;
+    uint64_t audio_frames;
+    uint64_t dropped_frames;
+    bool streaming;
+} restream_stats_t;
+
+/* call after gstreamer_init().  RESTREAM_RTP: video is sent to host:port, audio to host:port+2, *
+ * and the SDP description is written to sdp_file.  RESTREAM_HLS: segments and the playlist    *
+ * "uxplay.m3u8" are written to directory dir; returns false if GStreamer plugins are missing  */
+bool restream_init(logger_t *logger, restream_mode_t mode, const char *host, unsigned short port,
+                   const char *sdp_file, const char *dir);
+void restream_video_frame(const unsigned char *data, int data_len, uint64_t ntp_time_remote);
+void restream_audio_frame(const unsigned char *data, int data_len, unsigned char ct, uint64_t ntp_time_remote);
+void restream_stop();             /* end the current stream (end of a client session) */
+void restream_get_stats(restream_stats_t *stats);
+void restream_destroy();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RESTREAM_H
@@ -0,0 +1,257 @@
+/**
+ * UxPlay - An open-source AirPlay mirroring server
+ * Copyright (C) 2026 UxPlay contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+#include "restream.h"
+#include "recorder.h"
+#include "appsrc_session.h"
+
+#define QUEUE_BYTES (4 * 1024 * 1024)          /* per stream */
+#define RTP_LATENCY_MSECS 200                  /* absorbs the network jitter of the incoming stream */
+#define HLS_TARGET_SECS 1                      /* segments are cut at the first keyframe after this */
+#define HLS_PLAYLIST_LENGTH 6
+#define HLS_MAX_FILES 12
+#define CLOSE_TIMEOUT_SECS 5
+#define VIDEO_PT 96
+#define AUDIO_PT 97
+
+static logger_t *logger = NULL;
+static bool enabled = false;
+static restream_mode_t mode = RESTREAM_RTP;
+static char *host = NULL;
+static unsigned short port = 0;
+static char *sdp_file = NULL;
+static char *hls_dir = NULL;
+static appsrc_sessions_t *sessions = NULL;     /* the streams (see appsrc_session.h); never freed */
+
+static GMutex mutex;                           /* protects the variable below */
+static unsigned char audio_unsupported = 0;    /* format already reported as not supported */
+
+/* RTP carries LPCM (as L16) and AAC (as mpeg4-generic); HLS (MPEG-TS) only AAC-LC, as ADTS *
+ * does not allow AAC-ELD.  ALAC has neither an RTP payload format nor an MPEG-TS mapping.  */
+static bool audio_supported(unsigned char ct) {
+    switch (ct) {
+    case 1:
+    case APPSRC_SESSION_AAC_ELD:
+        return (mode == RESTREAM_RTP);
+    case 4:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool stream_build(appsrc_session_t *session);
+
+bool restream_init(logger_t *render_logger, restream_mode_t restream_mode, const char *rtp_host,
+                   unsigned short rtp_port, const char *sdp_filename, const char *dir) {
+    const char *rtp_needed[] = { "appsrc", "h264parse", "rtph264pay", "rtpmp4gpay", "rtpL16pay", "audioconvert", "udpsink" };
+    const char *hls_needed[] = { "appsrc", "h264parse", "aacparse", "hlssink2", NULL, NULL, NULL };
+    const char **needed = (restream_mode == RESTREAM_RTP) ? rtp_needed : hls_needed;
+
+    logger = render_logger;
+    for (int i = 0; i < (int) (sizeof(rtp_needed) / sizeof(rtp_needed[0])) && needed[i]; i++) {
+        GstElementFactory *factory = gst_element_factory_find(needed[i]);
+        if (!factory) {
+            logger_log(logger, LOGGER_ERR, "re-streaming is disabled: GStreamer element \"%s\" was not found", needed[i]);
+            return false;
+        }
+        gst_object_unref(factory);
+    }
+    if (restream_mode == RESTREAM_HLS && g_mkdir_with_parents(dir, 0755)) {
+        logger_log(logger, LOGGER_ERR, "re-streaming is disabled: could not create directory %s", dir);
+        return false;
+    }
+    mode = restream_mode;
+    g_free(host);
+    g_free(sdp_file);
+    g_free(hls_dir);
+    host = g_strdup(rtp_host);
+    port = rtp_port;
+    sdp_file = g_strdup(sdp_filename);
+    hls_dir = g_strdup(dir);
+    if (!sessions) {
+        sessions = appsrc_sessions_init(logger, "re-streaming", QUEUE_BYTES, CLOSE_TIMEOUT_SECS, stream_build, NULL);
+    }
+    enabled = true;
+    if (mode == RESTREAM_RTP) {
+        logger_log(logger, LOGGER_INFO, "re-streaming as RTP to %s:%u; players can open %s", host, port, sdp_file);
+    } else {
+        logger_log(logger, LOGGER_INFO, "re-streaming as HLS to %s/uxplay.m3u8", hls_dir);
+    }
+    return true;
+}
+
+static GstElement *make_udpsink(unsigned short udp_port) {
+    GstElement *sink = gst_element_factory_make("udpsink", NULL);
+    /* sync: each packet is sent at its timestamp (plus the pipeline latency) */
+    g_object_set(sink, "host", host, "port", (gint) udp_port, "sync", TRUE, "async", FALSE, NULL);
+    return sink;
+}
+
+static void write_sdp(bool video, unsigned char ct) {
+    FILE *fp = fopen(sdp_file, "w");
+    if (!fp) {
+        logger_log(logger, LOGGER_ERR, "could not write %s", sdp_file);
+        return;
+    }
+    fprintf(fp, "v=0\r\no=- 0 0 IN IP4 %s\r\ns=UxPlay\r\nc=IN IP4 %s\r\nt=0 0\r\n", host, host);
+    if (video) {
+        fprintf(fp, "m=video %u RTP/AVP %d\r\na=rtpmap:%d H264/90000\r\na=fmtp:%d packetization-mode=1\r\n",
+                port, VIDEO_PT, VIDEO_PT, VIDEO_PT);
+    }
+    if (ct == 1) {
+        fprintf(fp, "m=audio %u RTP/AVP %d\r\na=rtpmap:%d L16/44100/2\r\n", port + 2, AUDIO_PT, AUDIO_PT);
+    } else if (ct) {
+        fprintf(fp, "m=audio %u RTP/AVP %d\r\na=rtpmap:%d mpeg4-generic/44100/2\r\n"
+                "a=fmtp:%d streamtype=5;profile-level-id=%d;mode=AAC-hbr;sizelength=13;indexlength=3;"
+                "indexdeltalength=3;config=%s\r\n", port + 2, AUDIO_PT, AUDIO_PT, AUDIO_PT,
+                (ct == APPSRC_SESSION_AAC_ELD) ? 44 : 1, (ct == APPSRC_SESSION_AAC_ELD) ? "f8e85000" : "1210");
+    }
+    fclose(fp);
+}
+
+static bool add_rtp_branches(appsrc_session_t *session) {
+    bool linked = true;
+    if (session->video_src) {
+        GstElement *parse = gst_element_factory_make("h264parse", NULL);
+        GstElement *pay = gst_element_factory_make("rtph264pay", NULL);
+        GstElement *sink = make_udpsink(port);
+        /* repeat SPS/PPS with each IDR frame, so players can join at any keyframe */
+        g_object_set(parse, "config-interval", -1, NULL);
+        g_object_set(pay, "config-interval", -1, "pt", VIDEO_PT, NULL);
+        gst_bin_add_many(GST_BIN(session->pipeline), parse, pay, sink, NULL);
+        linked = gst_element_link_many(session->video_src, parse, pay, sink, NULL);
+    }
+    if (session->audio_src && linked) {
+        GstElement *pay = gst_element_factory_make((session->audio_ct == 1) ? "rtpL16pay" : "rtpmp4gpay", NULL);
+        GstElement *sink = make_udpsink(port + 2);
+        g_object_set(pay, "pt", AUDIO_PT, NULL);
+        gst_bin_add_many(GST_BIN(session->pipeline), pay, sink, NULL);
+        if (session->audio_ct == 1) {
+            /* L16 is big-endian: this only swaps bytes */
+            GstElement *convert = gst_element_factory_make("audioconvert", NULL);
+            gst_bin_add(GST_BIN(session->pipeline), convert);
+            linked = gst_element_link_many(session->audio_src, convert, pay, sink, NULL);
+        } else {
+            linked = gst_element_link_many(session->audio_src, pay, sink, NULL);
+        }
+    }
+    gst_pipeline_set_latency(GST_PIPELINE(session->pipeline), RTP_LATENCY_MSECS * GST_MSECOND);
+    write_sdp(session->video_src != NULL, session->audio_ct);
+    return linked;
+}
+
+static bool add_hls_branches(appsrc_session_t *session) {
+    GstElement *sink = gst_element_factory_make("hlssink2", NULL);
+    gchar *segments = g_strdup_printf("%s/segment%%05d.ts", hls_dir);
+    gchar *playlist = g_strdup_printf("%s/uxplay.m3u8", hls_dir);
+    g_object_set(sink, "location", segments, "playlist-location", playlist, "target-duration", HLS_TARGET_SECS,
+                 "playlist-length", HLS_PLAYLIST_LENGTH, "max-files", HLS_MAX_FILES, NULL);
+    g_free(segments);
+    g_free(playlist);
+    gst_bin_add(GST_BIN(session->pipeline), sink);
+    bool linked = true;
+    if (session->video_src) {
+        GstElement *parse = gst_element_factory_make("h264parse", NULL);
+        g_object_set(parse, "config-interval", -1, NULL);
+        gst_bin_add(GST_BIN(session->pipeline), parse);
+        linked = gst_element_link(session->video_src, parse) && gst_element_link_pads(parse, "src", sink, "video");
+    }
+    if (session->audio_src && linked) {
+        /* raw AAC-LC to ADTS, for MPEG-TS */
+        GstElement *parse = gst_element_factory_make("aacparse", NULL);
+        gst_bin_add(GST_BIN(session->pipeline), parse);
+        linked = gst_element_link(session->audio_src, parse) && gst_element_link_pads(parse, "src", sink, "audio");
+    }
+    return linked;
+}
+
+/* for RTP, the players join the stream with the sdp file, which is rewritten for each stream */
+static bool stream_build(appsrc_session_t *session) {
+    return (mode == RESTREAM_RTP) ? add_rtp_branches(session) : add_hls_branches(session);
+}
+
+void restream_video_frame(const unsigned char *data, int data_len, uint64_t ntp_time_remote) {
+    if (!enabled || data_len < 5 || data[0]) {
+        return;
+    }
+    appsrc_sessions_video_frame(sessions, data, data_len, recorder_is_keyframe(data, data_len), ntp_time_remote);
+}
+
+void restream_audio_frame(const unsigned char *data, int data_len, unsigned char ct, uint64_t ntp_time_remote) {
+    if (!enabled || !data_len) {
+        return;
+    }
+    if (!audio_supported(ct)) {
+        g_mutex_lock(&mutex);
+        if (audio_unsupported != ct) {
+            audio_unsupported = ct;
+            logger_log(logger, LOGGER_INFO, "this audio format (ct=%d) cannot be re-streamed as %s", ct,
+                       (mode == RESTREAM_RTP) ? "RTP" : "HLS");
+        }
+        g_mutex_unlock(&mutex);
+        return;
+    }
+    appsrc_sessions_audio_frame(sessions, data, data_len, ct, ntp_time_remote);
+}
+
+void restream_stop() {
+    if (!enabled) {
+        return;
+    }
+    appsrc_sessions_stop(sessions);
+    g_mutex_lock(&mutex);
+    audio_unsupported = 0;
+    g_mutex_unlock(&mutex);
+}
+
+void restream_get_stats(restream_stats_t *copy) {
+    appsrc_session_stats_t stream_stats = { 0 };
+    if (sessions) {
+        appsrc_sessions_get_stats(sessions, &stream_stats);
+    }
+    copy->video_frames = stream_stats.video_frames;
+    copy->audio_frames = stream_stats.audio_frames;
+    copy->dropped_frames = stream_stats.dropped_frames;
+    copy->streaming = stream_stats.active;
+}
+
+void restream_destroy() {
+    if (!enabled) {
+        return;
+    }
+    restream_stop();
+    appsrc_sessions_finish(sessions);
+    enabled = false;
+    g_free(host);
+    g_free(sdp_file);
+    g_free(hls_dir);
+    host = sdp_file = hls_dir = NULL;
+    restream_stats_t copy;
+    restream_get_stats(&copy);
+    logger_log(logger, LOGGER_INFO, "re-streamed %llu video and %llu audio frames; %llu frames dropped",
+               (unsigned long long) copy.video_frames, (unsigned long long) copy.audio_frames,
+               (unsigned long long) copy.dropped_frames);
+}
@@ -0,0 +1,160 @@
+/**
+ * UxPlay - An open-source AirPlay mirroring server
+ * Copyright (C) 2026 UxPlay contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/*
+ * The video_renderer_* functions: each renderer is created by the backend selected with
+ * video_renderer_set_backend(), and is then driven through the functions of that backend.
+ */
+
+#include <ctype.h>
+#include <string.h>
+#include "video_renderer.h"
+
+static const video_renderer_funcs_t *backends[] = { &video_renderer_gstreamer_funcs, &video_renderer_null_funcs };
+static const video_renderer_funcs_t *backend = &video_renderer_gstreamer_funcs;
+
+/* the struct video_renderer_s of each backend starts with a pointer to its functions */
+#define FUNCS(renderer) (*(const video_renderer_funcs_t **) (renderer))
+
+bool video_renderer_set_backend(const char *name) {
+    for (int i = 0; i < (int) (sizeof(backends) / sizeof(backends[0])); i++) {
+        if (!strcmp(name, backends[i]->name)) {
+            backend = backends[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+video_renderer_t *video_renderer_init(logger_t *logger, const char *server_name, videoflip_t videoflip[2],
+                                      const char *parser, const char *decoder, const char *converter,
+                                      const char *videosink, const bool *fullscreen, const bool *video_sync,
+                                      const video_renderer_extras_t *extras) {
+    return backend->init(logger, server_name, videoflip, parser, decoder, converter, videosink, fullscreen,
+                         video_sync, extras);
+}
+
+bool video_renderer_add_branch(video_renderer_extras_t *extras, const char *name, const char *description,
+                               unsigned int max_buffers) {
+    if (extras->n_branches == VIDEO_RENDERER_MAX_BRANCHES || !*name || !*description || !max_buffers ||
+        !strcmp(name, "shm")) {
+        return false;
+    }
+    /* the name becomes part of an element name */
+    for (const char *c = name; *c; c++) {
+        if (!isalnum((unsigned char) *c) && *c != '_' && *c != '-') {
+            return false;
+        }
+    }
+    for (int i = 0; i < extras->n_branches; i++) {
+        if (!strcmp(extras->branches[i].name, name)) {
+            return false;
+        }
+    }
+    extras->branches[extras->n_branches].name = strdup(name);
+    extras->branches[extras->n_branches].description = strdup(description);
+    extras->branches[extras->n_branches].max_buffers = max_buffers;
+    extras->n_branches++;
+    return true;
+}
+
+void video_renderer_start(video_renderer_t *renderer) {
+    FUNCS(renderer)->start(renderer);
+}
+
+void video_renderer_stop(video_renderer_t *renderer) {
+    if (renderer) {
+        FUNCS(renderer)->stop(renderer);
+    }
+}
+
+void video_renderer_pause(video_renderer_t *renderer) {
+    FUNCS(renderer)->pause(renderer);
+}
+
+void video_renderer_resume(video_renderer_t *renderer) {
+    FUNCS(renderer)->resume(renderer);
+}
+
+bool video_renderer_is_paused(video_renderer_t *renderer) {
+    return FUNCS(renderer)->is_paused(renderer);
+}
+
+void video_renderer_render_buffer(video_renderer_t *renderer, unsigned char* data, int *data_len, int *nal_count,
+                                  uint64_t *ntp_time) {
+    FUNCS(renderer)->render_buffer(renderer, data, data_len, nal_count, ntp_time);
+}
+
+void video_renderer_prime(video_renderer_t *renderer, unsigned char *data, int data_len) {
+    FUNCS(renderer)->prime(renderer, data, data_len);
+}
+
+void video_renderer_flush(video_renderer_t *renderer) {
+    FUNCS(renderer)->flush(renderer);
+}
+
+void video_renderer_reset(video_renderer_t *renderer) {
+    if (renderer) {
+        FUNCS(renderer)->reset(renderer);
+    }
+}
+
+void video_renderer_start_first_frame_timer(video_renderer_t *renderer, int64_t start_time) {
+    if (renderer) {
+        FUNCS(renderer)->start_first_frame_timer(renderer, start_time);
+    }
+}
+
+bool video_renderer_get_first_frame_latency(video_renderer_t *renderer, uint64_t *latency) {
+    if (!renderer) {
+        *latency = 0;
+        return false;
+    }
+    return FUNCS(renderer)->get_first_frame_latency(renderer, latency);
+}
+
+bool video_renderer_get_queue_level(video_renderer_t *renderer, unsigned int *buffers, unsigned int *bytes,
+                                    uint64_t *time) {
+    if (!renderer) {
+        return false;
+    }
+    return FUNCS(renderer)->get_queue_level(renderer, buffers, bytes, time);
+}
+
+bool video_renderer_get_branch_stats(video_renderer_t *renderer, int index, const char **name, uint64_t *dropped) {
+    if (!renderer) {
+        return false;
+    }
+    return FUNCS(renderer)->get_branch_stats(renderer, index, name, dropped);
+}
+
+unsigned int video_renderer_listen(video_renderer_t *renderer, void *loop) {
+    return FUNCS(renderer)->listen(renderer, loop);
+}
+
+void video_renderer_destroy(video_renderer_t *renderer) {
+    if (renderer) {
+        FUNCS(renderer)->destroy(renderer);
+    }
+}
+
+void video_renderer_size(video_renderer_t *renderer, float *width_source, float *height_source, float *width,
+                         float *height) {
+    FUNCS(renderer)->size(renderer, width_source, height_source, width, height);
+}
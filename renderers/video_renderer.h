@@ -21,7 +21,7 @@
  */
 
 /* 
- * H264 renderer using gstreamer
+ * H264 renderer, using gstreamer (or a null backend)
 */
 
 #ifndef VIDEO_RENDERER_H
@@ -35,6 +35,8 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 #include "../lib/logger.h"
+#include "../lib/latency_trace.h"
+#include "../lib/shm_export.h"
 
 typedef enum videoflip_e {
     NONE,
@@ -45,21 +47,96 @@ typedef enum videoflip_e {
     HFLIP,
 } videoflip_t;
 
+/* a renderer instance: each receiver hosted by the process has its own (with its own pipeline, clock *
+ * base time and window); the latency trace, branches and shm export belong to the primary one.       */
 typedef struct video_renderer_s video_renderer_t;
 
-void video_renderer_init (logger_t *logger, const char *server_name, videoflip_t videoflip[2], const char *parser,
-                          const char *decoder, const char *converter, const char *videosink, const bool *fullscreen,
-                          const bool *video_sync);
-void video_renderer_start ();
-void video_renderer_stop ();
-void video_renderer_pause ();
-void video_renderer_resume ();
-bool video_renderer_is_paused();
-void video_renderer_render_buffer (unsigned char* data, int *data_len, int *nal_count, uint64_t *ntp_time);
-void video_renderer_flush ();
-unsigned int video_renderer_listen(void *loop);
-void video_renderer_destroy ();
-void video_renderer_size(float *width_source, float *height_source, float *width, float *height);
+/* extra outputs of the decoded video (a preview window, a shared-memory consumer, ...), fed by a tee *
+ * after the decoder, so decoding is only done once: "description" is a gst-launch fragment such as  *
+ * "videoconvert ! fakesink".  Each branch has its own leaky queue of at most max_buffers frames: a  *
+ * slow branch drops (and counts) frames, and never holds up the main videosink.                    */
+#define VIDEO_RENDERER_MAX_BRANCHES 4
+typedef struct video_renderer_branch_s {
+    char *name;
+    char *description;
+    unsigned int max_buffers;
+} video_renderer_branch_t;
+
+/* what the primary renderer has besides its pipeline; it is copied by video_renderer_init */
+typedef struct video_renderer_extras_s {
+    latency_trace_t *trace;
+    shm_export_t *shm_export;         /* publish decoded frames (as BGRx) to shared memory, through a branch "shm" */
+    int n_branches;
+    video_renderer_branch_t branches[VIDEO_RENDERER_MAX_BRANCHES];
+} video_renderer_extras_t;
+
+/* a renderer backend (see video_renderer.c): the struct video_renderer_s of each backend starts with *
+ * a pointer to its functions, which the video_renderer_* functions below call                       */
+typedef struct video_renderer_funcs_s {
+    const char *name;
+    video_renderer_t *(*init)(logger_t *logger, const char *server_name, videoflip_t videoflip[2],
+                              const char *parser, const char *decoder, const char *converter,
+                              const char *videosink, const bool *fullscreen, const bool *video_sync,
+                              const video_renderer_extras_t *extras);
+    void (*start)(video_renderer_t *renderer);
+    void (*stop)(video_renderer_t *renderer);
+    void (*pause)(video_renderer_t *renderer);
+    void (*resume)(video_renderer_t *renderer);
+    bool (*is_paused)(video_renderer_t *renderer);
+    void (*render_buffer)(video_renderer_t *renderer, unsigned char *data, int *data_len, int *nal_count,
+                          uint64_t *ntp_time);
+    void (*prime)(video_renderer_t *renderer, unsigned char *data, int data_len);
+    void (*flush)(video_renderer_t *renderer);
+    void (*reset)(video_renderer_t *renderer);
+    void (*start_first_frame_timer)(video_renderer_t *renderer, int64_t start_time);
+    bool (*get_first_frame_latency)(video_renderer_t *renderer, uint64_t *latency);
+    bool (*get_queue_level)(video_renderer_t *renderer, unsigned int *buffers, unsigned int *bytes, uint64_t *time);
+    bool (*get_branch_stats)(video_renderer_t *renderer, int index, const char **name, uint64_t *dropped);
+    unsigned int (*listen)(video_renderer_t *renderer, void *loop);
+    void (*destroy)(video_renderer_t *renderer);
+    void (*size)(video_renderer_t *renderer, float *width_source, float *height_source, float *width, float *height);
+} video_renderer_funcs_t;
+
+extern const video_renderer_funcs_t video_renderer_gstreamer_funcs;
+/* uses no GStreamer and no display: checks the framing of each access unit, records its timing, *
+ * and drops it, so the receiver itself (lib/) can be benchmarked and load-tested               */
+extern const video_renderer_funcs_t video_renderer_null_funcs;
+
+/* "gstreamer" (the default) or "null"; call before video_renderer_init; false if unknown */
+bool video_renderer_set_backend(const char *name);
+
+/* returns false if name is invalid or already used ("shm" is reserved), or there are too many branches */
+bool video_renderer_add_branch(video_renderer_extras_t *extras, const char *name, const char *description,
+                               unsigned int max_buffers);
+/* index 0, 1, ... of the branches of renderer (including "shm"); false if there is no such branch */
+bool video_renderer_get_branch_stats(video_renderer_t *renderer, int index, const char **name, uint64_t *dropped);
+/* extras (NULL for all but the renderer of the main receiver, of which there is at most one at a time): *
+ * the primary renderer also gets X11 fullscreen handling and sets the application name                 */
+video_renderer_t *video_renderer_init (logger_t *logger, const char *server_name, videoflip_t videoflip[2],
+                                       const char *parser, const char *decoder, const char *converter,
+                                       const char *videosink, const bool *fullscreen, const bool *video_sync,
+                                       const video_renderer_extras_t *extras);
+void video_renderer_start (video_renderer_t *renderer);
+void video_renderer_stop (video_renderer_t *renderer);
+void video_renderer_pause (video_renderer_t *renderer);
+void video_renderer_resume (video_renderer_t *renderer);
+bool video_renderer_is_paused(video_renderer_t *renderer);
+void video_renderer_render_buffer (video_renderer_t *renderer, unsigned char* data, int *data_len, int *nal_count,
+                                   uint64_t *ntp_time);
+void video_renderer_prime (video_renderer_t *renderer, unsigned char *data, int data_len);
+void video_renderer_flush (video_renderer_t *renderer);
+void video_renderer_reset (video_renderer_t *renderer);
+/* start_time: g_get_monotonic_time() when the client session started (or the renderer was replaced); *
+ * the time from then until the next video buffer reaches the videosink is the first-frame latency     */
+void video_renderer_start_first_frame_timer(video_renderer_t *renderer, int64_t start_time);
+bool video_renderer_get_first_frame_latency(video_renderer_t *renderer, uint64_t *latency);
+bool video_renderer_get_queue_level(video_renderer_t *renderer, unsigned int *buffers, unsigned int *bytes,
+                                    uint64_t *time);
+/* watch the pipeline bus from the default main context; on a pipeline error, loop is quit (if not NULL) */
+unsigned int video_renderer_listen(video_renderer_t *renderer, void *loop);
+void video_renderer_destroy (video_renderer_t *renderer);
+void video_renderer_size(video_renderer_t *renderer, float *width_source, float *height_source, float *width,
+                         float *height);
   
   /* not implemented for gstreamer */
 void video_renderer_update_background (int type); 
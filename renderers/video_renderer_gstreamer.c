@@ -23,30 +23,50 @@
 #include "video_renderer.h"
 #include <gst/gst.h>
 #include <gst/app/gstappsrc.h>
+#include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
+#include "../lib/thread_policy.h"
 
 #define SECOND_IN_NSECS 1000000000UL
 #ifdef X_DISPLAY_FIX
 #include <gst/video/navigation.h>
 #include "x_display_fix.h"
-static bool fullscreen = false;
-static bool alt_keypress = false;
 #define MAX_X11_SEARCH_ATTEMPTS 5   /*should be less than 256 */
-static unsigned char X11_search_attempts; 
 #endif
 
-static video_renderer_t *renderer = NULL;
-static GstClockTime gst_video_pipeline_base_time = GST_CLOCK_TIME_NONE;
 static logger_t *logger = NULL;
-static unsigned short width, height, width_source, height_source;  /* not currently used */
-static bool first_packet = false;
-static bool sync = false;
+
+typedef struct video_branch_s {
+    char *name;
+    char *description;
+    unsigned int max_buffers;
+    uint64_t dropped;                          /* updated atomically */
+} video_branch_t;
 
 struct video_renderer_s {
-    GstElement *appsrc, *pipeline, *sink;
+    const video_renderer_funcs_t *funcs;      /* must be first (see video_renderer.c) */
+    GstElement *appsrc, *pipeline, *sink, *queue;
     GstBus *bus;
+    GMainLoop *loop;                   /* quit on a pipeline error; if NULL, the pipeline is only stopped */
+    bool primary;
+    latency_trace_t *trace;                   /* primary renderer only, as are the branches */
+    video_branch_t branches[VIDEO_RENDERER_MAX_BRANCHES + 1];   /* + the shm export branch */
+    int n_branches;
+    shm_export_t *shm_export;
+    bool sync;
+    GstClockTime base_time;
+    bool first_packet;
+    bool pipeline_reused;
+    gint64 session_start_time;          /* g_get_monotonic_time() */
+    uint64_t first_frame_latency;
+    bool first_frame_pending;           /* the first-frame probe is waiting for a buffer */
+    unsigned short width, height, width_source, height_source;  /* not currently used */
 #ifdef  X_DISPLAY_FIX
     const char * server_name;  
     X11_Window_t * gst_window;
+    bool fullscreen;
+    bool alt_keypress;
+    unsigned char X11_search_attempts;
 #endif
 };
 
@@ -117,19 +137,147 @@ static void append_videoflip (GString *launch, const videoflip_t *flip, const vi
  * closest used by  GStreamer < 1.20.4 is BT709, 2:3:5:1 with    *                            *
  * range = 2 -> GST_VIDEO_COLOR_RANGE_16_235 ("limited RGB")     */  
 
+static void add_branch(video_renderer_t *renderer, const char *name, const char *description,
+                       unsigned int max_buffers) {
+    video_branch_t *branch = &renderer->branches[renderer->n_branches++];
+    branch->name = g_strdup(name);
+    branch->description = g_strdup(description);
+    branch->max_buffers = max_buffers;
+}
+
+/* the renderer gets its own copy of the branches (and their drop counts) */
+static void set_extras(video_renderer_t *renderer, const video_renderer_extras_t *extras) {
+    renderer->trace = extras->trace;
+    for (int i = 0; i < extras->n_branches; i++) {
+        add_branch(renderer, extras->branches[i].name, extras->branches[i].description,
+                   extras->branches[i].max_buffers);
+    }
+    if (extras->shm_export) {
+        /* BGRx is easy for readers, and videoconvert makes it cheaply from the decoders' I420 or NV12 */
+        add_branch(renderer, "shm", "videoconvert ! video/x-raw,format=BGRx ! "
+                   "appsink name=video_shm_sink sync=false max-buffers=1 drop=true", 1);
+        renderer->shm_export = extras->shm_export;
+    }
+}
+
+/* runs in the streaming thread of the shm branch, never in the thread of the main videosink */
+static GstFlowReturn shm_new_sample(GstAppSink *appsink, gpointer user_data) {
+    video_renderer_t *renderer = (video_renderer_t *) user_data;
+    GstSample *sample = gst_app_sink_pull_sample(appsink);
+    GstVideoInfo info;
+    GstVideoFrame frame;
+    if (!sample) {
+        return GST_FLOW_EOS;
+    }
+    GstBuffer *buffer = gst_sample_get_buffer(sample);
+    if (buffer && gst_video_info_from_caps(&info, gst_sample_get_caps(sample)) &&
+        gst_video_frame_map(&frame, &info, buffer, GST_MAP_READ)) {
+        /* with sync, pts + base time is the (realtime clock) time at which the frame is shown */
+        uint64_t timestamp = (renderer->sync && GST_BUFFER_PTS_IS_VALID(buffer)) ?
+            (uint64_t) GST_BUFFER_PTS(buffer) + renderer->base_time : (uint64_t) g_get_real_time() * 1000;
+        if (shm_export_write(renderer->shm_export, (const uint8_t *) GST_VIDEO_FRAME_PLANE_DATA(&frame, 0),
+                             GST_VIDEO_FRAME_WIDTH(&frame), GST_VIDEO_FRAME_HEIGHT(&frame),
+                             GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 0), SHM_EXPORT_FORMAT_BGRX, timestamp) < 0) {
+            logger_log(logger, LOGGER_ERR, "could not write a %dx%d video frame to shared memory",
+                       GST_VIDEO_FRAME_WIDTH(&frame), GST_VIDEO_FRAME_HEIGHT(&frame));
+        }
+        gst_video_frame_unmap(&frame);
+    }
+    gst_sample_unref(sample);
+    return GST_FLOW_OK;
+}
+
+static bool video_renderer_gstreamer_get_branch_stats(video_renderer_t *renderer, int index, const char **name,
+                                                      uint64_t *dropped) {
+    if (index < 0 || index >= renderer->n_branches) {
+        return false;
+    }
+    *name = renderer->branches[index].name;
+    *dropped = __atomic_load_n(&renderer->branches[index].dropped, __ATOMIC_RELAXED);
+    return true;
+}
+
+/* a leaky queue emits "overrun" each time it is full when a frame arrives, and then drops a frame */
+static void branch_overrun(GstElement *queue, gpointer user_data) {
+    video_branch_t *branch = (video_branch_t *) user_data;
+    __atomic_fetch_add(&branch->dropped, 1, __ATOMIC_RELAXED);
+}
+
+/* buffers keep the pts given by video_renderer_render_buffer(if sync); with sync, the *
+ * render time is when the buffer is due at the sink, not when it arrives there.        */
+static void trace_buffer(video_renderer_t *renderer, GstBuffer *buffer, latency_trace_stage_t stage) {
+    uint64_t id = LATENCY_TRACE_NEXT;
+    uint64_t now = latency_trace_now();
+    if (renderer->sync && GST_BUFFER_PTS_IS_VALID(buffer)) {
+        id = (uint64_t) GST_BUFFER_PTS(buffer) + renderer->base_time;
+        if (stage == LATENCY_TRACE_RENDER && id > now) {
+            now = id;
+        }
+    }
+    latency_trace_stage(renderer->trace, LATENCY_TRACE_VIDEO, id, stage, now);
+}
+
+static GstPadProbeReturn trace_decode_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    trace_buffer((video_renderer_t *) user_data, GST_PAD_PROBE_INFO_BUFFER(info), LATENCY_TRACE_DECODE);
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn trace_render_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    trace_buffer((video_renderer_t *) user_data, GST_PAD_PROBE_INFO_BUFFER(info), LATENCY_TRACE_RENDER);
+    return GST_PAD_PROBE_OK;
+}
+
+static void add_trace_probe(video_renderer_t *renderer, GstElement *element, GstPadProbeCallback probe) {
+    GstPad *pad = gst_element_get_static_pad(element, "sink");
+    g_assert(pad);
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, probe, renderer, NULL);
+    gst_object_unref(pad);
+}
+
+/* a streaming thread posts STREAM_STATUS "enter" (synchronously, from that thread) when it starts */
+static GstBusSyncReply thread_policy_sync_handler(GstBus *bus, GstMessage *message, gpointer user_data) {
+    if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_STREAM_STATUS) {
+        GstStreamStatusType type;
+        gst_message_parse_stream_status(message, &type, NULL);
+        if (type == GST_STREAM_STATUS_TYPE_ENTER) {
+            thread_policy_apply((thread_role_t) GPOINTER_TO_INT(user_data), logger);
+        }
+    }
+    return GST_BUS_PASS;
+}
+
+/* one-shot probe on the videosink: time from the start of a session to the arrival of its first frame at the sink */
+static GstPadProbeReturn first_frame_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    video_renderer_t *renderer = (video_renderer_t *) user_data;
+    gint64 start_time = __atomic_load_n(&renderer->session_start_time, __ATOMIC_RELAXED);
+    uint64_t latency = (uint64_t) (g_get_monotonic_time() - start_time) * 1000;
+    __atomic_store_n(&renderer->first_frame_latency, latency, __ATOMIC_RELAXED);
+    __atomic_store_n(&renderer->first_frame_pending, false, __ATOMIC_RELEASE);
+    logger_log(logger, LOGGER_INFO, "first video frame reached the videosink %.1f ms after the session started "
+               "(%s pipeline)", (double) latency / 1000000.0, renderer->pipeline_reused ? "reused" : "new");
+    return GST_PAD_PROBE_REMOVE;
+}
+
 static const char h264_caps[]="video/x-h264,stream-format=(string)byte-stream,alignment=(string)au";
 
-void video_renderer_size(float *f_width_source, float *f_height_source, float *f_width, float *f_height) {
-    width_source = (unsigned short) *f_width_source;
-    height_source = (unsigned short) *f_height_source;
-    width = (unsigned short) *f_width;
-    height = (unsigned short) *f_height;
-    logger_log(logger, LOGGER_DEBUG, "begin video stream wxh = %dx%d; source %dx%d", width, height, width_source, height_source);
+static void video_renderer_gstreamer_size(video_renderer_t *renderer, float *f_width_source, float *f_height_source,
+                                          float *f_width, float *f_height) {
+    renderer->width_source = (unsigned short) *f_width_source;
+    renderer->height_source = (unsigned short) *f_height_source;
+    renderer->width = (unsigned short) *f_width;
+    renderer->height = (unsigned short) *f_height;
+    logger_log(logger, LOGGER_DEBUG, "begin video stream wxh = %dx%d; source %dx%d", renderer->width, renderer->height,
+               renderer->width_source, renderer->height_source);
 }
 
-void  video_renderer_init(logger_t *render_logger, const char *server_name, videoflip_t videoflip[2], const char *parser,
-                          const char *decoder, const char *converter, const char *videosink, const bool *initial_fullscreen,
-                          const bool *video_sync) {
+static video_renderer_t *video_renderer_gstreamer_init(logger_t *render_logger, const char *server_name,
+                                                       videoflip_t videoflip[2], const char *parser,
+                                                       const char *decoder, const char *converter,
+                                                       const char *videosink, const bool *initial_fullscreen,
+                                                       const bool *video_sync,
+                                                       const video_renderer_extras_t *extras) {
+    video_renderer_t *renderer;
+    bool primary = (extras != NULL);
     GError *error = NULL;
     GstCaps *caps = NULL;
     GstClock *clock = gst_system_clock_obtain();
@@ -139,20 +287,39 @@ void  video_renderer_init(logger_t *render_logger, const char *server_name, vide
 
     /* this call to g_set_application_name makes server_name appear in the  X11 display window title bar, */
     /* (instead of the program name uxplay taken from (argv[0]). It is only set one time. */
+    /* (the name is process-wide, so windows of other receivers get the main receiver's title) */
 
-    const gchar *appname = g_get_application_name();
-    if (!appname || strcmp(appname,server_name))  g_set_application_name(server_name);
-    appname = NULL;
+    if (primary) {
+        const gchar *appname = g_get_application_name();
+        if (!appname || strcmp(appname,server_name))  g_set_application_name(server_name);
+        appname = NULL;
+    }
 
     renderer = calloc(1, sizeof(video_renderer_t));
     g_assert(renderer);
+    renderer->funcs = &video_renderer_gstreamer_funcs;
+    renderer->primary = primary;
+    renderer->base_time = GST_CLOCK_TIME_NONE;
+    if (primary) {
+        set_extras(renderer, extras);
+    }
+    bool use_trace = (renderer->trace != NULL);
+    int use_branches = renderer->n_branches;
 
     GString *launch = g_string_new("appsrc name=video_source ! ");
-    g_string_append(launch, "queue ! ");
+    g_string_append(launch, "queue name=video_queue ! ");
     g_string_append(launch, parser);
     g_string_append(launch, " ! ");
     g_string_append(launch, decoder);
     g_string_append(launch, " ! ");
+    if (use_trace) {
+        g_string_append(launch, "identity name=video_decoded silent=true ! ");
+    }
+    if (use_branches) {
+        /* every branch needs its own queue, the main one too: without it, its sink blocks the tee *
+         * while it prerolls, the other sinks never get a frame, and the pipeline never plays     */
+        g_string_append(launch, "tee name=video_tee allow-not-linked=true ! queue ! ");
+    }
     append_videoflip(launch, &videoflip[0], &videoflip[1]);
     g_string_append(launch, converter);
     g_string_append(launch, " ! ");
@@ -161,10 +328,15 @@ void  video_renderer_init(logger_t *render_logger, const char *server_name, vide
     g_string_append(launch, " name=video_sink");
     if (*video_sync) {
         g_string_append(launch, " sync=true");
-        sync = true;
+        renderer->sync = true;
     } else {
         g_string_append(launch, " sync=false");
-        sync = false;
+        renderer->sync = false;
+    }
+    for (int i = 0; i < use_branches; i++) {
+        g_string_append_printf(launch, " video_tee. ! queue name=video_branch_%s leaky=downstream max-size-buffers=%u"
+                               " max-size-bytes=0 max-size-time=0 ! %s", renderer->branches[i].name,
+                               renderer->branches[i].max_buffers, renderer->branches[i].description);
     }
     logger_log(logger, LOGGER_DEBUG, "GStreamer video pipeline will be:\n\"%s\"", launch->str);
     renderer->pipeline = gst_parse_launch(launch->str, &error);
@@ -174,6 +346,11 @@ void  video_renderer_init(logger_t *render_logger, const char *server_name, vide
     }
     g_assert (renderer->pipeline);
     gst_pipeline_use_clock(GST_PIPELINE_CAST(renderer->pipeline), clock);
+    if (thread_policy_is_set(THREAD_ROLE_GST_VIDEO)) {
+        GstBus *bus = gst_element_get_bus(renderer->pipeline);
+        gst_bus_set_sync_handler(bus, thread_policy_sync_handler, GINT_TO_POINTER(THREAD_ROLE_GST_VIDEO), NULL);
+        gst_object_unref(bus);
+    }
 
     renderer->appsrc = gst_bin_get_by_name (GST_BIN (renderer->pipeline), "video_source");
     g_assert(renderer->appsrc);
@@ -186,17 +363,45 @@ void  video_renderer_init(logger_t *render_logger, const char *server_name, vide
     renderer->sink = gst_bin_get_by_name (GST_BIN (renderer->pipeline), "video_sink");
     g_assert(renderer->sink);
 
+    renderer->queue = gst_bin_get_by_name (GST_BIN (renderer->pipeline), "video_queue");
+    g_assert(renderer->queue);
+
+    for (int i = 0; i < use_branches; i++) {
+        gchar *queue_name = g_strdup_printf("video_branch_%s", renderer->branches[i].name);
+        GstElement *queue = gst_bin_get_by_name (GST_BIN (renderer->pipeline), queue_name);
+        g_assert(queue);
+        g_signal_connect(queue, "overrun", G_CALLBACK(branch_overrun), &renderer->branches[i]);
+        gst_object_unref(queue);
+        g_free(queue_name);
+    }
+    if (renderer->shm_export) {
+        GstAppSinkCallbacks callbacks = { NULL, NULL, shm_new_sample };
+        GstElement *appsink = gst_bin_get_by_name (GST_BIN (renderer->pipeline), "video_shm_sink");
+        g_assert(appsink);
+        gst_app_sink_set_callbacks(GST_APP_SINK(appsink), &callbacks, renderer, NULL);
+        gst_object_unref(appsink);
+    }
+
+    if (use_trace) {
+        GstElement *decoded = gst_bin_get_by_name (GST_BIN (renderer->pipeline), "video_decoded");
+        g_assert(decoded);
+        add_trace_probe(renderer, decoded, trace_decode_probe);
+        add_trace_probe(renderer, renderer->sink, trace_render_probe);
+        gst_object_unref(decoded);
+    }
+
 #ifdef X_DISPLAY_FIX
-    fullscreen = *initial_fullscreen;
+    renderer->fullscreen = *initial_fullscreen;
     renderer->server_name = server_name;
     renderer->gst_window = NULL;
     bool x_display_fix = false;
     /* only include X11 videosinks that provide fullscreen mode, or need ZOOMFIX */
     /* limit searching for X11 Windows in case autovideosink selects an incompatible videosink */
-    if (strncmp(videosink,"autovideosink", strlen("autovideosink")) == 0 ||
+    /* (the window is found by its title, which only the main receiver's window has) */
+    if (primary && (strncmp(videosink,"autovideosink", strlen("autovideosink")) == 0 ||
         strncmp(videosink,"ximagesink", strlen("ximagesink")) ==  0 ||
 	strncmp(videosink,"xvimagesink", strlen("xvimagesink")) == 0 ||
-	strncmp(videosink,"fpsdisplaysink", strlen("fpsdisplaysink")) == 0 ) {
+	strncmp(videosink,"fpsdisplaysink", strlen("fpsdisplaysink")) == 0 )) {
         x_display_fix = true;
     }
     if (x_display_fix) {
@@ -220,47 +425,51 @@ void  video_renderer_init(logger_t *render_logger, const char *server_name, vide
     } else {
         logger_log(logger, LOGGER_ERR, "Failed to initialize GStreamer video renderer");
     }
+    return renderer;
+}
+
+static bool video_renderer_gstreamer_is_paused(video_renderer_t *renderer) {
+    GstState state;
+    gst_element_get_state(renderer->pipeline, &state, NULL, 0);
+    return (state == GST_STATE_PAUSED);
 }
 
-void video_renderer_pause() {
+static void video_renderer_gstreamer_pause(video_renderer_t *renderer) {
     logger_log(logger, LOGGER_DEBUG, "video renderer paused");
     gst_element_set_state(renderer->pipeline, GST_STATE_PAUSED);
 }
 
-void video_renderer_resume() {
-    if (video_renderer_is_paused()) {
+static void video_renderer_gstreamer_resume(video_renderer_t *renderer) {
+    if (video_renderer_gstreamer_is_paused(renderer)) {
         logger_log(logger, LOGGER_DEBUG, "video renderer resumed");
         gst_element_set_state (renderer->pipeline, GST_STATE_PLAYING);
-        gst_video_pipeline_base_time = gst_element_get_base_time(renderer->appsrc);
+        renderer->base_time = gst_element_get_base_time(renderer->appsrc);
     }
 }
 
-bool video_renderer_is_paused() {
-    GstState state;
-    gst_element_get_state(renderer->pipeline, &state, NULL, 0);
-    return (state == GST_STATE_PAUSED);
-}
-
-void video_renderer_start() {
+static void video_renderer_gstreamer_start(video_renderer_t *renderer) {
     gst_element_set_state (renderer->pipeline, GST_STATE_PLAYING);
-    gst_video_pipeline_base_time = gst_element_get_base_time(renderer->appsrc);
-    renderer->bus = gst_element_get_bus(renderer->pipeline);
-    first_packet = true;
+    renderer->base_time = gst_element_get_base_time(renderer->appsrc);
+    if (!renderer->bus) {
+        renderer->bus = gst_element_get_bus(renderer->pipeline);
+    }
+    renderer->first_packet = true;
 #ifdef X_DISPLAY_FIX
-    X11_search_attempts = 0;
+    renderer->X11_search_attempts = 0;
 #endif
 }
 
-void video_renderer_render_buffer(unsigned char* data, int *data_len, int *nal_count, uint64_t *ntp_time) {
+static void video_renderer_gstreamer_render_buffer(video_renderer_t *renderer, unsigned char* data, int *data_len,
+                                                   int *nal_count, uint64_t *ntp_time) {
     GstBuffer *buffer;
     GstClockTime pts = (GstClockTime) *ntp_time; /*now in nsecs */
     //GstClockTimeDiff latency = GST_CLOCK_DIFF(gst_element_get_current_clock_time (renderer->appsrc), pts);
-    if (sync) {
-        if (pts >= gst_video_pipeline_base_time) {
-            pts -= gst_video_pipeline_base_time;
+    if (renderer->sync) {
+        if (pts >= renderer->base_time) {
+            pts -= renderer->base_time;
         } else {
             logger_log(logger, LOGGER_ERR, "*** invalid ntp_time < gst_video_pipeline_base_time\n%8.6f ntp_time\n%8.6f base_time",
-                       ((double) *ntp_time) / SECOND_IN_NSECS, ((double) gst_video_pipeline_base_time) / SECOND_IN_NSECS);
+                       ((double) *ntp_time) / SECOND_IN_NSECS, ((double) renderer->base_time) / SECOND_IN_NSECS);
             return;
         }
     }
@@ -272,29 +481,33 @@ void video_renderer_render_buffer(unsigned char* data, int *data_len, int *nal_c
     if (data[0]) {
         logger_log(logger, LOGGER_ERR, "*** ERROR decryption of video packet failed ");
     } else {
-        if (first_packet) {
+        if (renderer->first_packet) {
             logger_log(logger, LOGGER_INFO, "Begin streaming to GStreamer video pipeline");
-            first_packet = false;
+            renderer->first_packet = false;
         }
         buffer = gst_buffer_new_allocate(NULL, *data_len, NULL);
         g_assert(buffer != NULL);
         //g_print("video latency %8.6f\n", (double) latency / SECOND_IN_NSECS);
-        if (sync) {
+        if (renderer->sync) {
             GST_BUFFER_PTS(buffer) = pts;
         }
         gst_buffer_fill(buffer, 0, data, *data_len);
+        if (renderer->trace) {
+            latency_trace_stage(renderer->trace, LATENCY_TRACE_VIDEO, *ntp_time, LATENCY_TRACE_PUSH, latency_trace_now());
+        }
         gst_app_src_push_buffer (GST_APP_SRC(renderer->appsrc), buffer);
 #ifdef X_DISPLAY_FIX
-        if (renderer->gst_window && !(renderer->gst_window->window) && X11_search_attempts < MAX_X11_SEARCH_ATTEMPTS) {
-            X11_search_attempts++;
-            logger_log(logger, LOGGER_DEBUG, "Looking for X11 UxPlay Window, attempt %d", (int) X11_search_attempts);
+        if (renderer->gst_window && !(renderer->gst_window->window) &&
+            renderer->X11_search_attempts < MAX_X11_SEARCH_ATTEMPTS) {
+            renderer->X11_search_attempts++;
+            logger_log(logger, LOGGER_DEBUG, "Looking for X11 UxPlay Window, attempt %d", (int) renderer->X11_search_attempts);
             get_x_window(renderer->gst_window, renderer->server_name);
 	    if (renderer->gst_window->window) {
                 logger_log(logger, LOGGER_INFO, "\n*** X11 Windows: Use key F11 or (left Alt)+Enter to toggle full-screen mode\n");
-                if (fullscreen) {
-                    set_fullscreen(renderer->gst_window, &fullscreen);
+                if (renderer->fullscreen) {
+                    set_fullscreen(renderer->gst_window, &renderer->fullscreen);
                 }
-            } else if (X11_search_attempts == MAX_X11_SEARCH_ATTEMPTS) {
+            } else if (renderer->X11_search_attempts == MAX_X11_SEARCH_ATTEMPTS) {
 	      logger_log(logger, LOGGER_DEBUG, "X11 UxPlay Window not found in %d search attempts", MAX_X11_SEARCH_ATTEMPTS);
             }
         }
@@ -302,17 +515,78 @@ void video_renderer_render_buffer(unsigned char* data, int *data_len, int *nal_c
     }
 }
 
-void video_renderer_flush() {
+/* show a cached keyframe (SPS+PPS+IDR access unit) immediately, e.g., after the pipeline was relaunched */
+static void video_renderer_gstreamer_prime(video_renderer_t *renderer, unsigned char *data, int data_len) {
+    GstBuffer *buffer;
+    g_assert(renderer);
+    buffer = gst_buffer_new_allocate(NULL, data_len, NULL);
+    g_assert(buffer != NULL);
+    gst_buffer_fill(buffer, 0, data, data_len);
+    if (renderer->sync) {
+        GstClock *clock = gst_system_clock_obtain();
+        GstClockTime now = gst_clock_get_time(clock);
+        gst_object_unref(clock);
+        if (now >= renderer->base_time) {
+            GST_BUFFER_PTS(buffer) = now - renderer->base_time;
+        }
+    }
+    logger_log(logger, LOGGER_DEBUG, "priming GStreamer video pipeline with cached keyframe (%d bytes)", data_len);
+    gst_app_src_push_buffer (GST_APP_SRC(renderer->appsrc), buffer);
+}
+
+static void video_renderer_gstreamer_flush(video_renderer_t *renderer) {
+}
+
+/* Prepare the pipeline for a new client session without rebuilding it: going to READY drops all *
+ * queued data and resets the parser and decoder, but keeps the elements (and the video window),   *
+ * so there is no new plugin lookup, decoder instantiation or X11 window search. Restart the       *
+ * pipeline with video_renderer_start().                                                           */
+static void video_renderer_gstreamer_reset(video_renderer_t *renderer) {
+    if (renderer) {
+        gst_element_set_state (renderer->pipeline, GST_STATE_READY);
+        gst_element_get_state (renderer->pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+        renderer->pipeline_reused = true;
+        logger_log(logger, LOGGER_DEBUG, "GStreamer video pipeline reset for reuse");
+    }
+}
+
+static void video_renderer_gstreamer_start_first_frame_timer(video_renderer_t *renderer, int64_t start_time) {
+    __atomic_store_n(&renderer->session_start_time, start_time, __ATOMIC_RELAXED);
+    /* (a probe left from a previous session that showed no frame is still waiting) */
+    if (!__atomic_exchange_n(&renderer->first_frame_pending, true, __ATOMIC_ACQ_REL)) {
+        GstPad *pad = gst_element_get_static_pad(renderer->sink, "sink");
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, first_frame_probe, renderer, NULL);
+        gst_object_unref(pad);
+    }
+}
+
+/* time taken by the first video frame of the most recent session to reach the videosink */
+static bool video_renderer_gstreamer_get_first_frame_latency(video_renderer_t *renderer, uint64_t *latency) {
+    *latency = renderer ? __atomic_load_n(&renderer->first_frame_latency, __ATOMIC_RELAXED) : 0;
+    return (*latency != 0);
 }
 
-void video_renderer_stop() {
+/* current fill level of the queue between appsrc and the parser (time in nsecs) */
+static bool video_renderer_gstreamer_get_queue_level(video_renderer_t *renderer, unsigned int *buffers,
+                                                     unsigned int *bytes, uint64_t *time) {
+    guint64 level_time = 0;
+    if (!renderer) {
+        return false;
+    }
+    g_object_get(renderer->queue, "current-level-buffers", buffers, "current-level-bytes", bytes,
+                 "current-level-time", &level_time, NULL);
+    *time = (uint64_t) level_time;
+    return true;
+}
+
+static void video_renderer_gstreamer_stop(video_renderer_t *renderer) {
   if (renderer) {
             gst_app_src_end_of_stream (GST_APP_SRC(renderer->appsrc));
 	    gst_element_set_state (renderer->pipeline, GST_STATE_NULL);
   }   
 }
 
-void video_renderer_destroy() {
+static void video_renderer_gstreamer_destroy(video_renderer_t *renderer) {
     if (renderer) {
         GstState state;
         gst_element_get_state(renderer->pipeline, &state, NULL, 0);
@@ -320,8 +594,11 @@ void video_renderer_destroy() {
             gst_app_src_end_of_stream (GST_APP_SRC(renderer->appsrc));
 	    gst_element_set_state (renderer->pipeline, GST_STATE_NULL);
         }
-        gst_object_unref(renderer->bus);
+        if (renderer->bus) {
+            gst_object_unref(renderer->bus);
+        }
         gst_object_unref(renderer->sink);
+        gst_object_unref(renderer->queue);
         gst_object_unref (renderer->appsrc);
         gst_object_unref (renderer->pipeline);
 #ifdef X_DISPLAY_FIX
@@ -330,8 +607,11 @@ void video_renderer_destroy() {
             renderer->gst_window = NULL;
         }
 #endif    
+        for (int i = 0; i < renderer->n_branches; i++) {
+            g_free(renderer->branches[i].name);
+            g_free(renderer->branches[i].description);
+        }
         free (renderer);
-        renderer = NULL;
     }
 }
 
@@ -339,7 +619,8 @@ void video_renderer_destroy() {
 void video_renderer_update_background(int type) {
 }
 
-gboolean gstreamer_pipeline_bus_callback(GstBus *bus, GstMessage *message, gpointer loop) {
+gboolean gstreamer_pipeline_bus_callback(GstBus *bus, GstMessage *message, gpointer user_data) {
+    video_renderer_t *renderer = (video_renderer_t *) user_data;
     switch (GST_MESSAGE_TYPE (message)) {
     case GST_MESSAGE_ERROR: {
         GError *err;
@@ -360,10 +641,14 @@ gboolean gstreamer_pipeline_bus_callback(GstBus *bus, GstMessage *message, gpoin
 	g_error_free (err);
         g_free (debug);
         gst_app_src_end_of_stream (GST_APP_SRC(renderer->appsrc));
-	flushing = TRUE;
-        gst_bus_set_flushing(bus, flushing);
+        if (renderer->loop) {
+            flushing = TRUE;
+            gst_bus_set_flushing(bus, flushing);
+        }
  	gst_element_set_state (renderer->pipeline, GST_STATE_NULL);
-	g_main_loop_quit( (GMainLoop *) loop);
+        if (renderer->loop) {
+            g_main_loop_quit(renderer->loop);
+        }
         break;
     }
     case GST_MESSAGE_EOS:
@@ -383,18 +668,18 @@ gboolean gstreamer_pipeline_bus_callback(GstBus *bus, GstMessage *message, gpoin
                     switch (event_type) {
                     case GST_NAVIGATION_EVENT_KEY_PRESS:
                         if (gst_navigation_event_parse_key_event (event, &key)) {
-                            if ((strcmp (key, "F11") == 0) || (alt_keypress && strcmp (key, "Return") == 0)) {
-                                fullscreen = !(fullscreen);
-                                set_fullscreen(renderer->gst_window, &fullscreen);
+                            if ((strcmp (key, "F11") == 0) || (renderer->alt_keypress && strcmp (key, "Return") == 0)) {
+                                renderer->fullscreen = !(renderer->fullscreen);
+                                set_fullscreen(renderer->gst_window, &renderer->fullscreen);
                             } else if (strcmp (key, "Alt_L") == 0) {
-                                alt_keypress = true;
+                                renderer->alt_keypress = true;
                             }
                         }
                         break;
                     case GST_NAVIGATION_EVENT_KEY_RELEASE:
                         if (gst_navigation_event_parse_key_event (event, &key)) {
                             if (strcmp (key, "Alt_L") == 0) {
-                                alt_keypress = false;
+                                renderer->alt_keypress = false;
                             }
                         }
                     default:
@@ -415,7 +700,29 @@ gboolean gstreamer_pipeline_bus_callback(GstBus *bus, GstMessage *message, gpoin
     return TRUE;
 }
 
-unsigned int video_renderer_listen(void *loop) {
+static unsigned int video_renderer_gstreamer_listen(video_renderer_t *renderer, void *loop) {
+    renderer->loop = (GMainLoop *) loop;
     return (unsigned int) gst_bus_add_watch(renderer->bus, (GstBusFunc)
-                                            gstreamer_pipeline_bus_callback, (gpointer) loop);    
+                                            gstreamer_pipeline_bus_callback, (gpointer) renderer);    
 }  
+
+const video_renderer_funcs_t video_renderer_gstreamer_funcs = {
+    .name = "gstreamer",
+    .init = video_renderer_gstreamer_init,
+    .start = video_renderer_gstreamer_start,
+    .stop = video_renderer_gstreamer_stop,
+    .pause = video_renderer_gstreamer_pause,
+    .resume = video_renderer_gstreamer_resume,
+    .is_paused = video_renderer_gstreamer_is_paused,
+    .render_buffer = video_renderer_gstreamer_render_buffer,
+    .prime = video_renderer_gstreamer_prime,
+    .flush = video_renderer_gstreamer_flush,
+    .reset = video_renderer_gstreamer_reset,
+    .start_first_frame_timer = video_renderer_gstreamer_start_first_frame_timer,
+    .get_first_frame_latency = video_renderer_gstreamer_get_first_frame_latency,
+    .get_queue_level = video_renderer_gstreamer_get_queue_level,
+    .get_branch_stats = video_renderer_gstreamer_get_branch_stats,
+    .listen = video_renderer_gstreamer_listen,
+    .destroy = video_renderer_gstreamer_destroy,
+    .size = video_renderer_gstreamer_size,
+};
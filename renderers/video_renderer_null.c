@@ -0,0 +1,257 @@
+/**
+ * UxPlay - An open-source AirPlay mirroring server
+ * Copyright (C) 2026 UxPlay contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/*
+ * The "null" video renderer backend: no GStreamer, no decoding and no display.  The framing of
+ * each h264 access unit is checked (every NAL unit starts with 0x00 0x00 0x00 0x01, has a
+ * valid header, and there are nal_count of them), the time it arrived before it was due to be
+ * shown (and the interval since the previous one) is recorded, and it is dropped.  A summary
+ * is logged at the end of each session.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "video_renderer.h"
+#include "../lib/latency_trace.h"
+#include "../lib/metrics.h"
+
+struct video_renderer_s {
+    const video_renderer_funcs_t *funcs;      /* must be first (see video_renderer.c) */
+    logger_t *logger;
+    bool paused;
+    bool first_packet;
+    uint64_t frames, bytes, nal_units, idr_frames;
+    uint64_t invalid_frames;                  /* marked by the receiver: decryption failed */
+    uint64_t bad_frames;                      /* framing errors */
+    uint64_t late_frames;                     /* arrived after they were due */
+    uint64_t check_time;                      /* nsecs spent checking the framing */
+    uint64_t last_arrival;
+    metrics_histogram_t lead;                 /* arrival to presentation time */
+    metrics_histogram_t interval;             /* between arrivals */
+};
+
+static const unsigned char start_code[4] = { 0x00, 0x00, 0x00, 0x01 };
+
+/* returns the number of NAL units in an access unit, or -1 if its framing is invalid */
+static int check_access_unit(const unsigned char *data, int len, bool *idr) {
+    int count = 0;
+    int i = 0;
+    *idr = false;
+    while (i < len) {
+        if (len - i < (int) sizeof(start_code) + 1 || memcmp(data + i, start_code, sizeof(start_code))) {
+            return -1;
+        }
+        i += sizeof(start_code);
+        /* forbidden_zero_bit must be 0; nal_unit_type 0 and 24-31 are not used by h264 */
+        if ((data[i] & 0x80) || (data[i] & 0x1f) == 0 || (data[i] & 0x1f) > 23) {
+            return -1;
+        }
+        if ((data[i] & 0x1f) == 5) {
+            *idr = true;
+        }
+        count++;
+        /* emulation prevention ensures a start code only appears at the start of a NAL unit */
+        for (i++; i < len; i++) {
+            if (data[i] == 0x01 && i >= 3 && !data[i - 1] && !data[i - 2] && !data[i - 3]) {
+                i -= 3;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+static void log_summary(video_renderer_t *renderer) {
+    if (!renderer->frames && !renderer->invalid_frames) {
+        return;
+    }
+    logger_log(renderer->logger, LOGGER_INFO, "null video renderer: %llu frames (%llu IDR), %llu NAL units, "
+               "%.1f MB; %llu with bad framing, %llu failed decryption; checking took %.2f us/frame",
+               (unsigned long long) renderer->frames, (unsigned long long) renderer->idr_frames,
+               (unsigned long long) renderer->nal_units, (double) renderer->bytes / 1000000.0,
+               (unsigned long long) renderer->bad_frames, (unsigned long long) renderer->invalid_frames,
+               renderer->frames ? (double) renderer->check_time / renderer->frames / 1000.0 : 0.0);
+    if (renderer->lead.count) {
+        logger_log(renderer->logger, LOGGER_INFO, "null video renderer: frames arrived (ms before due) "
+                   "p50 %.2f p10 %.2f p1 %.2f; %llu arrived late", 1000.0 * metrics_histogram_quantile(&renderer->lead, 0.5),
+                   1000.0 * metrics_histogram_quantile(&renderer->lead, 0.1),
+                   1000.0 * metrics_histogram_quantile(&renderer->lead, 0.01), (unsigned long long) renderer->late_frames);
+    }
+    if (renderer->interval.count) {
+        logger_log(renderer->logger, LOGGER_INFO, "null video renderer: interval between frames (ms) "
+                   "p50 %.2f p90 %.2f p99 %.2f", 1000.0 * metrics_histogram_quantile(&renderer->interval, 0.5),
+                   1000.0 * metrics_histogram_quantile(&renderer->interval, 0.9),
+                   1000.0 * metrics_histogram_quantile(&renderer->interval, 0.99));
+    }
+}
+
+static void clear_stats(video_renderer_t *renderer) {
+    renderer->frames = renderer->bytes = renderer->nal_units = renderer->idr_frames = 0;
+    renderer->invalid_frames = renderer->bad_frames = renderer->late_frames = 0;
+    renderer->check_time = renderer->last_arrival = 0;
+    memset(&renderer->lead, 0, sizeof(renderer->lead));
+    memset(&renderer->interval, 0, sizeof(renderer->interval));
+}
+
+static video_renderer_t *video_renderer_null_init(logger_t *logger, const char *server_name, videoflip_t videoflip[2],
+                                                  const char *parser, const char *decoder, const char *converter,
+                                                  const char *videosink, const bool *fullscreen,
+                                                  const bool *video_sync, const video_renderer_extras_t *extras) {
+    video_renderer_t *renderer = calloc(1, sizeof(video_renderer_t));
+    if (!renderer) {
+        return NULL;
+    }
+    renderer->funcs = &video_renderer_null_funcs;
+    renderer->logger = logger;
+    logger_log(logger, LOGGER_INFO, "using the null video renderer (no decoding or display) for %s", server_name);
+    return renderer;
+}
+
+static void video_renderer_null_start(video_renderer_t *renderer) {
+    renderer->paused = false;
+    renderer->first_packet = true;
+    clear_stats(renderer);
+}
+
+static void video_renderer_null_stop(video_renderer_t *renderer) {
+    log_summary(renderer);
+    clear_stats(renderer);
+}
+
+static void video_renderer_null_pause(video_renderer_t *renderer) {
+    renderer->paused = true;
+}
+
+static void video_renderer_null_resume(video_renderer_t *renderer) {
+    renderer->paused = false;
+}
+
+static bool video_renderer_null_is_paused(video_renderer_t *renderer) {
+    return renderer->paused;
+}
+
+static void video_renderer_null_render_buffer(video_renderer_t *renderer, unsigned char *data, int *data_len,
+                                              int *nal_count, uint64_t *ntp_time) {
+    uint64_t now = latency_trace_now();
+    bool idr;
+    int count;
+
+    if (data[0]) {
+        /* the first byte of data that failed decryption is 0x01 */
+        renderer->invalid_frames++;
+        return;
+    }
+    if (renderer->first_packet) {
+        logger_log(renderer->logger, LOGGER_INFO, "Begin streaming to the null video renderer");
+        renderer->first_packet = false;
+    }
+    count = check_access_unit(data, *data_len, &idr);
+    renderer->check_time += latency_trace_now() - now;
+    if (count < 0 || count != *nal_count) {
+        if (!renderer->bad_frames) {
+            logger_log(renderer->logger, LOGGER_WARNING, "null video renderer: bad framing of a %d-byte access unit "
+                       "(%d NAL units found, %d expected)", *data_len, count, *nal_count);
+        }
+        renderer->bad_frames++;
+        return;
+    }
+    renderer->frames++;
+    renderer->bytes += *data_len;
+    renderer->nal_units += count;
+    if (idr) {
+        renderer->idr_frames++;
+    }
+    if (*ntp_time >= now) {
+        metrics_histogram_observe(&renderer->lead, (int64_t) (*ntp_time - now));
+    } else {
+        renderer->late_frames++;
+    }
+    if (renderer->last_arrival) {
+        metrics_histogram_observe(&renderer->interval, (int64_t) (now - renderer->last_arrival));
+    }
+    renderer->last_arrival = now;
+}
+
+static void video_renderer_null_prime(video_renderer_t *renderer, unsigned char *data, int data_len) {
+    bool idr;
+    if (check_access_unit(data, data_len, &idr) < 0) {
+        logger_log(renderer->logger, LOGGER_WARNING, "null video renderer: bad framing of the cached keyframe");
+    }
+}
+
+static void video_renderer_null_flush(video_renderer_t *renderer) {
+}
+
+static void video_renderer_null_reset(video_renderer_t *renderer) {
+    video_renderer_null_stop(renderer);
+}
+
+static void video_renderer_null_start_first_frame_timer(video_renderer_t *renderer, int64_t start_time) {
+}
+
+static bool video_renderer_null_get_first_frame_latency(video_renderer_t *renderer, uint64_t *latency) {
+    *latency = 0;
+    return false;
+}
+
+static bool video_renderer_null_get_queue_level(video_renderer_t *renderer, unsigned int *buffers,
+                                                unsigned int *bytes, uint64_t *time) {
+    return false;
+}
+
+static bool video_renderer_null_get_branch_stats(video_renderer_t *renderer, int index, const char **name,
+                                                 uint64_t *dropped) {
+    return false;    /* there are no branches without a pipeline */
+}
+
+static unsigned int video_renderer_null_listen(video_renderer_t *renderer, void *loop) {
+    return 0;    /* there is no pipeline, so no pipeline errors */
+}
+
+static void video_renderer_null_destroy(video_renderer_t *renderer) {
+    log_summary(renderer);
+    free(renderer);
+}
+
+static void video_renderer_null_size(video_renderer_t *renderer, float *width_source, float *height_source,
+                                     float *width, float *height) {
+    logger_log(renderer->logger, LOGGER_DEBUG, "begin video stream wxh = %dx%d; source %dx%d", (int) *width,
+               (int) *height, (int) *width_source, (int) *height_source);
+}
+
+const video_renderer_funcs_t video_renderer_null_funcs = {
+    .name = "null",
+    .init = video_renderer_null_init,
+    .start = video_renderer_null_start,
+    .stop = video_renderer_null_stop,
+    .pause = video_renderer_null_pause,
+    .resume = video_renderer_null_resume,
+    .is_paused = video_renderer_null_is_paused,
+    .render_buffer = video_renderer_null_render_buffer,
+    .prime = video_renderer_null_prime,
+    .flush = video_renderer_null_flush,
+    .reset = video_renderer_null_reset,
+    .start_first_frame_timer = video_renderer_null_start_first_frame_timer,
+    .get_first_frame_latency = video_renderer_null_get_first_frame_latency,
+    .get_queue_level = video_renderer_null_get_queue_level,
+    .get_branch_stats = video_renderer_null_get_branch_stats,
+    .listen = video_renderer_null_listen,
+    .destroy = video_renderer_null_destroy,
+    .size = video_renderer_null_size,
+};
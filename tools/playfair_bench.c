@@ -0,0 +1,71 @@
+/**
+ * UxPlay - An open-source AirPlay mirroring server
+ * Copyright (C) 2026 UxPlay contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/*
+ * playfair_bench [n]: times n (default 1000) calls of playfair_decrypt() (the work of a
+ * SETUP request without the cached key schedule), and of playfair_decrypt_with_key_schedule()
+ * (with it), cycling through the vectors of playfair_vectors.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "playfair_vectors.h"
+
+static double now_usecs() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double) time.tv_sec * 1000000.0 + (double) time.tv_nsec / 1000.0;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned char keymsg[PLAYFAIR_VECTORS][PLAYFAIR_KEYMSG_LEN], ekey[PLAYFAIR_VECTORS][PLAYFAIR_EKEY_LEN];
+    uint32_t key_schedule[PLAYFAIR_VECTORS][11][4];
+    unsigned char key[16];
+    unsigned int check = 0;
+    int n = (argc > 1) ? atoi(argv[1]) : 1000;
+    if (n < 1) {
+        fprintf(stderr, "usage: %s [number of calls]\n", argv[0]);
+        return 1;
+    }
+    for (int i = 0; i < PLAYFAIR_VECTORS; i++) {
+        playfair_make_vector(i, keymsg[i], ekey[i]);
+        playfair_key_schedule(keymsg[i], key_schedule[i]);
+    }
+
+    double start = now_usecs();
+    for (int i = 0; i < n; i++) {
+        playfair_decrypt(keymsg[i % PLAYFAIR_VECTORS], ekey[i % PLAYFAIR_VECTORS], key);
+        check += key[0];
+    }
+    double full = (now_usecs() - start) / n;
+
+    start = now_usecs();
+    for (int i = 0; i < n; i++) {
+        playfair_decrypt_with_key_schedule(key_schedule[i % PLAYFAIR_VECTORS], ekey[i % PLAYFAIR_VECTORS], key);
+        check += key[0];
+    }
+    double cached = (now_usecs() - start) / n;
+
+    /* (check is printed so that the calls cannot be optimized away) */
+    printf("playfair_decrypt():                    %10.2f usecs/call\n", full);
+    printf("playfair_decrypt_with_key_schedule():  %10.2f usecs/call   (%d calls, check %u)\n", cached, n, check);
+    return 0;
+}
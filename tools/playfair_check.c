@@ -0,0 +1,55 @@
+/**
+ * UxPlay - An open-source AirPlay mirroring server
+ * Copyright (C) 2026 UxPlay contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/*
+ * Checks lib/playfair against fixed vectors: the FairPlay "message 3" (keymsg, 164 bytes)
+ * and encrypted AES key (ekey, 72 bytes) of each vector are made by a fixed generator, and
+ * the decrypted keys expected were computed with the original (unoptimized) playfair code.
+ * Both playfair_decrypt() and the cached path (playfair_key_schedule() once, then
+ * playfair_decrypt_with_key_schedule()) are checked.  Exits with 1 if any key differs.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "playfair_vectors.h"
+
+int main(int argc, char *argv[]) {
+    int failed = 0;
+    for (int i = 0; i < PLAYFAIR_VECTORS; i++) {
+        unsigned char keymsg[PLAYFAIR_KEYMSG_LEN], ekey[PLAYFAIR_EKEY_LEN], key[16];
+        uint32_t key_schedule[11][4];
+        playfair_make_vector(i, keymsg, ekey);
+
+        playfair_decrypt(keymsg, ekey, key);
+        if (memcmp(key, playfair_expected[i], sizeof(key))) {
+            printf("vector %d (mode %d): playfair_decrypt() gave the wrong key\n", i, keymsg[12]);
+            failed = 1;
+        }
+        memset(key, 0, sizeof(key));
+        playfair_key_schedule(keymsg, key_schedule);
+        playfair_decrypt_with_key_schedule(key_schedule, ekey, key);
+        if (memcmp(key, playfair_expected[i], sizeof(key))) {
+            printf("vector %d (mode %d): playfair_decrypt_with_key_schedule() gave the wrong key\n", i, keymsg[12]);
+            failed = 1;
+        }
+    }
+    printf("playfair: %d vectors, %s\n", PLAYFAIR_VECTORS, failed ? "FAILED" : "ok");
+    return failed;
+}
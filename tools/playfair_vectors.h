@@ -0,0 +1,65 @@
+/**
+ * UxPlay - An open-source AirPlay mirroring server
+ * Copyright (C) 2026 UxPlay contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ */
+
+/* fixed playfair test vectors, shared by playfair_check and playfair_bench */
+
+#ifndef PLAYFAIR_VECTORS_H
+#define PLAYFAIR_VECTORS_H
+
+#include <stdint.h>
+#include "playfair.h"
+
+#define PLAYFAIR_VECTORS 8
+#define PLAYFAIR_KEYMSG_LEN 164
+#define PLAYFAIR_EKEY_LEN 72
+
+/* the keys decrypted from vectors 0-7 by the original playfair code */
+static const unsigned char playfair_expected[PLAYFAIR_VECTORS][16] = {
+    { 0x1a, 0x81, 0xf0, 0xa9, 0x75, 0xc9, 0x91, 0x98, 0xf2, 0x10, 0x57, 0x2e, 0xb4, 0xd8, 0x98, 0x10 },
+    { 0xa7, 0x39, 0x2b, 0x40, 0xbe, 0x4e, 0x94, 0x52, 0x7b, 0x34, 0xfb, 0xbc, 0x69, 0x4f, 0x4d, 0x73 },
+    { 0x9a, 0x5e, 0x0f, 0x5b, 0xbc, 0xf9, 0x29, 0x8b, 0x66, 0x04, 0x30, 0x13, 0x1f, 0xe5, 0x91, 0x76 },
+    { 0x76, 0x10, 0x37, 0x96, 0x3d, 0xc1, 0x1c, 0xbd, 0xb4, 0x7f, 0xb3, 0xd1, 0xdb, 0xd4, 0x05, 0x51 },
+    { 0x22, 0xae, 0x24, 0x08, 0x2b, 0xb3, 0x72, 0x95, 0x9b, 0xcc, 0xbe, 0x13, 0xc0, 0x68, 0x91, 0x29 },
+    { 0x56, 0x37, 0x51, 0x7d, 0xea, 0x11, 0x72, 0x3e, 0xdd, 0x67, 0x6d, 0x6f, 0x5e, 0x28, 0xa5, 0x59 },
+    { 0x89, 0xa1, 0x13, 0xde, 0x5a, 0xe4, 0x0a, 0x6e, 0x8a, 0xd2, 0xd3, 0x6b, 0xc8, 0xa8, 0xb4, 0x5d },
+    { 0x75, 0x73, 0xb8, 0xd6, 0xcf, 0x56, 0x93, 0xa5, 0xd4, 0x0d, 0xf4, 0x93, 0x34, 0xf4, 0x8b, 0x6d }
+};
+
+/* xorshift32: the same bytes on every platform (unlike rand()) */
+static uint32_t playfair_vector_random(uint32_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+/* vector i: pseudo-random keymsg and ekey, in FairPlay mode i % 4 (keymsg[12]) */
+static void playfair_make_vector(int i, unsigned char keymsg[PLAYFAIR_KEYMSG_LEN],
+                                 unsigned char ekey[PLAYFAIR_EKEY_LEN]) {
+    uint32_t state = 0x9e3779b9u * (uint32_t) (i + 1);
+    for (int j = 0; j < PLAYFAIR_KEYMSG_LEN; j++) {
+        keymsg[j] = (unsigned char) playfair_vector_random(&state);
+    }
+    for (int j = 0; j < PLAYFAIR_EKEY_LEN; j++) {
+        ekey[j] = (unsigned char) playfair_vector_random(&state);
+    }
+    keymsg[12] = (unsigned char) (i % 4);
+}
+
+#endif //PLAYFAIR_VECTORS_H
@@ -59,8 +59,14 @@
 #include "lib/stream.h"
 #include "lib/logger.h"
 #include "lib/dnssd.h"
+#include "lib/metrics.h"
+#include "lib/latency_trace.h"
+#include "lib/thread_policy.h"
 #include "renderers/video_renderer.h"
 #include "renderers/audio_renderer.h"
+#include "renderers/recorder.h"
+#include "renderers/decoder_probe.h"
+#include "renderers/restream.h"
 
 #define VERSION "1.68"
 
@@ -71,19 +77,26 @@
 #define LOWEST_ALLOWED_PORT 1024
 #define HIGHEST_PORT 65535
 #define NTP_TIMEOUT_LIMIT 5
+#define METRICS_PORT 9184
+#define MAX_RECEIVERS 32
 #define BT709_FIX "capssetter caps=\"video/x-h264, colorimetry=bt709\""
 
 static std::string server_name = DEFAULT_NAME;
-static dnssd_t *dnssd = NULL;
-static raop_t *raop = NULL;
 static logger_t *render_logger = NULL;
 static bool audio_sync = false;
 static bool video_sync = true;
 static int64_t audio_delay_alac = 0;
 static int64_t audio_delay_aac = 0;
 static bool relaunch_video = false;
+static bool reuse_video_pipeline = false;
+static bool prewarm_audio = false;
+static bool prewarm_all_audio = false;
+static bool profile_startup = false;
+static std::vector<std::pair<std::string, double>> startup_phases;
+G_LOCK_DEFINE_STATIC(startup_phases);
+static GThread *renderer_init_thread = NULL;
+static GMutex renderer_init_mutex;
 static bool reset_loop = false;
-static unsigned int open_connections= 0;
 static std::string videosink = "autovideosink";
 static videoflip_t videoflip[2] = { NONE , NONE };
 static bool use_video = true;
@@ -95,8 +108,14 @@ static bool new_window_closing_behavior = true;
 static bool close_window;
 static std::string video_parser = "h264parse";
 static std::string video_decoder = "decodebin";
+static bool auto_video_decoder = true;      /* no -vd, -avdec or -v4l2 */
+static bool probe_video_decoder = false;    /* -vdprobe: use the fastest decoder (see decoder_probe.h) */
+static bool reprobe_video_decoder = false;
+static std::string decoder_probe_file = "";
 static std::string video_converter = "videoconvert";
+static bool auto_video_converter = true;    /* no -vc: use the converter that matches a probed decoder */
 static bool show_client_FPS_data = false;
+static bool idr_only = false;
 static unsigned int max_ntp_timeouts = NTP_TIMEOUT_LIMIT;
 static FILE *video_dumpfile = NULL;
 static std::string video_dumpfile_name = "videodump";
@@ -124,7 +143,6 @@ static bool bt709_fix = false;
 static int nohold = 0;
 static unsigned short raop_port;
 static unsigned short airplay_port;
-static uint64_t remote_clock_offset = 0;
 static std::vector<std::string> allowed_clients;
 static std::vector<std::string> blocked_clients;
 static bool restrict_clients;
@@ -140,6 +158,86 @@ static std::vector <std::string> registered_keys;
 static double db_low = -30.0;
 static double db_high = 0.0;
 static bool taper_volume = false;
+static bool use_metrics = false;
+static unsigned short metrics_port = METRICS_PORT;
+static std::string metrics_address = METRICS_DEFAULT_ADDRESS;
+static metrics_t *metrics = NULL;
+static metrics_histogram_t audio_callback_delay = {};
+static metrics_histogram_t video_callback_delay = {};
+static latency_trace_t *latency_trace = NULL;
+static bool use_latency_trace = false;
+static bool null_renderer = false;
+static std::string latency_trace_file = "uxplay_trace.json";
+static std::string flight_recorder_file = "";
+static bool record = false;
+static std::string record_location = "uxplay_recording";
+static recorder_container_t record_container = RECORDER_MP4;
+static unsigned int record_segment_mbytes = 0;
+static unsigned int record_segment_minutes = 0;
+static bool replay = false;
+static unsigned int replay_seconds = 60;
+static unsigned int replay_mbytes = 200;
+static std::string replay_location = "uxplay_replay";
+static bool restream = false;
+static restream_mode_t restream_mode = RESTREAM_RTP;
+static std::string restream_host = "127.0.0.1";
+static unsigned short restream_port = 5004;
+static std::string restream_sdp = "uxplay_restream.sdp";
+static std::string restream_dir = "uxplay_hls";
+static shm_export_t *shm_export = NULL;
+static video_renderer_extras_t video_extras = {};
+static audio_renderer_extras_t audio_extras = {};
+
+/* a receiver has its own RAOP server, DNS-SD service (and MAC address) and renderers, so it can   *
+ * serve its own client; GStreamer, the main loop, logging, metrics and thread policies are shared. *
+ * Besides the main receiver, there can be additional receivers ("-receiver name[:ports]").         *
+ * Recording, restreaming, tracing and the other extras are only done by the main receiver.         */
+typedef struct receiver_s {
+    std::string name;
+    unsigned short tcp[3], udp[3];
+    std::vector<char> hw_addr;
+    std::string device_id;
+    dnssd_t *dnssd;
+    raop_t *raop;
+    video_renderer_t *video_renderer;
+    GMutex video_mutex;               /* held by the callbacks while they use video_renderer */
+    audio_renderer_t *audio_renderer;
+    guint bus_watch_id;
+    unsigned int open_connections;
+    uint64_t remote_clock_offset;
+    long memory;                      /* kB of resident memory added by starting this receiver */
+} receiver_t;
+static receiver_t main_receiver = {};
+static std::vector<receiver_t *> receivers;     /* the additional receivers */
+static dnssd_t *&dnssd = main_receiver.dnssd;
+static raop_t *&raop = main_receiver.raop;
+static video_renderer_t *&video_renderer = main_receiver.video_renderer;
+static audio_renderer_t *&audio_renderer = main_receiver.audio_renderer;
+
+/* raop stats and GStreamer queue levels are sampled in the main loop (which owns raop *
+ * and the renderers) and are read from here by the metrics thread.                  */
+typedef struct metrics_sample_s {
+    bool have_stats;
+    raop_stats_t stats;
+    metrics_histogram_t pair_verify;
+    metrics_histogram_t pair_setup;
+    bool have_video_queue, have_audio_queue;
+    unsigned int video_queue_buffers, video_queue_bytes;
+    unsigned int audio_queue_buffers, audio_queue_bytes;
+    uint64_t video_queue_time, audio_queue_time;
+    bool have_video_first_frame;
+    uint64_t video_first_frame;
+    int audio_sinks;
+    int64_t audio_sink_drift[AUDIO_RENDERER_MAX_SINKS];
+    uint64_t audio_sink_late[AUDIO_RENDERER_MAX_SINKS], audio_sink_dropped[AUDIO_RENDERER_MAX_SINKS];
+    int receivers;
+    unsigned int receiver_connections[MAX_RECEIVERS];
+    int video_branches;
+    std::string video_branch_name[VIDEO_RENDERER_MAX_BRANCHES + 1];
+    uint64_t video_branch_dropped[VIDEO_RENDERER_MAX_BRANCHES + 1];
+} metrics_sample_t;
+static metrics_sample_t metrics_sample = {};
+G_LOCK_DEFINE_STATIC(metrics_sample);
 
 /* logging */
 
@@ -356,6 +454,52 @@ static gboolean reset_callback(gpointer loop) {
     return TRUE;
 }
 
+static gboolean metrics_sample_callback(gpointer data) {
+    metrics_sample_t sample = {};
+    if (use_video) {
+        sample.have_video_queue = video_renderer_get_queue_level(video_renderer, &sample.video_queue_buffers,
+                                                                 &sample.video_queue_bytes, &sample.video_queue_time);
+        sample.have_video_first_frame = video_renderer_get_first_frame_latency(video_renderer, &sample.video_first_frame);
+        const char *branch_name;
+        while (sample.video_branches < VIDEO_RENDERER_MAX_BRANCHES + 1 &&
+               video_renderer_get_branch_stats(video_renderer, sample.video_branches, &branch_name,
+                                               &sample.video_branch_dropped[sample.video_branches])) {
+            sample.video_branch_name[sample.video_branches++] = branch_name;
+        }
+    }
+    if (use_audio) {
+        sample.have_audio_queue = audio_renderer_get_queue_level(audio_renderer, &sample.audio_queue_buffers,
+                                                                 &sample.audio_queue_bytes, &sample.audio_queue_time);
+        const char *audiosink;
+        while (sample.audio_sinks < AUDIO_RENDERER_MAX_SINKS &&
+               audio_renderer_get_sink_stats(audio_renderer, sample.audio_sinks, &audiosink, &sample.audio_sink_drift[sample.audio_sinks],
+                                             &sample.audio_sink_late[sample.audio_sinks],
+                                             &sample.audio_sink_dropped[sample.audio_sinks])) {
+            sample.audio_sinks++;
+        }
+    }
+    for (receiver_t *receiver : receivers) {
+        sample.receiver_connections[sample.receivers++] = receiver->open_connections;
+    }
+    if (raop) {
+        raop_get_stats(raop, &sample.stats);
+        sample.pair_verify = *raop_get_pair_verify_histogram(raop);
+        sample.pair_setup = *raop_get_pair_setup_histogram(raop);
+        sample.have_stats = true;
+    }
+    G_LOCK(metrics_sample);
+    if (!sample.have_stats) {
+        /* keep the last stats while the raop server is being relaunched */
+        sample.have_stats = metrics_sample.have_stats;
+        sample.stats = metrics_sample.stats;
+        sample.pair_verify = metrics_sample.pair_verify;
+        sample.pair_setup = metrics_sample.pair_setup;
+    }
+    metrics_sample = sample;
+    G_UNLOCK(metrics_sample);
+    return TRUE;
+}
+
 static gboolean  sigint_callback(gpointer loop) {
     relaunch_video = false;
     g_main_loop_quit((GMainLoop *) loop);
@@ -368,6 +512,32 @@ static gboolean  sigterm_callback(gpointer loop) {
     return TRUE;
 }
 
+static void dump_flight_recorder() {
+    if (raop && flight_recorder_file.length()) {
+        raop_dump_flight_recorder(raop, flight_recorder_file.c_str(), FLIGHT_RECORDER_SECONDS);
+    }
+}
+
+/* (conn_reset runs on a network thread, which should not block on file output) */
+static gboolean dump_flight_recorder_callback(gpointer data) {
+    dump_flight_recorder();
+    return FALSE;
+}
+
+#ifndef _WIN32
+static gboolean  sigusr1_callback(gpointer loop) {
+    dump_flight_recorder();
+    return TRUE;
+}
+
+static gboolean  sigusr2_callback(gpointer loop) {
+    if (replay) {
+        recorder_replay_save();
+    }
+    return TRUE;
+}
+#endif
+
 #ifdef _WIN32
 struct signal_handler {
     GSourceFunc handler;
@@ -395,17 +565,31 @@ static void main_loop()  {
     relaunch_video = false;
     if (use_video) {
         relaunch_video = true;
-        gst_bus_watch_id = (guint) video_renderer_listen((void *)loop);
+        gst_bus_watch_id = (guint) video_renderer_listen(video_renderer, (void *)loop);
     }
     guint reset_watch_id = g_timeout_add(100, (GSourceFunc) reset_callback, (gpointer) loop);
+    guint metrics_watch_id = 0;
+    if (metrics) {
+        metrics_sample_callback(NULL);
+        metrics_watch_id = g_timeout_add(1000, (GSourceFunc) metrics_sample_callback, NULL);
+    }
     guint sigterm_watch_id = g_unix_signal_add(SIGTERM, (GSourceFunc) sigterm_callback, (gpointer) loop);
     guint sigint_watch_id = g_unix_signal_add(SIGINT, (GSourceFunc) sigint_callback, (gpointer) loop);
+#ifndef _WIN32
+    guint sigusr1_watch_id = g_unix_signal_add(SIGUSR1, (GSourceFunc) sigusr1_callback, (gpointer) loop);
+    guint sigusr2_watch_id = g_unix_signal_add(SIGUSR2, (GSourceFunc) sigusr2_callback, (gpointer) loop);
+#endif
     g_main_loop_run(loop);
 
     if (gst_bus_watch_id > 0) g_source_remove(gst_bus_watch_id);
     if (sigint_watch_id > 0) g_source_remove(sigint_watch_id);
     if (sigterm_watch_id > 0) g_source_remove(sigterm_watch_id);
+#ifndef _WIN32
+    if (sigusr1_watch_id > 0) g_source_remove(sigusr1_watch_id);
+    if (sigusr2_watch_id > 0) g_source_remove(sigusr2_watch_id);
+#endif
     if (reset_watch_id > 0) g_source_remove(reset_watch_id);
+    if (metrics_watch_id > 0) g_source_remove(metrics_watch_id);
     g_main_loop_unref(loop);
 }    
 
@@ -416,6 +600,109 @@ static int parse_hw_addr (std::string str, std::vector<char> &hw_addr) {
     return 0;
 }
 
+/* resident set size in kB, or -1 if unknown */
+static long get_resident_memory() {
+    long rss = -1;
+#ifdef __linux__
+    long pages;
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (fp) {
+        if (fscanf(fp, "%*ld %ld", &pages) == 1) {
+            rss = pages * (sysconf(_SC_PAGESIZE) / 1024);
+        }
+        fclose(fp);
+    }
+#endif
+    return rss;
+}
+
+/* record the duration (ms) of a startup phase that began at start_time (g_get_monotonic_time) */
+static void startup_phase(const char *name, gint64 start_time) {
+    double duration = (double) (g_get_monotonic_time() - start_time) / 1000.0;
+    G_LOCK(startup_phases);
+    startup_phases.push_back(std::make_pair(std::string(name), duration));
+    G_UNLOCK(startup_phases);
+}
+
+/* GStreamer and the renderers are initialized in a separate thread, while the RAOP server *
+ * starts and the service is registered with DNS-SD, so UxPlay becomes discoverable sooner. */
+static gpointer init_renderers(gpointer data) {
+    gint64 start_time = g_get_monotonic_time();
+    /* the null renderers do not use GStreamer, but recording and restreaming do */
+    if (!null_renderer || record || replay || restream) {
+        if (!gstreamer_init()) {
+            LOGE ("stopping");
+            exit (1);
+        }
+        startup_phase("gstreamer_init", start_time);
+    }
+
+    if (record) {
+        record = recorder_init(render_logger, record_location.c_str(), record_container,
+                               (uint64_t) record_segment_mbytes * 1000000, record_segment_minutes * 60);
+    }
+    if (replay) {
+        replay = recorder_replay_init(render_logger, replay_location.c_str(), replay_seconds,
+                                      (uint64_t) replay_mbytes * 1000000);
+    }
+    if (restream) {
+        restream = restream_init(render_logger, restream_mode, restream_host.c_str(), restream_port,
+                                 restream_sdp.c_str(), restream_dir.c_str());
+    }
+
+    audio_extras.trace = latency_trace;
+    video_extras.trace = latency_trace;
+
+    if (use_audio) {
+        start_time = g_get_monotonic_time();
+        audio_renderer = audio_renderer_init(render_logger, audiosink.c_str(), &audio_sync, &video_sync, &audio_extras);
+        if (prewarm_all_audio) {
+            audio_renderer_prewarm(audio_renderer, 0, false);
+        } else if (prewarm_audio) {
+            /* AAC-ELD is used with mirroring, ALAC for AirPlay audio-only */
+            audio_renderer_prewarm(audio_renderer, use_video ? 8 : 2, true);
+        }
+        startup_phase("audio_renderer_init", start_time);
+    } else {
+        LOGI("audio_disabled");
+    }
+
+    if (use_video && probe_video_decoder && auto_video_decoder && !null_renderer) {
+        char decoder[64], converter[64];
+        start_time = g_get_monotonic_time();
+        snprintf(decoder, sizeof(decoder), "%s", video_decoder.c_str());
+        if (decoder_probe_select(render_logger, decoder_probe_file.length() ? decoder_probe_file.c_str() : NULL,
+                                 reprobe_video_decoder, decoder, sizeof(decoder), converter, sizeof(converter))) {
+            video_decoder = decoder;
+            if (auto_video_converter) {
+                video_converter = converter;
+            }
+        }
+        startup_phase("decoder_probe", start_time);
+    }
+
+    if (use_video) {
+        start_time = g_get_monotonic_time();
+        video_renderer = video_renderer_init(render_logger, server_name.c_str(), videoflip, video_parser.c_str(),
+                                             video_decoder.c_str(), video_converter.c_str(), videosink.c_str(),
+                                             &fullscreen, &video_sync, &video_extras);
+        video_renderer_start(video_renderer);
+        startup_phase("video_renderer_init", start_time);
+    }
+    return NULL;
+}
+
+/* called before the renderers are first used (also by conn_init, as a client may connect *
+ * as soon as the RAOP server has started)                                                 */
+static void wait_for_renderers() {
+    g_mutex_lock(&renderer_init_mutex);
+    if (renderer_init_thread) {
+        g_thread_join(renderer_init_thread);
+        renderer_init_thread = NULL;
+    }
+    g_mutex_unlock(&renderer_init_mutex);
+}
+
 static const char *get_homedir() {
     const char *homedir = getenv("XDG_CONFIG_HOMEDIR");
     if (homedir == NULL) {
@@ -588,28 +875,64 @@ static void print_info (char *name) {
     printf("-p n      Use TCP and UDP ports n,n+1,n+2. range %d-%d\n", LOWEST_ALLOWED_PORT, HIGHEST_PORT);
     printf("          use \"-p n1,n2,n3\" to set each port, \"n1,n2\" for n3 = n2+1\n");
     printf("          \"-p tcp n\" or \"-p udp n\" sets TCP or UDP ports separately\n");
+    printf("-receiver name[:n] Also run a receiver \"name\" (with its own MAC\n");
+    printf("          address and renderers) in this process, on TCP and UDP\n");
+    printf("          ports n,n+1,n+2 (default: dynamic).  Extras like recording\n");
+    printf("          are main-receiver only. Can be used up to %d times.\n", MAX_RECEIVERS);
     printf("-avdec    Force software h264 video decoding with libav decoder\n"); 
     printf("-vp ...   Choose the GSteamer h264 parser: default \"h264parse\"\n");
     printf("-vd ...   Choose the GStreamer h264 decoder; default \"decodebin\"\n");
     printf("          choices: (software) avdec_h264; (hardware) v4l2h264dec,\n");
     printf("          nvdec, nvh264dec, vaapih64dec, vtdec,etc.\n");
     printf("          choices: avdec_h264,vaapih264dec,nvdec,nvh264dec,v4l2h264dec\n");
+    printf("-vdprobe [new] Use the fastest h264 decoder found by a probe (result\n");
+    printf("          is cached in ~/.uxplay.decoder, and reused until GStreamer\n");
+    printf("          is updated); \"new\": probe the decoders again\n");
     printf("-vc ...   Choose the GStreamer videoconverter; default \"videoconvert\"\n");
     printf("          another choice when using v4l2h264dec: v4l2convert\n");
     printf("-vs ...   Choose the GStreamer videosink; default \"autovideosink\"\n");
     printf("          some choices: ximagesink,xvimagesink,vaapisink,glimagesink,\n");
     printf("          gtksink,waylandsink,osxvideosink,kmssink,d3d11videosink etc.\n");
     printf("-vs 0     Streamed audio only, with no video display window\n");
+    printf("-vbranch name[:n] \"pipeline\" Also send the decoded video to a second\n");
+    printf("          output, e.g. \"videoconvert ! videoscale ! autovideosink\", through\n");
+    printf("          a leaky queue of n frames (default 2): decoding is done once,\n");
+    printf("          and a slow branch drops frames instead of delaying the\n");
+    printf("          main display. Can be used up to 4 times.\n");
+    printf("-vshm [name[:n]] Publish decoded frames (BGRx) to POSIX shared memory\n");
+    printf("          \"name\" (default \"/uxplay\") as a ring of n frames (default 3)\n");
+    printf("          for local readers; format: see lib/shm_export.h. (not Windows)\n");
     printf("-v4l2     Use Video4Linux2 for GPU hardware h264 decoding\n");
     printf("-bt709    Sometimes needed for Raspberry Pi with GStreamer < 1.22 \n"); 
     printf("-as ...   Choose the GStreamer audiosink; default \"autoaudiosink\"\n");
     printf("          some choices:pulsesink,alsasink,pipewiresink,jackaudiosink,\n");
     printf("          osssink,oss4sink,osxaudiosink,wasapisink,directsoundsink.\n");
     printf("-as 0     (or -a)  Turn audio off, streamed video only\n");
+    printf("-asadd \"sink\" [ms] Also render audio to another audiosink (decoded\n");
+    printf("          once), delayed by ms millisecs (can be negative) to align\n");
+    printf("          it with the main sink. Can be used up to 3 times.\n");
     printf("-al x     Audio latency in seconds (default 0.25) reported to client.\n");
     printf("-ca <fn>  In Airplay Audio (ALAC) mode, write cover-art to file <fn>\n");
     printf("-reset n  Reset after 3n seconds client silence (default %d, 0=never)\n", NTP_TIMEOUT_LIMIT);
     printf("-nc       do Not Close video window when client stops mirroring\n");
+    printf("-aprewarm [all] Build the likely audio pipeline (AAC-ELD, or ALAC if\n");
+    printf("          -vs 0) in the background at startup; \"all\" builds every\n");
+    printf("          pipeline at startup. Default: build when first needed.\n");
+    printf("-startup  Log the time taken by each startup phase.\n");
+    printf("-thread <role>[:sched=fifo|rr|other][:prio=n][:nice=n][:cpus=list]\n");
+    printf("          Scheduling of receiver threads: role = audio, mirror, ntp,\n");
+    printf("          httpd, gst-audio, gst-video (GStreamer streaming), or gst\n");
+    printf("          (both); e.g. \"-thread audio:sched=fifo:prio=50:cpus=2,3\".\n");
+    printf("          Repeat for other roles. Realtime priorities and nice < 0\n");
+    printf("          need CAP_SYS_NICE or rlimits (ulimit -r, -e) (Linux).\n");
+    printf("-vreuse   Reuse (reset) the video pipeline between clients instead of\n");
+    printf("          rebuilding it: faster first frame; the window stays open.\n");
+    printf("-vidronly Show only the keyframes (IDR frames) of mirrored video, for\n");
+    printf("          thumbnails or video walls: other frames are dropped, most of\n");
+    printf("          them without decryption; the savings are logged per session.\n");
+    printf("-renderer null  Do not decode or play: only check the framing and\n");
+    printf("          timing of the video and audio received (no GStreamer or\n");
+    printf("          display needed), to benchmark or load-test the receiver.\n");
     printf("-nohold   Drop current connection when new client connects.\n");
     printf("-restrict Restrict clients to those specified by \"-allow <deviceID>\"\n");
     printf("          UxPlay displays deviceID when a client attempts to connect\n");
@@ -618,6 +941,9 @@ static void print_info (char *name) {
     printf("-block <i>Always block connections from deviceID = <i>\n");
     printf("-FPSdata  Show video-streaming performance reports sent by client.\n");
     printf("-fps n    Set maximum allowed streaming framerate, default 30\n");
+    printf("-metrics [[ip:]n] Serve receiver statistics (OpenMetrics text, for Prometheus)\n");
+    printf("          at http://%s:%d/metrics; optionally on port n of IPv4 address ip\n",
+           METRICS_DEFAULT_ADDRESS, METRICS_PORT);
     printf("-f {H|V|I}Horizontal|Vertical flip, or both=Inversion=rotate 180 deg\n");
     printf("-r {R|L}  Rotate 90 degrees Right (cw) or Left (ccw)\n");
     printf("-m [mac]  Set MAC address (also Device ID);use for concurrent UxPlays\n");
@@ -633,6 +959,30 @@ static void print_info (char *name) {
     printf("          =1,2,..; fn=\"audiodump\"; change with \"-admp [n] filename\".\n");
     printf("          x increases when audio format changes. If n is given, <= n\n");
     printf("          audio packets are dumped. \"aud\"= unknown format.\n");
+    printf("-trace    Trace latency of video frames and audio packets from socket\n");
+    printf("          to sink: per-stage means are logged at exit, and a Chrome/\n");
+    printf("          Perfetto trace is written to \"uxplay_trace.json\" (change\n");
+    printf("          with \"-trace fn\"). Stage histograms are shown by -metrics.\n");
+    printf("-flightrec [fn] Recent packet, NTP and callback-delay records (always kept)\n");
+    printf("          are written to $HOME/.uxplay.flightrec (or file \"fn\") when\n");
+    printf("          the client connection is lost, and on SIGUSR1 (not Windows).\n");
+    printf("          \"-flightrec no\" disables these files.\n");
+    printf("-rec [fn] Record the mirrored video and audio (as received, not decoded)\n");
+    printf("          to files \"fn.<date-time>.nnn.mp4\" (fn=\"uxplay_recording\").\n");
+    printf("          Writing is done in the background: if the disk is too\n");
+    printf("          slow, frames are dropped (not the connection).\n");
+    printf("-recfmt x Recording container: x = mp4 (fragmented, default) or mkv.\n");
+    printf("-recsize n Start a new recording file after n MB (default 0 = never)\n");
+    printf("-rectime n Start a new recording file after n minutes (default 0)\n");
+    printf("-replay [n] Keep the last n seconds (default 60) of video and audio\n");
+    printf("          in memory, and save them to \"uxplay_replay.<date-time>.mp4\"\n");
+    printf("          on SIGUSR2 (not Windows); change fn with \"-replayfn fn\".\n");
+    printf("-replaymb n Memory limit of \"-replay\" in MB (default 200)\n");
+    printf("-restream rtp[:host[:port]] Re-stream video and audio (not re-encoded)\n");
+    printf("          as RTP to host:port (default 127.0.0.1:5004; audio to port+2);\n");
+    printf("          players open the SDP file \"uxplay_restream.sdp\".\n");
+    printf("-restream hls[:dir] Re-stream as HLS: segments and \"uxplay.m3u8\" are\n");
+    printf("          written to directory dir (default \"uxplay_hls\").\n");
     printf("-d        Enable debug logging\n");
     printf("-v        Displays version information\n");
     printf("-h        Displays this help\n");
@@ -888,6 +1238,28 @@ static void parse_arguments (int argc, char *argv[]) {
                     udp[j] = tcp[j];
                 }
             }
+        } else if (arg == "-receiver") {
+            if (!option_has_value(i, argc, arg, argv[i+1])) exit(1);
+            receiver_t *receiver = new receiver_t();
+            g_mutex_init(&receiver->video_mutex);
+            receiver->name = argv[++i];
+            size_t colon = receiver->name.find_last_of(':');
+            if (colon != std::string::npos) {
+                if (!get_ports(3, arg, receiver->name.substr(colon + 1).c_str(), receiver->tcp)) exit(1);
+                for (int j = 0; j < 3; j++) {
+                    receiver->udp[j] = receiver->tcp[j];
+                }
+                receiver->name.erase(colon);
+            }
+            if (receiver->name.empty() || receiver->name.find_first_of("\"\\") != std::string::npos) {
+                fprintf(stderr, "invalid \"-receiver %s\": the name must not be empty or contain \" or \\\n", argv[i]);
+                exit(1);
+            }
+            if (receivers.size() == MAX_RECEIVERS) {
+                fprintf(stderr, "too many \"-receiver\" options: at most %d receivers can be added\n", MAX_RECEIVERS);
+                exit(1);
+            }
+            receivers.push_back(receiver);
         } else if (arg == "-m") {
 	    if (i < argc - 1 && *argv[i+1] != '-') {
                 if (validate_mac(argv[++i])) {
@@ -920,14 +1292,92 @@ static void parse_arguments (int argc, char *argv[]) {
             if (!option_has_value(i, argc, arg, argv[i+1])) exit(1);
             video_decoder.erase();
             video_decoder.append(argv[++i]);
+            auto_video_decoder = false;
+        } else if (arg == "-vdprobe") {
+            probe_video_decoder = true;
+            if (i < argc - 1 && *argv[i+1] != '-') {
+                if (strcmp(argv[++i], "new")) {
+                    fprintf(stderr, "invalid \"-vdprobe %s\"; the only allowed value is \"new\"\n", argv[i]);
+                    exit(1);
+                }
+                reprobe_video_decoder = true;
+            }
         } else if (arg == "-vc") {
             if (!option_has_value(i, argc, arg, argv[i+1])) exit(1);
             video_converter.erase();
             video_converter.append(argv[++i]);
+            auto_video_converter = false;
         } else if (arg == "-vs") {
             if (!option_has_value(i, argc, arg, argv[i+1])) exit(1);
             videosink.erase();
             videosink.append(argv[++i]);
+        } else if (arg == "-vbranch") {
+            if (!option_has_value(i, argc, arg, argv[i+1]) || !option_has_value(i + 1, argc, arg, argv[i+2])) exit(1);
+            std::string name(argv[++i]);
+            unsigned int max_buffers = 2;
+            size_t colon = name.find(':');
+            if (colon != std::string::npos) {
+                unsigned int n = 0;
+                if (!get_value(name.substr(colon + 1).c_str(), &n) || n < 1 || n > 100) {
+                    fprintf(stderr, "invalid \"-vbranch %s\"; n must be an integer in range [1,100]\n", argv[i]);
+                    exit(1);
+                }
+                max_buffers = n;
+                name.erase(colon);
+            }
+            if (!video_renderer_add_branch(&video_extras, name.c_str(), argv[++i], max_buffers)) {
+                fprintf(stderr, "invalid \"-vbranch %s\": names must be distinct, and made of letters, digits, "
+                        "\"_\" and \"-\"; at most %d branches\n", argv[i-1], VIDEO_RENDERER_MAX_BRANCHES);
+                exit(1);
+            }
+        } else if (arg == "-vshm") {
+            std::string name = "/uxplay";
+            unsigned int slots = 3;
+            char error[256];
+            if (i < argc - 1 && *argv[i+1] != '-') {
+                name = argv[++i];
+                size_t colon = name.find(':');
+                if (colon != std::string::npos) {
+                    unsigned int n = 0;
+                    if (!get_value(name.substr(colon + 1).c_str(), &n)) {
+                        fprintf(stderr, "invalid \"-vshm %s\"; n must be an integer\n", argv[i]);
+                        exit(1);
+                    }
+                    slots = n;
+                    name.erase(colon);
+                }
+            }
+            if (shm_export) {
+                shm_export_destroy(shm_export);
+            }
+            shm_export = shm_export_init(name.c_str(), slots, error, sizeof(error));
+            if (!shm_export) {
+                fprintf(stderr, "invalid \"-vshm\": %s\n", error);
+                exit(1);
+            }
+            video_extras.shm_export = shm_export;
+        } else if (arg == "-asadd") {
+            if (!option_has_value(i, argc, arg, argv[i+1])) exit(1);
+            const char *sink = argv[++i];
+            long delay_ms = 0;
+            if (i < argc - 1) {
+                char *end;
+                long n = strtol(argv[i+1], &end, 10);
+                if (*argv[i+1] && !*end) {
+                    if (n < -5000 || n > 5000) {
+                        fprintf(stderr, "invalid \"-asadd %s %s\": the delay must be in range [-5000,5000] ms\n",
+                                sink, argv[i+1]);
+                        exit(1);
+                    }
+                    delay_ms = n;
+                    i++;
+                }
+            }
+            if (!audio_renderer_add_sink(&audio_extras, sink, (int) delay_ms)) {
+                fprintf(stderr, "too many \"-asadd\" options: at most %d audiosinks can be used\n",
+                        AUDIO_RENDERER_MAX_SINKS);
+                exit(1);
+            }
         } else if (arg == "-as") {
             if (!option_has_value(i, argc, arg, argv[i+1])) exit(1);
             audiosink.erase();
@@ -938,16 +1388,45 @@ static void parse_arguments (int argc, char *argv[]) {
             exit(1);
         } else if (arg == "-nc") {
             new_window_closing_behavior = false;
+        } else if (arg == "-startup") {
+            profile_startup = true;
+        } else if (arg == "-thread") {
+            if (!option_has_value(i, argc, arg, argv[i+1])) exit(1);
+            char error[128];
+            if (thread_policy_parse(argv[++i], error, sizeof(error))) {
+                fprintf(stderr, "invalid \"-thread %s\": %s\n"
+                        "-thread <role>[:sched=fifo|rr|other][:prio=n][:nice=n][:cpus=list]\n", argv[i], error);
+                exit(1);
+            }
+        } else if (arg == "-vidronly") {
+            idr_only = true;
+        } else if (arg == "-vreuse") {
+            reuse_video_pipeline = true;
+        } else if (arg == "-renderer") {
+            if (!option_has_value(i, argc, arg, argv[i+1])) exit(1);
+            if (!video_renderer_set_backend(argv[++i]) || !audio_renderer_set_backend(argv[i])) {
+                fprintf(stderr, "invalid \"-renderer %s\": choices are gstreamer, null\n", argv[i]);
+                exit(1);
+            }
+            null_renderer = (strcmp(argv[i], "null") == 0);
+        } else if (arg == "-aprewarm") {
+            prewarm_audio = true;
+            if (i < argc - 1 && strcmp(argv[i+1], "all") == 0) {
+                prewarm_all_audio = true;
+                i++;
+            }
         } else if (arg == "-avdec") {
             video_parser.erase();
             video_parser = "h264parse";
             video_decoder.erase();
             video_decoder = "avdec_h264";
+            auto_video_decoder = false;
             video_converter.erase();
             video_converter = "videoconvert";
         } else if (arg == "-v4l2") {
             video_decoder.erase();
             video_decoder = "v4l2h264dec";
+            auto_video_decoder = false;
             video_converter.erase();
             video_converter = "v4l2convert";
         } else if (arg == "-rpi" || arg == "-rpifb" || arg == "-rpigl" || arg == "-rpiwl") {
@@ -1017,6 +1496,100 @@ static void parse_arguments (int argc, char *argv[]) {
                     exit(1);
                 }   		
             }
+        } else if (arg == "-rec") {
+            record = true;
+            if (i < argc - 1 && *argv[i+1] != '-') {
+                record_location.erase();
+                record_location.append(argv[++i]);
+            }
+        } else if (arg == "-recfmt") {
+            if (!option_has_value(i, argc, arg, argv[i+1])) exit(1);
+            std::string format(argv[++i]);
+            if (format == "mp4") {
+                record_container = RECORDER_MP4;
+            } else if (format == "mkv") {
+                record_container = RECORDER_MKV;
+            } else {
+                fprintf(stderr, "invalid \"-recfmt %s\"; choices are mp4 (fragmented MP4) and mkv (Matroska)\n", argv[i]);
+                exit(1);
+            }
+        } else if (arg == "-recsize" || arg == "-rectime") {
+            if (!option_has_value(i, argc, arg, argv[i+1])) exit(1);
+            unsigned int n = 0;
+            if (!get_value(argv[++i], &n) || n > 1000000) {
+                fprintf(stderr, "invalid \"%s %s\"; value must be an integer in range [0,1000000] (0 = no limit)\n",
+                        arg.c_str(), argv[i]);
+                exit(1);
+            }
+            if (arg == "-recsize") {
+                record_segment_mbytes = n;
+            } else {
+                record_segment_minutes = n;
+            }
+        } else if (arg == "-replay") {
+            replay = true;
+            if (i < argc - 1 && *argv[i+1] != '-') {
+                unsigned int n = 0;
+                if (!get_value(argv[++i], &n) || n < 1 || n > 3600) {
+                    fprintf(stderr, "invalid \"-replay %s\"; seconds must be an integer in range [1,3600]\n", argv[i]);
+                    exit(1);
+                }
+                replay_seconds = n;
+            }
+        } else if (arg == "-replaymb") {
+            if (!option_has_value(i, argc, arg, argv[i+1])) exit(1);
+            unsigned int n = 0;
+            if (!get_value(argv[++i], &n) || n < 1 || n > 100000) {
+                fprintf(stderr, "invalid \"-replaymb %s\"; value must be an integer in range [1,100000]\n", argv[i]);
+                exit(1);
+            }
+            replay_mbytes = n;
+        } else if (arg == "-replayfn") {
+            if (!option_has_value(i, argc, arg, argv[i+1])) exit(1);
+            replay_location.erase();
+            replay_location.append(argv[++i]);
+            std::string fn = replay_location + ".mp4";
+            if (!file_has_write_access(fn.c_str())) {
+                fprintf(stderr, "%s cannot be written to:\noption \"-replayfn <fn>\" must be to files with write access\n",
+                        fn.c_str());
+                exit(1);
+            }
+        } else if (arg == "-restream") {
+            if (!option_has_value(i, argc, arg, argv[i+1])) exit(1);
+            std::string spec(argv[++i]);
+            std::string type = spec.substr(0, spec.find(':'));
+            std::string rest = (spec.find(':') == std::string::npos) ? "" : spec.substr(spec.find(':') + 1);
+            restream = true;
+            if (type == "rtp") {
+                restream_mode = RESTREAM_RTP;
+                if (rest.length()) {
+                    size_t colon = rest.rfind(':');
+                    if (colon != std::string::npos) {
+                        unsigned int n = 0;
+                        if (!get_value(rest.substr(colon + 1).c_str(), &n) || n < 1024 || n > 65533) {
+                            fprintf(stderr, "invalid port in \"-restream %s\" (range [1024,65533])\n", spec.c_str());
+                            exit(1);
+                        }
+                        restream_port = (unsigned short) n;
+                        rest.erase(colon);
+                    }
+                    if (rest.length()) {
+                        restream_host = rest;
+                    }
+                }
+                if (!file_has_write_access(restream_sdp.c_str())) {
+                    fprintf(stderr, "%s cannot be written to: needed by \"-restream rtp\"\n", restream_sdp.c_str());
+                    exit(1);
+                }
+            } else if (type == "hls") {
+                restream_mode = RESTREAM_HLS;
+                if (rest.length()) {
+                    restream_dir = rest;
+                }
+            } else {
+                fprintf(stderr, "invalid \"-restream %s\"; use rtp[:host[:port]] or hls[:dir]\n", spec.c_str());
+                exit(1);
+            }
         } else if (arg  == "-ca" ) {
             if (option_has_value(i, argc, arg, argv[i+1])) {
                 coverart_filename.erase();
@@ -1034,6 +1607,44 @@ static void parse_arguments (int argc, char *argv[]) {
             bt709_fix = true;
         } else if (arg == "-nohold") {
             nohold = 1;
+        } else if (arg == "-trace") {
+            use_latency_trace = true;
+            if (i < argc - 1 && *argv[i+1] != '-') {
+                latency_trace_file.erase();
+                latency_trace_file.append(argv[++i]);
+                if (!file_has_write_access(latency_trace_file.c_str())) {
+                    fprintf(stderr, "%s cannot be written to:\noption \"-trace <fn>\" must be to a file with write access\n",
+                            latency_trace_file.c_str());
+                    exit(1);
+                }
+            }
+        } else if (arg == "-flightrec") {
+            if (i < argc - 1 && *argv[i+1] != '-') {
+                flight_recorder_file.erase();
+                flight_recorder_file.append(argv[++i]);
+                if (flight_recorder_file != "no" && !file_has_write_access(flight_recorder_file.c_str())) {
+                    fprintf(stderr, "%s cannot be written to:\noption \"-flightrec <fn>\" must be to a file with write access\n",
+                            flight_recorder_file.c_str());
+                    exit(1);
+                }
+            }
+        } else if (arg == "-metrics") {
+            use_metrics = true;
+            if (i < argc - 1 && *argv[i+1] != '-') {
+                std::string value = argv[++i];
+                size_t colon = value.rfind(':');
+                unsigned int n = HIGHEST_PORT;
+                if (colon != std::string::npos) {
+                    metrics_address = value.substr(0, colon);
+                    value.erase(0, colon + 1);
+                }
+                if (metrics_address.empty() || !get_value(value.c_str(), &n) || n < LOWEST_ALLOWED_PORT) {
+                    fprintf(stderr, "invalid \"-metrics %s\"; must be [ip:]n, TCP port n in range [%d,%d]\n",
+                            argv[i], LOWEST_ALLOWED_PORT, HIGHEST_PORT);
+                    exit(1);
+                }
+                metrics_port = (unsigned short) n;
+            }
         } else if (arg == "-al") {
 	    int n;
             char *end;
@@ -1270,7 +1881,7 @@ static int parse_dmap_header(const unsigned char *metadata, char *tag, int *len)
     return 0;
 }
 
-static int register_dnssd() {
+static int register_dnssd(dnssd_t *dnssd, unsigned short raop_port, unsigned short airplay_port) {
     int dnssd_error;
     uint64_t features;
     
@@ -1318,17 +1929,15 @@ static void stop_dnssd() {
     }	
 }
 
-static int start_dnssd(std::vector<char> hw_addr, std::string name) {
+/* create a dnssd_t (with the AirPlay features advertised) for a receiver */
+static dnssd_t *init_dnssd(std::vector<char> hw_addr, std::string name) {
     int dnssd_error;
     int require_pw = (require_password ? 1 : 0);
-    if (dnssd) {
-        LOGE("start_dnssd error: dnssd != NULL");
-        return 2;
-    }
-    dnssd = dnssd_init(name.c_str(), strlen(name.c_str()), hw_addr.data(), hw_addr.size(), &dnssd_error, require_pw);
+    dnssd_t *dnssd = dnssd_init(name.c_str(), strlen(name.c_str()), hw_addr.data(), hw_addr.size(), &dnssd_error,
+                                require_pw);
     if (dnssd_error) {
         LOGE("Could not initialize dnssd library!: error %d", dnssd_error);
-        return 1;
+        return NULL;
     }
 
     /* after dnssd starts, reset the default feature set here 
@@ -1421,7 +2030,16 @@ static int start_dnssd(std::vector<char> hw_addr, std::string name) {
 
     /* bit 27 of Features determines whether the AirPlay2 client-pairing protocol will be used (1) or not (0) */
     dnssd_set_airplay_features(dnssd, 27, (int) setup_legacy_pairing);
-    return 0;
+    return dnssd;
+}
+
+static int start_dnssd(std::vector<char> hw_addr, std::string name) {
+    if (dnssd) {
+        LOGE("start_dnssd error: dnssd != NULL");
+        return 2;
+    }
+    dnssd = init_dnssd(hw_addr, name);
+    return (dnssd ? 0 : 1);
 }
 
 static bool check_client(char *deviceid) {
@@ -1474,20 +2092,88 @@ extern "C" void export_dacp(void *cls, const char *active_remote, const char *da
     }
 }
 
+/* the callbacks of all receivers (cls is the receiver_t): the main receiver is relaunched by main(), *
+ * and the additional receivers by receiver_restart() in the main loop                                */
+static bool is_main_receiver(const receiver_t *receiver) {
+    return (receiver == &main_receiver);
+}
+
+/* called in the main loop: start again (with new renderers) for the next client session */
+static void receiver_new_video_renderer(receiver_t *receiver) {
+    /* the callbacks (in the network threads) use the renderer while holding video_mutex */
+    g_mutex_lock(&receiver->video_mutex);
+    if (!receiver->video_renderer) {
+        g_mutex_unlock(&receiver->video_mutex);
+        return;
+    }
+    if (reuse_video_pipeline) {
+        video_renderer_reset(receiver->video_renderer);
+        video_renderer_start(receiver->video_renderer);
+        g_mutex_unlock(&receiver->video_mutex);
+        return;
+    }
+    if (receiver->bus_watch_id) {
+        g_source_remove(receiver->bus_watch_id);
+    }
+    video_renderer_destroy(receiver->video_renderer);
+    receiver->video_renderer = video_renderer_init(render_logger, receiver->name.c_str(), videoflip,
+                                                   video_parser.c_str(), video_decoder.c_str(),
+                                                   video_converter.c_str(), videosink.c_str(), &fullscreen,
+                                                   &video_sync, NULL);
+    video_renderer_start(receiver->video_renderer);
+    receiver->bus_watch_id = (guint) video_renderer_listen(receiver->video_renderer, NULL);
+    g_mutex_unlock(&receiver->video_mutex);
+}
+
+static gboolean receiver_reset_video(gpointer data) {
+    receiver_new_video_renderer((receiver_t *) data);
+    return FALSE;
+}
+
+static gboolean receiver_restart(gpointer data) {
+    receiver_t *receiver = (receiver_t *) data;
+    unsigned short port = raop_get_port(receiver->raop);
+    if (receiver->audio_renderer) {
+        audio_renderer_stop(receiver->audio_renderer);
+    }
+    receiver_new_video_renderer(receiver);
+    raop_start(receiver->raop, &port);
+    raop_set_port(receiver->raop, port);
+    return FALSE;
+}
+
 extern "C" void conn_init (void *cls) {
-    open_connections++;
-    LOGD("Open connections: %i", open_connections);
+    receiver_t *receiver = (receiver_t *) cls;
+    wait_for_renderers();
+    receiver->open_connections++;
+    LOGD("%s: open connections: %i", receiver->name.c_str(), receiver->open_connections);
+    if (receiver->open_connections == 1) {
+        /* a new client session: -vreuse is judged by the time to its first frame */
+        g_mutex_lock(&receiver->video_mutex);
+        video_renderer_start_first_frame_timer(receiver->video_renderer, g_get_monotonic_time());
+        g_mutex_unlock(&receiver->video_mutex);
+    }
     //video_renderer_update_background(1);
 }
 
 extern "C" void conn_destroy (void *cls) {
+    receiver_t *receiver = (receiver_t *) cls;
     //video_renderer_update_background(-1);
-    open_connections--;
-    LOGD("Open connections: %i", open_connections);
-    if (open_connections == 0) {
-        remote_clock_offset = 0;
-        if (use_audio) {
-            audio_renderer_stop();
+    receiver->open_connections--;
+    LOGD("%s: open connections: %i", receiver->name.c_str(), receiver->open_connections);
+    if (receiver->open_connections == 0) {
+        receiver->remote_clock_offset = 0;
+        if (receiver->audio_renderer) {
+            audio_renderer_stop(receiver->audio_renderer);
+        }
+        if (!is_main_receiver(receiver)) {
+            return;
+        }
+        if (record || replay) {
+            recorder_stop();
+        }
+        if (restream) {
+            restream_stop();
         }
         if (dacpfile.length()) {
             remove (dacpfile.c_str());
@@ -1496,20 +2182,41 @@ extern "C" void conn_destroy (void *cls) {
 }
 
 extern "C" void conn_reset (void *cls, int timeouts, bool reset_video) {
-    LOGI("***ERROR lost connection with client (network problem?)");
+    receiver_t *receiver = (receiver_t *) cls;
+    LOGI("***ERROR %s lost connection with client (network problem?)", receiver->name.c_str());
     if (timeouts) {
         LOGI("   Client no-response limit of %d timeouts (%d seconds) reached:", timeouts, 3*timeouts);
         LOGI("   Sometimes the network connection may recover after a longer delay:\n"
              "   the default timeout limit n = %d can be changed with the \"-reset n\" option", NTP_TIMEOUT_LIMIT);
     }
+    if (!is_main_receiver(receiver)) {
+        raop_stop(receiver->raop);
+        g_idle_add(receiver_restart, receiver);
+        return;
+    }
+    /* high priority: dispatched before reset_callback() can quit the main loop and the RAOP server is destroyed */
+    g_idle_add_full(G_PRIORITY_HIGH, dump_flight_recorder_callback, NULL, NULL);
     printf("reset_video %d\n",(int) reset_video);
     close_window = reset_video;    /* leave "frozen" window open if reset_video is false */
     raop_stop(raop);
+    if (record || replay) {
+        recorder_stop();
+    }
+    if (restream) {
+        restream_stop();
+    }
     reset_loop = true;
 }
 
 extern "C" void conn_teardown(void *cls, bool *teardown_96, bool *teardown_110) {
-    if (*teardown_110 && close_window) {
+    if (!*teardown_110) {
+        return;
+    }
+    if (!is_main_receiver((receiver_t *) cls)) {
+        if (new_window_closing_behavior) {
+            g_idle_add(receiver_reset_video, cls);
+        }
+    } else if (close_window) {
         reset_loop = true;
     }
 }
@@ -1531,83 +2238,129 @@ extern "C" void report_client_request(void *cls, char *deviceid, char * model, c
     }
 }
 
+/* the -ad (ALAC) or -vd (AAC) delay added to the timestamps of audio with compression type ct */
+static int64_t audio_user_delay(unsigned char ct) {
+    switch (ct) {
+    case 2:
+        return audio_delay_alac;
+    case 4:
+    case 8:
+        return audio_delay_aac;
+    default:
+        return 0;
+    }
+}
+
 extern "C" void audio_process (void *cls, raop_ntp_t *ntp, audio_decode_struct *data) {
-    if (dump_audio) {
+    receiver_t *receiver = (receiver_t *) cls;
+    bool is_main = is_main_receiver(receiver);
+    if (is_main && dump_audio) {
         dump_audio_to_file(data->data, data->data_len, (data->data)[0] & 0xf0);
     }
-    if (use_audio) {
-        if (!remote_clock_offset) {
-            remote_clock_offset = data->ntp_time_local - data->ntp_time_remote;
+    if (is_main && (record || replay)) {
+        recorder_audio_frame(data->data, data->data_len, data->ct, data->ntp_time_remote);
+    }
+    if (is_main && restream) {
+        restream_audio_frame(data->data, data->data_len, data->ct, data->ntp_time_remote);
+    }
+    if (receiver->audio_renderer) {
+        /* from packet reception to this callback, not to the sink (that is measured by -trace) */
+        int64_t callback_delay = (int64_t) raop_ntp_get_local_time(ntp) - (int64_t) data->ntp_time_local;
+        flight_recorder_add(raop_get_flight_recorder(receiver->raop), FLIGHT_RECORD_AUDIO_DELAY, 0, 0, callback_delay, 0);
+        if (is_main && metrics) {
+            metrics_histogram_observe(&audio_callback_delay, callback_delay);
         }
-        data->ntp_time_remote = data->ntp_time_remote + remote_clock_offset;
-        switch (data->ct) {
-        case 2:
-            if (audio_delay_alac) {
-                data->ntp_time_remote = (uint64_t) ((int64_t) data->ntp_time_remote + audio_delay_alac);
-            }
-            break;
-        case 4:
-        case 8:
-            if (audio_delay_aac) {
-                data->ntp_time_remote = (uint64_t) ((int64_t) data->ntp_time_remote + audio_delay_aac);
-            }
-            break;
-        default:
-            break;
+        if (!receiver->remote_clock_offset) {
+            receiver->remote_clock_offset = data->ntp_time_local - data->ntp_time_remote;
+        }
+        data->ntp_time_remote = data->ntp_time_remote + receiver->remote_clock_offset;
+        data->ntp_time_remote = (uint64_t) ((int64_t) data->ntp_time_remote + audio_user_delay(data->ct));
+        if (is_main && latency_trace) {
+            latency_trace_begin(latency_trace, LATENCY_TRACE_AUDIO, data->ntp_time_remote,
+                                data->time_received, data->time_decrypted);
         }
-        audio_renderer_render_buffer(data->data, &(data->data_len), &(data->seqnum), &(data->ntp_time_remote));
+        audio_renderer_render_buffer(receiver->audio_renderer, data->data, &(data->data_len), &(data->seqnum),
+                                     &(data->ntp_time_remote));
     }
 }
 
 extern "C" void video_process (void *cls, raop_ntp_t *ntp, h264_decode_struct *data) {
-    if (dump_video) {
+    receiver_t *receiver = (receiver_t *) cls;
+    bool is_main = is_main_receiver(receiver);
+    if (is_main && dump_video) {
         dump_video_to_file(data->data, data->data_len);
     }
-    if (use_video) {
-        if (!remote_clock_offset) {
-            remote_clock_offset = data->ntp_time_local - data->ntp_time_remote;
+    if (is_main && (record || replay)) {
+        recorder_video_frame(data->data, data->data_len, data->ntp_time_remote);
+    }
+    if (is_main && restream) {
+        restream_video_frame(data->data, data->data_len, data->ntp_time_remote);
+    }
+    g_mutex_lock(&receiver->video_mutex);
+    if (receiver->video_renderer) {
+        int64_t callback_delay = (int64_t) raop_ntp_get_local_time(ntp) - (int64_t) data->ntp_time_local;
+        flight_recorder_add(raop_get_flight_recorder(receiver->raop), FLIGHT_RECORD_VIDEO_DELAY, 0, 0, callback_delay, 0);
+        if (is_main && metrics) {
+            metrics_histogram_observe(&video_callback_delay, callback_delay);
+        }
+        if (!receiver->remote_clock_offset) {
+            receiver->remote_clock_offset = data->ntp_time_local - data->ntp_time_remote;
+        }
+        data->ntp_time_remote = data->ntp_time_remote + receiver->remote_clock_offset;
+        if (is_main && latency_trace) {
+            latency_trace_begin(latency_trace, LATENCY_TRACE_VIDEO, data->ntp_time_remote,
+                                data->time_received, data->time_decrypted);
         }
-        data->ntp_time_remote = data->ntp_time_remote + remote_clock_offset;
-        video_renderer_render_buffer(data->data, &(data->data_len), &(data->nal_count), &(data->ntp_time_remote));
+        video_renderer_render_buffer(receiver->video_renderer, data->data, &(data->data_len), &(data->nal_count),
+                                     &(data->ntp_time_remote));
     }
+    g_mutex_unlock(&receiver->video_mutex);
 }
 
 extern "C" void video_pause (void *cls) {
+    receiver_t *receiver = (receiver_t *) cls;
 #ifdef GST_124
     return;  //pause/resume changes in GStreamer-1.24 break this code
 #endif
-    if (use_video) {
-        video_renderer_pause();
+    g_mutex_lock(&receiver->video_mutex);
+    if (receiver->video_renderer) {
+        video_renderer_pause(receiver->video_renderer);
     }
+    g_mutex_unlock(&receiver->video_mutex);
 }
 
 extern "C" void video_resume (void *cls) {
+    receiver_t *receiver = (receiver_t *) cls;
 #ifdef GST_124
     return;  //pause/resume changes in GStreamer-1.24 break this code
 #endif
-    if (use_video) {
-        video_renderer_resume();
+    g_mutex_lock(&receiver->video_mutex);
+    if (receiver->video_renderer) {
+        video_renderer_resume(receiver->video_renderer);
     }
+    g_mutex_unlock(&receiver->video_mutex);
 }
 
 
 extern "C" void audio_flush (void *cls) {
-    if (use_audio) {
-        audio_renderer_flush();
+    receiver_t *receiver = (receiver_t *) cls;
+    if (receiver->audio_renderer) {
+        audio_renderer_flush(receiver->audio_renderer);
     }
 }
 
 extern "C" void video_flush (void *cls) {
-    if (use_video) {
-        video_renderer_flush();
+    receiver_t *receiver = (receiver_t *) cls;
+    g_mutex_lock(&receiver->video_mutex);
+    if (receiver->video_renderer) {
+        video_renderer_flush(receiver->video_renderer);
     }
+    g_mutex_unlock(&receiver->video_mutex);
 }
 
-extern "C" void audio_set_volume (void *cls, float volume) {
+/* convert an AirPlay volume (dB) to a GStreamer volume */
+static double gst_volume_from_airplay (float volume) {
     double db, db_flat, frac, gst_volume;
-    if (!use_audio) {
-      return;
-    }
     /* convert from AirPlay dB  volume in range {-30dB : 0dB}, to GStreamer volume */
     if (volume == -144.0f) {   /* AirPlay "mute" signal */
         frac = 0.0;
@@ -1645,12 +2398,28 @@ extern "C" void audio_set_volume (void *cls, float volume) {
 	/* conversion from (gain) decibels to GStreamer's linear volume scale */
         gst_volume = pow(10.0, 0.05*db);
     }
-    audio_renderer_set_volume(gst_volume);
+    return gst_volume;
+}
+
+extern "C" void audio_set_volume (void *cls, float volume) {
+    receiver_t *receiver = (receiver_t *) cls;
+    if (!receiver->audio_renderer) {
+      return;
+    }
+    audio_renderer_set_volume(receiver->audio_renderer, gst_volume_from_airplay(volume));
 }
 
 extern "C" void audio_get_format (void *cls, unsigned char *ct, unsigned short *spf, bool *usingScreen, bool *isMedia, uint64_t *audioFormat) {
+    receiver_t *receiver = (receiver_t *) cls;
     unsigned char type;
-    LOGI("ct=%d spf=%d usingScreen=%d isMedia=%d  audioFormat=0x%lx",*ct, *spf, *usingScreen, *isMedia, (unsigned long) *audioFormat);
+    LOGI("%s: ct=%d spf=%d usingScreen=%d isMedia=%d  audioFormat=0x%lx", receiver->name.c_str(), *ct, *spf,
+         *usingScreen, *isMedia, (unsigned long) *audioFormat);
+    if (receiver->audio_renderer) {
+        audio_renderer_start(receiver->audio_renderer, ct);
+    }
+    if (!is_main_receiver(receiver)) {
+        return;
+    }
     switch (*ct) {
     case 2:
         type = 0x20;
@@ -1667,10 +2436,6 @@ extern "C" void audio_get_format (void *cls, unsigned char *ct, unsigned short *
         audio_dumpfile = NULL;
     }
     audio_type = type;
-    
-    if (use_audio) {
-      audio_renderer_start(ct);
-    }
 
     if (coverart_filename.length()) {
         write_coverart(coverart_filename.c_str(), (const void *) empty_image, sizeof(empty_image));
@@ -1678,9 +2443,12 @@ extern "C" void audio_get_format (void *cls, unsigned char *ct, unsigned short *
 }
 
 extern "C" void video_report_size(void *cls, float *width_source, float *height_source, float *width, float *height) {
-    if (use_video) {
-        video_renderer_size(width_source, height_source, width, height);
+    receiver_t *receiver = (receiver_t *) cls;
+    g_mutex_lock(&receiver->video_mutex);
+    if (receiver->video_renderer) {
+        video_renderer_size(receiver->video_renderer, width_source, height_source, width, height);
     }
+    g_mutex_unlock(&receiver->video_mutex);
 }
 
 extern "C" void audio_set_coverart(void *cls, const void *buffer, int buflen) {
@@ -1770,6 +2538,180 @@ extern "C" bool check_register(void *cls, const char *client_pk) {
     }
 }
 
+extern "C" void metrics_collect (void *cls, metrics_buffer_t *buf) {
+    metrics_sample_t sample;
+    G_LOCK(metrics_sample);
+    sample = metrics_sample;
+    G_UNLOCK(metrics_sample);
+
+    if (sample.have_stats) {
+        const raop_stats_t *stats = &sample.stats;
+        metrics_counter(buf, "uxplay_audio_packets_received", "Audio RTP packets received", stats->audio_packets_received);
+        metrics_counter(buf, "uxplay_audio_packets_lost", "Audio packets never received", stats->audio_packets_lost);
+        metrics_counter(buf, "uxplay_audio_packets_late", "Audio packets received too late to be played",
+                        stats->audio_packets_late);
+        metrics_counter(buf, "uxplay_audio_packets_resent", "Resent audio packets received", stats->audio_packets_resent);
+        metrics_counter(buf, "uxplay_audio_resend_requests", "Audio packets requested to be resent",
+                        stats->audio_resend_requests);
+        metrics_counter(buf, "uxplay_audio_buffer_flushes", "Audio buffer flushes", stats->audio_buffer_flushes);
+        metrics_gauge(buf, "uxplay_audio_buffer_depth", "Audio packets held in the jitter buffer",
+                      (double) stats->audio_buffer_depth);
+        metrics_gauge(buf, "uxplay_audio_jitter_seconds", "RFC 3550 interarrival jitter of audio packets",
+                      (double) stats->audio_jitter / SECOND_IN_NSECS);
+        metrics_counter(buf, "uxplay_video_frames", "Video frames received", stats->video_frames);
+        metrics_counter(buf, "uxplay_video_bytes", "Video bytes received", stats->video_bytes);
+        metrics_counter(buf, "uxplay_video_idr_frames", "Video IDR frames received", stats->video_idr_frames);
+        metrics_counter(buf, "uxplay_video_invalid_frames", "Video frames that failed decryption",
+                        stats->video_invalid_frames);
+        metrics_counter(buf, "uxplay_video_dropped_frames", "Non-IDR video frames dropped (-vidronly)",
+                        stats->video_dropped_frames);
+        metrics_counter(buf, "uxplay_video_dropped_bytes", "Bytes of non-IDR video frames dropped (-vidronly)",
+                        stats->video_dropped_bytes);
+        metrics_counter(buf, "uxplay_video_undecrypted_frames", "Video frames dropped without decryption (-vidronly)",
+                        stats->video_undecrypted_frames);
+        metrics_gauge(buf, "uxplay_ntp_offset_seconds", "Clock offset of the client", (double) stats->ntp_offset / SECOND_IN_NSECS);
+        metrics_gauge(buf, "uxplay_ntp_delay_seconds", "NTP round-trip delay", (double) stats->ntp_delay / SECOND_IN_NSECS);
+        metrics_gauge(buf, "uxplay_ntp_dispersion_seconds", "NTP dispersion", (double) stats->ntp_dispersion / 4294967296.0);
+        metrics_counter(buf, "uxplay_ntp_timeouts", "NTP requests with no reply", stats->ntp_timeouts);
+        metrics_printf(buf, "# TYPE uxplay_thread_loops counter\n# HELP uxplay_thread_loops Service thread loop iterations\n");
+        metrics_printf(buf, "uxplay_thread_loops_total{thread=\"audio\"} %llu\n", (unsigned long long) stats->audio_thread_loops);
+        metrics_printf(buf, "uxplay_thread_loops_total{thread=\"mirror\"} %llu\n", (unsigned long long) stats->mirror_thread_loops);
+        metrics_printf(buf, "uxplay_thread_loops_total{thread=\"ntp\"} %llu\n", (unsigned long long) stats->ntp_thread_loops);
+        metrics_printf(buf, "uxplay_thread_loops_total{thread=\"httpd\"} %llu\n", (unsigned long long) stats->httpd_thread_loops);
+        metrics_counter(buf, "uxplay_info_requests", "GET /info requests", stats->info_requests);
+        metrics_counter(buf, "uxplay_info_cache_hits", "GET /info responses served from cache", stats->info_cache_hits);
+        metrics_gauge(buf, "uxplay_info_built_seconds", "Time taken by the last GET /info response that was built",
+                      (double) stats->info_built_nsecs / SECOND_IN_NSECS);
+        metrics_gauge(buf, "uxplay_info_cached_seconds", "Time taken by the last GET /info response served from cache",
+                      (double) stats->info_cached_nsecs / SECOND_IN_NSECS);
+        metrics_counter(buf, "uxplay_pair_verify_known_clients", "Pair-verify handshakes by recently-verified clients",
+                        stats->pair_verify_known_clients);
+        metrics_histogram(buf, "uxplay_pair_verify_seconds", "Duration of the pair-verify handshake", &sample.pair_verify);
+        metrics_histogram(buf, "uxplay_pair_setup_pin_seconds", "Server computation time of pair-setup-pin",
+                          &sample.pair_setup);
+        metrics_counter(buf, "uxplay_sender_reports", "Streaming reports received from the client", stats->sender_reports);
+        if (stats->sender_last.fields & SENDER_REPORT_FPS) {
+            metrics_gauge(buf, "uxplay_sender_fps", "Frame rate reported by the client", stats->sender_last.fps);
+        }
+        if (stats->sender_last.fields & SENDER_REPORT_BITRATE) {
+            metrics_gauge(buf, "uxplay_sender_bitrate", "Encoder bitrate reported by the client", stats->sender_last.bitrate);
+        }
+        if (stats->sender_last.fields & SENDER_REPORT_DROPPED) {
+            metrics_gauge(buf, "uxplay_sender_dropped_frames", "Dropped frames reported by the client",
+                          stats->sender_last.dropped_frames);
+        }
+    }
+    metrics_histogram(buf, "uxplay_audio_callback_delay_seconds", "Delay from packet reception to the audio callback",
+                      &audio_callback_delay);
+    metrics_histogram(buf, "uxplay_video_callback_delay_seconds", "Delay from packet reception to the video callback",
+                      &video_callback_delay);
+    if (sample.have_video_queue) {
+        metrics_gauge(buf, "uxplay_video_queue_buffers", "Buffers in the GStreamer video queue", sample.video_queue_buffers);
+        metrics_gauge(buf, "uxplay_video_queue_bytes", "Bytes in the GStreamer video queue", sample.video_queue_bytes);
+        metrics_gauge(buf, "uxplay_video_queue_seconds", "Duration of data in the GStreamer video queue",
+                      (double) sample.video_queue_time / SECOND_IN_NSECS);
+    }
+    if (sample.have_video_first_frame) {
+        metrics_gauge(buf, "uxplay_video_first_frame_seconds", "Time from the start of the last session to its first frame at the videosink",
+                      (double) sample.video_first_frame / SECOND_IN_NSECS);
+    }
+    if (sample.have_audio_queue) {
+        metrics_gauge(buf, "uxplay_audio_queue_buffers", "Buffers in the GStreamer audio queue", sample.audio_queue_buffers);
+        metrics_gauge(buf, "uxplay_audio_queue_bytes", "Bytes in the GStreamer audio queue", sample.audio_queue_bytes);
+        metrics_gauge(buf, "uxplay_audio_queue_seconds", "Duration of data in the GStreamer audio queue",
+                      (double) sample.audio_queue_time / SECOND_IN_NSECS);
+    }
+    if (record) {
+        recorder_stats_t recorder_stats;
+        recorder_get_stats(&recorder_stats);
+        metrics_gauge(buf, "uxplay_recording", "1 if a recording is in progress", recorder_stats.recording ? 1 : 0);
+        metrics_counter(buf, "uxplay_recorded_video_frames", "Video frames queued for recording", recorder_stats.video_frames);
+        metrics_counter(buf, "uxplay_recorded_audio_frames", "Audio frames queued for recording", recorder_stats.audio_frames);
+        metrics_counter(buf, "uxplay_recording_dropped_frames", "Frames not recorded because the writer fell behind",
+                        recorder_stats.dropped_frames);
+        metrics_counter(buf, "uxplay_recording_files", "Recording files opened", recorder_stats.segments);
+    }
+    if (replay) {
+        recorder_stats_t recorder_stats;
+        recorder_get_stats(&recorder_stats);
+        metrics_gauge(buf, "uxplay_replay_bytes", "Memory used by the instant-replay buffer",
+                      (double) recorder_stats.replay_bytes);
+        metrics_counter(buf, "uxplay_replays_saved", "Instant replays saved to file", recorder_stats.replays_saved);
+    }
+    if (restream) {
+        restream_stats_t restream_stats;
+        restream_get_stats(&restream_stats);
+        metrics_gauge(buf, "uxplay_restreaming", "1 if re-streaming is in progress", restream_stats.streaming ? 1 : 0);
+        metrics_counter(buf, "uxplay_restreamed_video_frames", "Video frames re-streamed", restream_stats.video_frames);
+        metrics_counter(buf, "uxplay_restreamed_audio_frames", "Audio frames re-streamed", restream_stats.audio_frames);
+        metrics_counter(buf, "uxplay_restream_dropped_frames", "Frames not re-streamed because the output fell behind",
+                        restream_stats.dropped_frames);
+    }
+    if (sample.audio_sinks > 1) {
+        metrics_printf(buf, "# TYPE uxplay_audio_sink_late_buffers counter\n"
+                       "# HELP uxplay_audio_sink_late_buffers Buffers that reached an audiosink after they were due\n");
+        for (int i = 0; i < sample.audio_sinks; i++) {
+            metrics_printf(buf, "uxplay_audio_sink_late_buffers_total{sink=\"%d\"} %llu\n", i,
+                           (unsigned long long) sample.audio_sink_late[i]);
+        }
+        metrics_printf(buf, "# TYPE uxplay_audio_sink_dropped_buffers counter\n"
+                       "# HELP uxplay_audio_sink_dropped_buffers Buffers dropped because an audiosink fell behind\n");
+        for (int i = 0; i < sample.audio_sinks; i++) {
+            metrics_printf(buf, "uxplay_audio_sink_dropped_buffers_total{sink=\"%d\"} %llu\n", i,
+                           (unsigned long long) sample.audio_sink_dropped[i]);
+        }
+        metrics_printf(buf, "# TYPE uxplay_audio_sink_drift_seconds gauge\n"
+                       "# HELP uxplay_audio_sink_drift_seconds Playback position of an audiosink minus that of the main one\n");
+        for (int i = 0; i < sample.audio_sinks; i++) {
+            metrics_printf(buf, "uxplay_audio_sink_drift_seconds{sink=\"%d\"} %.6f\n", i,
+                           (double) sample.audio_sink_drift[i] / SECOND_IN_NSECS);
+        }
+    }
+    if (sample.receivers) {
+        /* the receivers (and their names) do not change while the metrics server runs */
+        metrics_printf(buf, "# TYPE uxplay_receiver_connections gauge\n"
+                       "# HELP uxplay_receiver_connections Open client connections of an additional receiver\n");
+        for (int i = 0; i < sample.receivers; i++) {
+            metrics_printf(buf, "uxplay_receiver_connections{receiver=\"%s\"} %u\n", receivers[i]->name.c_str(),
+                           sample.receiver_connections[i]);
+        }
+        metrics_printf(buf, "# TYPE uxplay_receiver_resident_memory_bytes gauge\n"
+                       "# HELP uxplay_receiver_resident_memory_bytes Resident memory added by starting an additional receiver\n");
+        for (int i = 0; i < sample.receivers; i++) {
+            metrics_printf(buf, "uxplay_receiver_resident_memory_bytes{receiver=\"%s\"} %ld\n",
+                           receivers[i]->name.c_str(), receivers[i]->memory * 1024);
+        }
+    }
+    if (use_video && shm_export) {
+        metrics_counter(buf, "uxplay_shm_exported_frames", "Decoded frames published to shared memory",
+                        shm_export_get_frames(shm_export));
+    }
+    for (int i = 0; i < sample.video_branches; i++) {
+        if (i == 0) {
+            metrics_printf(buf, "# TYPE uxplay_video_branch_dropped_frames counter\n"
+                           "# HELP uxplay_video_branch_dropped_frames Decoded frames dropped by a -vbranch output\n");
+        }
+        metrics_printf(buf, "uxplay_video_branch_dropped_frames_total{branch=\"%s\"} %llu\n",
+                       sample.video_branch_name[i].c_str(), (unsigned long long) sample.video_branch_dropped[i]);
+    }
+    if (latency_trace) {
+        const char *streams[LATENCY_TRACE_STREAMS] = { "audio", "video" };
+        for (int stream = 0; stream < LATENCY_TRACE_STREAMS; stream++) {
+            for (int stage = LATENCY_TRACE_RECEIVE; stage < LATENCY_TRACE_STAGES; stage++) {
+                std::string name = std::string("uxplay_") + streams[stream] + "_" +
+                    (stage == LATENCY_TRACE_RECEIVE ? "total" : latency_trace_stage_name((latency_trace_stage_t) stage)) +
+                    "_latency_seconds";
+                std::string help = (stage == LATENCY_TRACE_RECEIVE) ? "Time from socket receipt to render" :
+                    std::string("Time taken by the ") + latency_trace_stage_name((latency_trace_stage_t) stage) + " stage";
+                metrics_histogram(buf, name.c_str(), help.c_str(),
+                                  latency_trace_get_histogram(latency_trace, (latency_trace_stream_t) stream,
+                                                              (latency_trace_stage_t) stage));
+            }
+        }
+    }
+    metrics_thread_cpu(buf, "uxplay_thread_cpu_seconds");
+}
+
 extern "C" void log_callback (void *cls, int level, const char *msg) {
     switch (level) {
         case LOGGER_DEBUG: {
@@ -1793,43 +2735,22 @@ extern "C" void log_callback (void *cls, int level, const char *msg) {
     }
 }
 
-static int start_raop_server (unsigned short display[5], unsigned short tcp[3], unsigned short udp[3], bool debug_log) {
-    raop_callbacks_t raop_cbs;
-    memset(&raop_cbs, 0, sizeof(raop_cbs));
-    raop_cbs.conn_init = conn_init;
-    raop_cbs.conn_destroy = conn_destroy;
-    raop_cbs.conn_reset = conn_reset;
-    raop_cbs.conn_teardown = conn_teardown;
-    raop_cbs.audio_process = audio_process;
-    raop_cbs.video_process = video_process;
-    raop_cbs.audio_flush = audio_flush;
-    raop_cbs.video_flush = video_flush;
-    raop_cbs.video_pause = video_pause;
-    raop_cbs.video_resume = video_resume;
-    raop_cbs.audio_set_volume = audio_set_volume;
-    raop_cbs.audio_get_format = audio_get_format;
-    raop_cbs.video_report_size = video_report_size;
-    raop_cbs.audio_set_metadata = audio_set_metadata;
-    raop_cbs.audio_set_coverart = audio_set_coverart;
-    raop_cbs.audio_set_progress = audio_set_progress;
-    raop_cbs.report_client_request = report_client_request;
-    raop_cbs.display_pin = display_pin;
-    raop_cbs.register_client = register_client;
-    raop_cbs.check_register = check_register;
-    raop_cbs.export_dacp = export_dacp;
-
-    raop = raop_init(&raop_cbs);
+/* create a raop_t with the configured settings, and start it; port is set to its RAOP port */
+static raop_t *init_raop_server (raop_callbacks_t *raop_cbs, const char *device_id, const char *key_file,
+                                 unsigned short display[5], unsigned short tcp[3], unsigned short udp[3],
+                                 unsigned short *port) {
+    raop_t *raop = raop_init(raop_cbs);
     if (raop == NULL) {
         LOGE("Error initializing raop!");
-        return -1;
+        return NULL;
     }
     raop_set_log_callback(raop, log_callback, NULL);
     raop_set_log_level(raop, log_level);
     /* set nohold = 1 to allow  capture by new client */
-    if (raop_init2(raop, nohold, mac_address.c_str(), keyfile.c_str())){
+    if (raop_init2(raop, nohold, device_id, key_file)){
         LOGE("Error initializing raop (2)!");
         free (raop);
-        return -1;
+        return NULL;
     }
 
     /* write desired display pixel width, pixel height, refresh_rate, max_fps, overscanned.  */
@@ -1842,6 +2763,7 @@ static int start_raop_server (unsigned short display[5], unsigned short tcp[3],
     if (display[4]) raop_set_plist(raop, "overscanned", (int) display[4]);
 
     if (show_client_FPS_data) raop_set_plist(raop, "clientFPSdata", 1);
+    if (idr_only) raop_set_plist(raop, "idrOnly", 1);
     raop_set_plist(raop, "max_ntp_timeouts", max_ntp_timeouts);
     if (audiodelay >= 0) raop_set_plist(raop, "audio_delay_micros", audiodelay);
     if (require_password) raop_set_plist(raop, "pin", (int) pin);
@@ -1850,9 +2772,48 @@ static int start_raop_server (unsigned short display[5], unsigned short tcp[3],
     raop_set_tcp_ports(raop, tcp);
     raop_set_udp_ports(raop, udp);
 
-    raop_port = raop_get_port(raop);
-    raop_start(raop, &raop_port);
-    raop_set_port(raop, raop_port);
+    *port = raop_get_port(raop);
+    raop_start(raop, port);
+    raop_set_port(raop, *port);
+    return raop;
+}
+
+/* the callbacks shared by all receivers */
+static void set_receiver_callbacks (raop_callbacks_t *raop_cbs, receiver_t *receiver) {
+    memset(raop_cbs, 0, sizeof(*raop_cbs));
+    raop_cbs->cls = receiver;
+    raop_cbs->conn_init = conn_init;
+    raop_cbs->conn_destroy = conn_destroy;
+    raop_cbs->conn_reset = conn_reset;
+    raop_cbs->conn_teardown = conn_teardown;
+    raop_cbs->audio_process = audio_process;
+    raop_cbs->video_process = video_process;
+    raop_cbs->audio_flush = audio_flush;
+    raop_cbs->video_flush = video_flush;
+    raop_cbs->video_pause = video_pause;
+    raop_cbs->video_resume = video_resume;
+    raop_cbs->audio_set_volume = audio_set_volume;
+    raop_cbs->audio_get_format = audio_get_format;
+    raop_cbs->video_report_size = video_report_size;
+    raop_cbs->report_client_request = report_client_request;
+    raop_cbs->display_pin = display_pin;
+    raop_cbs->register_client = register_client;
+    raop_cbs->check_register = check_register;
+}
+
+static int start_raop_server (unsigned short display[5], unsigned short tcp[3], unsigned short udp[3], bool debug_log) {
+    raop_callbacks_t raop_cbs;
+    main_receiver.name = server_name;
+    set_receiver_callbacks(&raop_cbs, &main_receiver);
+    raop_cbs.audio_set_metadata = audio_set_metadata;
+    raop_cbs.audio_set_coverart = audio_set_coverart;
+    raop_cbs.audio_set_progress = audio_set_progress;
+    raop_cbs.export_dacp = export_dacp;
+
+    raop = init_raop_server(&raop_cbs, mac_address.c_str(), keyfile.c_str(), display, tcp, udp, &raop_port);
+    if (raop == NULL) {
+        return -1;
+    }
 
     /* use raop_port for airplay_port (instead of tcp[2]) */
     airplay_port = raop_port;
@@ -1866,14 +2827,110 @@ static int start_raop_server (unsigned short display[5], unsigned short tcp[3],
     return 0;
 }
 
+static void log_handshake_percentiles(const char *name, const metrics_histogram_t *histogram) {
+    if (histogram->count) {
+        LOGI("%s (ms): p50 %.2f p90 %.2f p99 %.2f (%llu handshakes)", name,
+             1000.0 * metrics_histogram_quantile(histogram, 0.5), 1000.0 * metrics_histogram_quantile(histogram, 0.9),
+             1000.0 * metrics_histogram_quantile(histogram, 0.99), (unsigned long long) histogram->count);
+    }
+}
+
 static void stop_raop_server () {
     if (raop) {
+        log_handshake_percentiles("pair-verify handshake", raop_get_pair_verify_histogram(raop));
+        log_handshake_percentiles("pair-setup-pin computation", raop_get_pair_setup_histogram(raop));
         raop_destroy(raop);
         raop = NULL;
     }
     return;
 }
 
+/* start receiver n (1, 2, ...) of receivers: its MAC address is the main one + n, and if *
+ * a key file is used, its key is stored in "<keyfile>.n"                                */
+static int start_receiver (receiver_t *receiver, int n, const std::vector<char> &server_hw_addr) {
+    raop_callbacks_t raop_cbs;
+    unsigned short port;
+    char device_id[18];
+    std::string key_file = "";
+    long memory = get_resident_memory();
+
+    receiver->hw_addr = server_hw_addr;
+    receiver->hw_addr.back() = (char) ((unsigned char) receiver->hw_addr.back() + n);
+    snprintf(device_id, sizeof(device_id), "%02x:%02x:%02x:%02x:%02x:%02x",
+             (unsigned char) receiver->hw_addr[0], (unsigned char) receiver->hw_addr[1],
+             (unsigned char) receiver->hw_addr[2], (unsigned char) receiver->hw_addr[3],
+             (unsigned char) receiver->hw_addr[4], (unsigned char) receiver->hw_addr[5]);
+    receiver->device_id = device_id;
+    if (keyfile != "" && keyfile != "0") {
+        key_file = keyfile + "." + std::to_string(n);
+    }
+    if (do_append_hostname) {
+        append_hostname(receiver->name);
+    }
+
+    if (use_audio) {
+        receiver->audio_renderer = audio_renderer_init(render_logger, audiosink.c_str(), &audio_sync, &video_sync,
+                                                       NULL);
+    }
+    if (use_video) {
+        receiver->video_renderer = video_renderer_init(render_logger, receiver->name.c_str(), videoflip,
+                                                       video_parser.c_str(), video_decoder.c_str(),
+                                                       video_converter.c_str(), videosink.c_str(), &fullscreen,
+                                                       &video_sync, NULL);
+        video_renderer_start(receiver->video_renderer);
+        receiver->bus_watch_id = (guint) video_renderer_listen(receiver->video_renderer, NULL);
+    }
+
+    receiver->dnssd = init_dnssd(receiver->hw_addr, receiver->name);
+    if (!receiver->dnssd) {
+        return -1;
+    }
+
+    set_receiver_callbacks(&raop_cbs, receiver);
+
+    receiver->raop = init_raop_server(&raop_cbs, receiver->device_id.c_str(), key_file.c_str(), display,
+                                      receiver->tcp, receiver->udp, &port);
+    if (!receiver->raop) {
+        return -2;
+    }
+    raop_set_dnssd(receiver->raop, receiver->dnssd);
+    if (register_dnssd(receiver->dnssd, port, port)) {
+        return -3;
+    }
+
+    if (memory >= 0) {
+        receiver->memory = get_resident_memory() - memory;
+    }
+    LOGI("receiver \"%s\" (MAC address %s) is on port %u; it added %ld kB of resident memory",
+         receiver->name.c_str(), device_id, port, receiver->memory);
+    return 0;
+}
+
+static void stop_receivers () {
+    for (receiver_t *receiver : receivers) {
+        if (receiver->raop) {
+            raop_destroy(receiver->raop);
+        }
+        if (receiver->dnssd) {
+            dnssd_unregister_raop(receiver->dnssd);
+            dnssd_unregister_airplay(receiver->dnssd);
+            dnssd_destroy(receiver->dnssd);
+        }
+        if (receiver->bus_watch_id) {
+            g_source_remove(receiver->bus_watch_id);
+        }
+        if (receiver->audio_renderer) {
+            audio_renderer_destroy(receiver->audio_renderer);
+        }
+        if (receiver->video_renderer) {
+            video_renderer_destroy(receiver->video_renderer);
+        }
+        g_mutex_clear(&receiver->video_mutex);
+        delete receiver;
+    }
+    receivers.clear();
+}
+
 static void read_config_file(const char * filename, const char * uxplay_name) {
     std::string config_file = filename;
     std::string option_char = "-";
@@ -1969,6 +3026,9 @@ int main (int argc, char *argv[]) {
 #endif
     std::vector<char> server_hw_addr;
     std::string config_file = "";
+    gint64 startup_time = g_get_monotonic_time();
+    bool startup_reported = false;
+    gint64 phase_time;
 
 #ifdef SUPPRESS_AVAHI_COMPAT_WARNING
     // suppress avahi_compat nag message.  avahi emits a "nag" warning (once)
@@ -1983,6 +3043,16 @@ int main (int argc, char *argv[]) {
     }
     parse_arguments (argc, argv);
 
+    if (record) {
+        /* checked here, as -recfmt (which sets the file extension) may come after -rec */
+        std::string fn = record_location + ((record_container == RECORDER_MKV) ? ".mkv" : ".mp4");
+        if (!file_has_write_access(fn.c_str())) {
+            fprintf(stderr, "%s cannot be written to:\noption \"-rec <fn>\" must be to files with write access\n",
+                    fn.c_str());
+            exit(1);
+        }
+    }
+
     log_level = (debug_log ? LOGGER_DEBUG : LOGGER_INFO);
     
 #ifdef _WIN32    /*  use utf-8 terminal output; don't buffer stdout in WIN32 when debug_log = false */
@@ -2094,32 +3164,54 @@ int main (int argc, char *argv[]) {
     if (keyfile != "") {
         LOGI("public key storage (for persistence) is in %s", keyfile.c_str());
     }
+
+    if (flight_recorder_file == "no") {
+        flight_recorder_file.erase();
+    } else if (flight_recorder_file == "") {
+        const char * homedir = get_homedir();
+        if (homedir) {
+            flight_recorder_file = homedir;
+            flight_recorder_file.append("/.uxplay.flightrec");
+        }
+    }
+
+    if (probe_video_decoder && auto_video_decoder) {
+        const char * homedir = get_homedir();
+        if (homedir) {
+            decoder_probe_file = homedir;
+            decoder_probe_file.append("/.uxplay.decoder");
+        }
+    }
     
     if (do_append_hostname) {
         append_hostname(server_name);
     }
 
-    if (!gstreamer_init()) {
-        LOGE ("stopping");
-        exit (1);
-    }
+    startup_phase("configuration", startup_time);
 
     render_logger = logger_init();
     logger_set_callback(render_logger, log_callback, NULL);
     logger_set_level(render_logger, log_level);
 
-    if (use_audio) {
-      audio_renderer_init(render_logger, audiosink.c_str(), &audio_sync, &video_sync);
-    } else {
-        LOGI("audio_disabled");
+    if (use_latency_trace && null_renderer) {
+        /* frames are traced up to the videosink and audiosink of the GStreamer renderers */
+        LOGW("-trace is not available with -renderer null (the null renderers record their own timing)");
+        use_latency_trace = false;
     }
-
-    if (use_video) {
-        video_renderer_init(render_logger, server_name.c_str(), videoflip, video_parser.c_str(),
-                            video_decoder.c_str(), video_converter.c_str(), videosink.c_str(), &fullscreen, &video_sync);
-        video_renderer_start();
+    if (use_latency_trace) {
+        latency_trace = latency_trace_init(render_logger);
+        if (latency_trace) {
+            LOGI("latency tracing is on: trace will be written to %s", latency_trace_file.c_str());
+        }
     }
 
+#ifdef __APPLE__
+    /* GStreamer on macOS expects to be initialized on the main thread */
+    init_renderers(NULL);
+#else
+    renderer_init_thread = g_thread_new("renderer-init", init_renderers, NULL);
+#endif
+
     if (udp[0]) {
         LOGI("using network ports UDP %d %d %d TCP %d %d %d", udp[0], udp[1], udp[2], tcp[0], tcp[1], tcp[2]);
     }
@@ -2145,36 +3237,110 @@ int main (int argc, char *argv[]) {
     }
 
     restart:
+    phase_time = g_get_monotonic_time();
     if (start_dnssd(server_hw_addr, server_name)) {
         goto cleanup;
     }
+    if (!startup_reported) {
+        startup_phase("start_dnssd", phase_time);
+    }
+    phase_time = g_get_monotonic_time();
     if (start_raop_server(display, tcp, udp, debug_log)) {
         stop_dnssd();
         goto cleanup;
     }
-    if (register_dnssd()) {
+    if (!startup_reported) {
+        startup_phase("start_raop_server", phase_time);
+    }
+    phase_time = g_get_monotonic_time();
+    if (register_dnssd(dnssd, raop_port, airplay_port)) {
         stop_raop_server();
         stop_dnssd();
         goto cleanup;
     }
+    if (!startup_reported) {
+        startup_phase("register_dnssd", phase_time);
+    }
+    if (!startup_reported) {
+        double discoverable = (double) (g_get_monotonic_time() - startup_time) / 1000.0;
+        gint64 start_time = g_get_monotonic_time();
+        wait_for_renderers();
+        startup_phase("wait for renderers", start_time);
+        for (size_t n = 0; n < receivers.size(); n++) {
+            start_time = g_get_monotonic_time();
+            if (start_receiver(receivers[n], (int) n + 1, server_hw_addr)) {
+                LOGE("failed to start receiver \"%s\"", receivers[n]->name.c_str());
+                stop_receivers();
+                stop_raop_server();
+                stop_dnssd();
+                goto cleanup;
+            }
+            startup_phase(("receiver " + receivers[n]->name).c_str(), start_time);
+        }
+        if (use_metrics) {
+            start_time = g_get_monotonic_time();
+            metrics = metrics_init(render_logger, metrics_collect, NULL);
+            if (!metrics || metrics_start(metrics, metrics_address.c_str(), &metrics_port) < 0) {
+                LOGE("failed to start the metrics server on %s, TCP port %u", metrics_address.c_str(), metrics_port);
+                metrics_destroy(metrics);
+                metrics = NULL;
+            }
+            startup_phase("metrics", start_time);
+        }
+        if (profile_startup) {
+            LOGI("startup phases (ms, gstreamer and renderer phases run concurrently with the others):");
+            G_LOCK(startup_phases);
+            for (auto &phase : startup_phases) {
+                LOGI("   %-22s %8.1f", phase.first.c_str(), phase.second);
+            }
+            G_UNLOCK(startup_phases);
+            LOGI("   discoverable after %8.1f", discoverable);
+        }
+        LOGI("UxPlay ready %.1f ms after startup; resident memory %ld kB",
+             (double) (g_get_monotonic_time() - startup_time) / 1000.0, get_resident_memory());
+        startup_reported = true;
+    }
     reconnect:
     compression_type = 0;
     close_window = new_window_closing_behavior; 
     main_loop();
-    if (relaunch_video || reset_loop) {
-        if(reset_loop) {
-            reset_loop = false;
-        } else {
-            raop_stop(raop);
+    if (relaunch_video && !reset_loop) {
+        /* the main loop was quit by the GStreamer bus callback after a video pipeline error: the client  *
+         * session goes on, so only the video renderer is replaced, and it is primed with the cached SPS,  *
+         * PPS and IDR frame, to show a picture now rather than after the client's next IDR frame          */
+        int len, nal_count;
+        gint64 relaunch_time = g_get_monotonic_time();
+        g_mutex_lock(&main_receiver.video_mutex);
+        video_renderer_destroy(video_renderer);
+        video_renderer = video_renderer_init(render_logger, server_name.c_str(), videoflip, video_parser.c_str(),
+                                             video_decoder.c_str(), video_converter.c_str(), videosink.c_str(),
+                                             &fullscreen, &video_sync, &video_extras);
+        video_renderer_start(video_renderer);
+        video_renderer_start_first_frame_timer(video_renderer, relaunch_time);
+        unsigned char *keyframe = raop_take_video_keyframe(raop, &len, &nal_count);
+        if (keyframe) {
+            video_renderer_prime(video_renderer, keyframe, len);
+            free(keyframe);
         }
-        if (use_audio) audio_renderer_stop();
-        if (use_video && close_window) {
-            video_renderer_destroy();
-            video_renderer_init(render_logger, server_name.c_str(), videoflip, video_parser.c_str(),
-                                video_decoder.c_str(), video_converter.c_str(), videosink.c_str(), &fullscreen,
-                                &video_sync);
-            video_renderer_start();
+        g_mutex_unlock(&main_receiver.video_mutex);
+        goto reconnect;
+    }
+    if (relaunch_video || reset_loop) {
+        /* the client session has ended (conn_reset or a teardown) */
+        reset_loop = false;
+        if (use_audio) audio_renderer_stop(audio_renderer);
+        g_mutex_lock(&main_receiver.video_mutex);
+        if (use_video && close_window && reuse_video_pipeline) {
+            video_renderer_reset(video_renderer);
+            video_renderer_start(video_renderer);
+        } else if (use_video && close_window) {
+            video_renderer_destroy(video_renderer);
+            video_renderer = video_renderer_init(render_logger, server_name.c_str(), videoflip, video_parser.c_str(),
+                                                 video_decoder.c_str(), video_converter.c_str(), videosink.c_str(),
+                                                 &fullscreen, &video_sync, &video_extras);
+            video_renderer_start(video_renderer);
         }
+        g_mutex_unlock(&main_receiver.video_mutex);
         if (relaunch_video) {
             unsigned short port = raop_get_port(raop);
             raop_start(raop, &port);
@@ -2192,11 +3358,35 @@ int main (int argc, char *argv[]) {
         stop_dnssd();
     }
     cleanup:
+    wait_for_renderers();
+    if (record || replay) {
+        recorder_destroy();
+    }
+    if (restream) {
+        restream_destroy();
+    }
     if (use_audio) {
-        audio_renderer_destroy();
+        audio_renderer_destroy(audio_renderer);
+        audio_renderer = NULL;
     }
     if (use_video)  {
-        video_renderer_destroy();
+        video_renderer_destroy(video_renderer);
+        video_renderer = NULL;
+    }
+    if (metrics) {
+        metrics_destroy(metrics);
+        metrics = NULL;
+    }
+    stop_receivers();
+    if (shm_export) {
+        shm_export_destroy(shm_export);
+        shm_export = NULL;
+    }
+    if (latency_trace) {
+        latency_trace_log_summary(latency_trace);
+        latency_trace_write_json(latency_trace, latency_trace_file.c_str());
+        latency_trace_destroy(latency_trace);
+        latency_trace = NULL;
     }
     logger_destroy(render_logger);
     render_logger = NULL;